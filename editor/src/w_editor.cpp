@@ -140,12 +140,105 @@ void EditorOverlay::OnImGuiRender() {
                         Engine::GetRenderer()->IsSSAOEnabledPtr())) {
       Engine::GetRenderer()->SetRecreatePipeline(true);
     }
+    int ssaoQuality =
+        static_cast<int>(Engine::GetRenderer()->GetSSAOQuality());
+    if (ImGui::Combo(
+            PrefixLabel("SSAO Quality").c_str(), &ssaoQuality,
+            [](void*, int idx, const char** outText) {
+              *outText = GetSSAOQualityName(static_cast<SSAOQuality>(idx));
+              return true;
+            },
+            nullptr, static_cast<int>(SSAOQuality::Ultra) + 1)) {
+      Engine::GetRenderer()->SetSSAOQuality(
+          static_cast<SSAOQuality>(ssaoQuality));
+    }
+    ShadowSettings shadowSettings = Engine::GetRenderer()->GetShadowSettings();
+    int cascadeCount = static_cast<int>(shadowSettings.CascadeCount);
+    if (ImGui::SliderInt(PrefixLabel("Shadow Cascades").c_str(), &cascadeCount,
+                         1, WIESEL_SHADOW_MAX_CASCADE_COUNT)) {
+      shadowSettings.CascadeCount = static_cast<uint32_t>(cascadeCount);
+      Engine::GetRenderer()->SetShadowSettings(shadowSettings);
+    }
+    static constexpr uint32_t kShadowResolutions[] = {1024, 2048, 4096, 8192};
+    static constexpr const char* kShadowResolutionNames[] = {"1024", "2048",
+                                                             "4096", "8192"};
+    int resolutionIndex = 0;
+    for (int i = 0; i < IM_ARRAYSIZE(kShadowResolutions); i++) {
+      if (kShadowResolutions[i] == shadowSettings.Resolution) {
+        resolutionIndex = i;
+      }
+    }
+    if (ImGui::Combo(PrefixLabel("Shadow Resolution").c_str(), &resolutionIndex,
+                     kShadowResolutionNames,
+                     IM_ARRAYSIZE(kShadowResolutionNames))) {
+      shadowSettings.Resolution = kShadowResolutions[resolutionIndex];
+      Engine::GetRenderer()->SetShadowSettings(shadowSettings);
+    }
+    int depthFormat = static_cast<int>(shadowSettings.DepthFormat);
+    if (ImGui::Combo(
+            PrefixLabel("Shadow Depth Format").c_str(), &depthFormat,
+            [](void*, int idx, const char** outText) {
+              *outText =
+                  GetShadowDepthFormatName(static_cast<ShadowDepthFormat>(idx));
+              return true;
+            },
+            nullptr, static_cast<int>(ShadowDepthFormat::D32) + 1)) {
+      shadowSettings.DepthFormat = static_cast<ShadowDepthFormat>(depthFormat);
+      Engine::GetRenderer()->SetShadowSettings(shadowSettings);
+    }
+    int atlasIndex = 0;
+    for (int i = 0; i < IM_ARRAYSIZE(kShadowResolutions); i++) {
+      if (kShadowResolutions[i] == shadowSettings.AtlasResolution) {
+        atlasIndex = i;
+      }
+    }
+    if (ImGui::Combo(PrefixLabel("Shadow Atlas Resolution").c_str(),
+                     &atlasIndex, kShadowResolutionNames,
+                     IM_ARRAYSIZE(kShadowResolutionNames))) {
+      shadowSettings.AtlasResolution = kShadowResolutions[atlasIndex];
+      Engine::GetRenderer()->SetShadowSettings(shadowSettings);
+    }
+    int atlasBudget = static_cast<int>(shadowSettings.AtlasUpdateBudget);
+    if (ImGui::SliderInt(PrefixLabel("Shadow Atlas Budget").c_str(),
+                         &atlasBudget, 1, 6 * WIESEL_MAX_POINT_SHADOWS)) {
+      shadowSettings.AtlasUpdateBudget = static_cast<uint32_t>(atlasBudget);
+      Engine::GetRenderer()->SetShadowSettings(shadowSettings);
+    }
+    ImGui::Checkbox(PrefixLabel("Light Volumes").c_str(),
+                    Engine::GetRenderer()->IsLightVolumesEnabledPtr());
+    ImGui::Checkbox(PrefixLabel("Parallel Recording").c_str(),
+                    Engine::GetRenderer()->IsParallelRecordingEnabledPtr());
+    ImGui::Checkbox(PrefixLabel("Shader Hot Reload").c_str(),
+                    Engine::GetRenderer()->IsShaderHotReloadEnabledPtr());
     if (ImGui::Button("Recreate Pipeline")) {
       Engine::GetRenderer()->SetRecreatePipeline(true);
     }
+    float fixedUpdateRate = m_App.GetScene()->GetFixedUpdateRate();
+    if (ImGui::SliderFloat(PrefixLabel("Fixed Update Rate").c_str(),
+                           &fixedUpdateRate, 10.0f, 240.0f, "%.0f Hz",
+                           ImGuiSliderFlags_AlwaysClamp)) {
+      m_App.GetScene()->SetFixedUpdateRate(fixedUpdateRate);
+    }
+    ImGui::BeginDisabled(ScriptManager::IsReloading());
     if (ImGui::Button("Reload Scripts")) {
       ScriptManager::Reload();
     }
+    ImGui::EndDisabled();
+    const RenderGraph* renderGraph = m_App.GetScene()->GetRenderGraph();
+    ImGui::BeginDisabled(!renderGraph);
+    if (ImGui::Button("Dump Render Graph")) {
+      renderGraph->Dump(std::cout);
+    }
+    ImGui::EndDisabled();
+    const PipelineCacheStats& cacheStats =
+        Engine::GetRenderer()->GetPipelineCacheStats();
+    ImGui::Text("Startup pipelines: %.2f ms (%s)",
+                cacheStats.StartupCreationTime.count() / 1000.0,
+                cacheStats.LoadedFromDisk ? "warm" : "cold");
+    if (cacheStats.HasFeedback) {
+      ImGui::Text("Pipeline cache hits: %u/%u", cacheStats.CacheHits,
+                  cacheStats.PipelineCount);
+    }
   }
   ImGui::End();
 
@@ -158,6 +251,53 @@ void EditorOverlay::OnImGuiRender() {
   }
   ImGui::End();
 
+  static bool scriptProfilerOpen = true;
+  if (ImGui::Begin("Script Profiler", &scriptProfilerOpen)) {
+    if (ScriptProfiler::IsEnabled()) {
+      const ScriptGCStats& gcStats = ScriptProfiler::GetGCStats();
+      ImGui::Text("Allocations: %llu (%.1f KB)",
+                  static_cast<unsigned long long>(gcStats.Allocations),
+                  gcStats.AllocatedBytes / 1024.0);
+      ImGui::Text("Collections: %u (%u major)", gcStats.Collections,
+                  gcStats.MajorCollections);
+    }
+    if (ImGui::BeginTable("script_stats", 6,
+                          ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+      ImGui::TableSetupColumn("Method");
+      ImGui::TableSetupColumn("Calls");
+      ImGui::TableSetupColumn("Total (ms)");
+      ImGui::TableSetupColumn("Avg (us)");
+      ImGui::TableSetupColumn("Max (us)");
+      ImGui::TableSetupColumn("P99 (us)");
+      ImGui::TableHeadersRow();
+      for (const auto& [name, data] : ScriptManager::GetAllScriptData()) {
+        for (size_t i = 0; i < static_cast<size_t>(ScriptMethod::Count); i++) {
+          ScriptMethod method = static_cast<ScriptMethod>(i);
+          const ScriptMethodStats& stats = data->GetStats(method);
+          if (stats.GetCalls() == 0) {
+            continue;
+          }
+          ImGui::TableNextRow();
+          ImGui::TableNextColumn();
+          ImGui::Text("%s::%s", name.c_str(), GetScriptMethodName(method));
+          ImGui::TableNextColumn();
+          ImGui::Text("%llu", static_cast<unsigned long long>(stats.GetCalls()));
+          ImGui::TableNextColumn();
+          ImGui::Text("%.2f", stats.GetTotal().count() / 1000000.0);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.2f",
+                      stats.GetTotal().count() / 1000.0 / stats.GetCalls());
+          ImGui::TableNextColumn();
+          ImGui::Text("%.2f", stats.GetMax().count() / 1000.0);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.2f", stats.GetP99().count() / 1000.0);
+        }
+      }
+      ImGui::EndTable();
+    }
+  }
+  ImGui::End();
+
   static bool sceneOpen = true;
   if (ImGui::Begin("Scene Hierarchy", &sceneOpen)) {
     bool ignoreMenu = false;
@@ -240,6 +380,16 @@ void EditorOverlay::OnImGuiRender() {
     std::string fpsStr = fmt::format("FPS: {}", static_cast<int>(m_App.GetFPS()));
 
     ImGui::GetWindowDrawList()->AddText(textPos, IM_COL32(0, 255, 0, 255), fpsStr.c_str());
+    const auto& jobStats = m_App.GetJobWorkerStats();
+    for (size_t i = 0; i < jobStats.size(); i++) {
+      textPos.y += ImGui::GetTextLineHeight();
+      std::string workerStr = fmt::format(
+          "{} {}: {}% ({} jobs)", i == 0 ? "Main" : "Worker", i,
+          static_cast<int>(jobStats[i].Utilization * 100.0f),
+          jobStats[i].JobCount);
+      ImGui::GetWindowDrawList()->AddText(textPos, IM_COL32(0, 255, 0, 255),
+                                          workerStr.c_str());
+    }
 
     ImGuizmo::SetRect(6, 6, drawSize.x, drawSize.y);
 
@@ -14,7 +14,7 @@ public class CarScript : MonoBehavior
     public float acceleration = 0.08f;      // rate of speed gain
     public float maxSpeed = 0.5f;          // forward speed limit
     public float minSpeed = -0.2f;         // reverse speed limit
-    public float drag = 0.998f;             // natural slowdown
+    public float drag = 0.998f;             // natural slowdown per step
     public float steerClamp = 30.0f;       // in degrees
 
     public CarScript() {
@@ -29,7 +29,9 @@ public class CarScript : MonoBehavior
         return a + (b - a) * t;
     }
 
-    public override void OnUpdate(float deltaTime)
+    // Runs at the fixed rate, so the per step factors below don't depend on
+    // the frame rate.
+    public override void OnFixedUpdate(float deltaTime)
     {
         float axisX = Input.GetAxis("Horizontal");
         float axisY = Input.GetAxis("Vertical");
@@ -41,7 +43,7 @@ public class CarScript : MonoBehavior
         }
         else
         {
-            steer *= (float) Math.Pow(0.9f, deltaTime * 60.0f);
+            steer *= 0.9f;
         }
 
         // clamp steering angle
@@ -52,7 +54,7 @@ public class CarScript : MonoBehavior
         throttle = (float) Math.Clamp(throttle, minSpeed, maxSpeed); // reverse to forward speed
 
         // apply drag
-        throttle *= (float)Math.Pow(drag, deltaTime * 60.0f);
+        throttle *= drag;
 
         // rotate car
         float turnAmount = steer * deltaTime * throttle * 10.0f;
@@ -56,6 +56,7 @@ void DemoLayer::OnAttach() {
     transform.Position = {0.0f, 0.0f, 0.0f};
     auto& model = entity.AddComponent<ModelComponent>();
     Engine::LoadModel(transform, model, "assets/models/city/gmae.obj", false);
+    model.Data.IsStatic = true;
   }
   {
     Entity entity = m_Scene->CreateEntity("Car");
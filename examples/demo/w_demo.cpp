@@ -49,6 +49,7 @@ void DemoLayer::OnAttach() {
     transform.Position = {5.0f, 2.0f, 0.0f};
     auto& model = entity.AddComponent<ModelComponent>();
     Engine::LoadModel(transform, model, "assets/models/sponza/sponza.gltf");
+    model.Data.IsStatic = true;
     auto& behaviors = entity.AddComponent<BehaviorsComponent>();
     behaviors.AddBehavior<MonoBehavior>(entity, "TestBehavior");
   }
@@ -63,7 +64,8 @@ void DemoLayer::OnAttach() {
     pointLightEntity = entity.GetHandle();
     auto& transform = entity.GetComponent<TransformComponent>();
     transform.Position = glm::vec3{0.0f, 5.0f, 0.0f};
-    entity.AddComponent<LightPointComponent>();
+    auto& light = entity.AddComponent<LightPointComponent>();
+    light.CastShadows = true;
   }
   {
     auto entity = m_Scene->CreateEntity("Camera");
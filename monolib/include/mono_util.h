@@ -8,7 +8,12 @@ bool CompileToDLL(const std::string& outputFile,
                   const std::vector<std::string>& sourceFiles,
                   const std::string& libDir = "",
                   const std::vector<std::string>& linkLibs = {},
-                  bool debug = false);
+                  bool debug = false,
+                  bool allowUnsafe = false);
+
+// Precompiles the methods of an assembly to a native image next to it, which
+// the runtime loads instead of JIT compiling them.
+bool AotCompile(const std::string& assemblyFile, bool hybrid = true);
 
 class MonoStringWrapper {
  public:
@@ -33,7 +33,8 @@ bool CompileToDLL(const std::string& outputFile,
                   const std::vector<std::string>& sourceFiles,
                   const std::string& libDir,
                   const std::vector<std::string>& linkLibs,
-                  bool debug) {
+                  bool debug,
+                  bool allowUnsafe) {
   std::filesystem::path output_dir = std::filesystem::path(outputFile).parent_path();
   if (!std::filesystem::exists(output_dir) && !std::filesystem::create_directories(output_dir)) {
     std::cout << "Failed to create output directory: " << output_dir << std::endl;
@@ -57,6 +58,9 @@ bool CompileToDLL(const std::string& outputFile,
     //args += " -debug:portable";
     args += " -debug";
   }
+  if (allowUnsafe) {
+    args += " -unsafe";
+  }
   args += " -target:library";
   //args += " /nologo";
   if (!libDir.empty()) {
@@ -75,3 +79,20 @@ bool CompileToDLL(const std::string& outputFile,
 
   return true;
 }
+
+bool AotCompile(const std::string& assemblyFile, bool hybrid) {
+#ifdef WIN32
+  std::string command_prefix = ".\\mono\\bin\\mono.exe";
+#else
+  std::string command_prefix = "mono/bin/mono";
+#endif
+  std::string command = command_prefix + (hybrid ? " --aot=hybrid " : " --aot ") + assemblyFile;
+  std::pair result = ExecuteCommandAndGetOutput(command.c_str());
+  if (result.first != 0) {
+    std::cout << "Failed to AOT compile " << assemblyFile << " (error code:" << result.first << ")" << std::endl << result.second;
+    std::cout << "Compile command: " << command << std::endl;
+    return false;
+  }
+
+  return true;
+}
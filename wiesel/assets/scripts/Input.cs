@@ -1,3 +1,5 @@
+using System.Collections.Generic;
+
 namespace WieselEngine
 {
     public enum CursorMode : ushort {
@@ -135,16 +137,50 @@ namespace WieselEngine
 
     public class Input
     {
+        // Names are sent to native code once, later calls only pass the id.
+        private static Dictionary<string, int> axisIds = new Dictionary<string, int>();
+        private static Dictionary<string, int> keyIds = new Dictionary<string, int>();
+
+        public static int GetAxisId(string axis)
+        {
+            int id;
+            if (!axisIds.TryGetValue(axis, out id))
+            {
+                id = Internals.Input_GetAxisId(axis);
+                axisIds.Add(axis, id);
+            }
+            return id;
+        }
 
+        public static int GetKeyId(string keyName)
+        {
+            int id;
+            if (!keyIds.TryGetValue(keyName, out id))
+            {
+                id = Internals.Input_GetKeyId(keyName);
+                keyIds.Add(keyName, id);
+            }
+            return id;
+        }
 
         public static float GetAxis(string axis)
         {
-            return Internals.Input_GetAxis(axis);
+            return Internals.Input_GetAxis(GetAxisId(axis));
+        }
+
+        public static float GetAxis(int axisId)
+        {
+            return Internals.Input_GetAxis(axisId);
         }
 
         public static bool GetKey(string keyName)
         {
-            return Internals.Input_GetKey(keyName);
+            return Internals.Input_GetKey(GetKeyId(keyName));
+        }
+
+        public static bool GetKey(int keyId)
+        {
+            return Internals.Input_GetKey(keyId);
         }
 
         public static void SetCursorMode(CursorMode mode)
@@ -31,14 +31,60 @@ namespace WieselEngine
             return false;
         }
 
+        // Called at a fixed rate, independent of the frame rate. Transforms
+        // moved here are interpolated between steps when rendering.
+        public virtual void OnFixedUpdate(float deltaTime)
+        {
+        }
+
+        // Called once per frame for every script class with the enabled
+        // scripts of the class, so native code crosses into managed code once
+        // per class.
+        private static void UpdateAll(MonoBehavior[] instances, int count, float deltaTime)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                try
+                {
+                    instances[i].OnUpdate(deltaTime);
+                }
+                catch (Exception e)
+                {
+                    Debug.Info(e.ToString());
+                }
+            }
+        }
+
+        // Same as UpdateAll, once per fixed step.
+        private static void FixedUpdateAll(MonoBehavior[] instances, int count, float deltaTime)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                try
+                {
+                    instances[i].OnFixedUpdate(deltaTime);
+                }
+                catch (Exception e)
+                {
+                    Debug.Info(e.ToString());
+                }
+            }
+        }
+
+        // Resolved once for every component type.
+        private static class ComponentId<T>
+        {
+            public static readonly int Value = Internals.Behavior_GetComponentId(typeof(T).Name);
+        }
+
         public T GetComponent<T>()
         {
-            return (T)Internals.Behavior_GetComponent(scenePtr, entityId, typeof(T).Name);
+            return (T)Internals.Behavior_GetComponent(scenePtr, entityId, ComponentId<T>.Value);
         }
 
         public bool HasComponent<T>()
         {
-            return Internals.Behavior_HasComponent(scenePtr, entityId, typeof(T).Name);
+            return Internals.Behavior_HasComponent(scenePtr, entityId, ComponentId<T>.Value);
         }
 
     }
@@ -1,16 +1,30 @@
-using System.Runtime.InteropServices;
-using System.Runtime.CompilerServices;
 using System;
 
 namespace WieselEngine
 {
-    public class TransformComponent
+    // Reads and writes the native component in place, accessing it never
+    // crosses into native code or allocates.
+    public unsafe class TransformComponent
     {
+        private static readonly int positionOffset;
+        private static readonly int rotationOffset;
+        private static readonly int scaleOffset;
+        private static readonly int matrixOffset;
+        private static readonly int changedOffset;
+
+        static TransformComponent()
+        {
+            Internals.TransformComponent_GetLayout(out positionOffset, out rotationOffset, out scaleOffset, out matrixOffset, out changedOffset);
+        }
+
         private ulong scenePtr;
         private ulong entityId;
-        private HandledVector3f position;
-        private HandledVector3f rotation;
-        private HandledVector3f scale;
+        // Valid for as long as the native component exists, cleared by the
+        // engine when it is removed.
+        private byte* component;
+        private PointerVector3f position;
+        private PointerVector3f rotation;
+        private PointerVector3f scale;
 
         public Vector3f Position
         {
@@ -20,9 +34,7 @@ namespace WieselEngine
             }
             set
             {
-                position.X = value.X;
-                position.Y = value.Y;
-                position.Z = value.Z;
+                position.Set(value.X, value.Y, value.Z);
             }
         }
 
@@ -34,9 +46,7 @@ namespace WieselEngine
             }
             set
             {
-                rotation.X = value.X;
-                rotation.Y = value.Y;
-                rotation.Z = value.Z;
+                rotation.Set(value.X, value.Y, value.Z);
             }
         }
 
@@ -48,9 +58,7 @@ namespace WieselEngine
             }
             set
             {
-                scale.X = value.X;
-                scale.Y = value.Y;
-                scale.Z = value.Z;
+                scale.Set(value.X, value.Y, value.Z);
             }
         }
 
@@ -58,123 +66,55 @@ namespace WieselEngine
         {
             this.scenePtr = scenePtr;
             this.entityId = entityId;
-            this.position = new HandledVector3f(GetPositionX, SetPositionX, GetPositionY, SetPositionY, GetPositionZ, SetPositionZ);
-            this.rotation = new HandledVector3f(GetRotationX, SetRotationX, GetRotationY, SetRotationY, GetRotationZ, SetRotationZ);
-            this.scale = new HandledVector3f(GetScaleX, SetScaleX, GetScaleY, SetScaleY, GetScaleZ, SetScaleZ);
+            this.component = (byte*) Internals.TransformComponent_GetPointer(scenePtr, entityId);
+            bool* changed = (bool*) (component + changedOffset);
+            this.position = new PointerVector3f((float*) (component + positionOffset), changed);
+            this.rotation = new PointerVector3f((float*) (component + rotationOffset), changed);
+            this.scale = new PointerVector3f((float*) (component + scaleOffset), changed);
         }
 
         public Vector3f GetForward() {
-            return (Vector3f) Internals.TransformComponent_GetForward(scenePtr, entityId);
+            return GetAxis(2, -1.0f);
         }
 
         public Vector3f GetBackward() {
-            return (Vector3f) Internals.TransformComponent_GetBackward(scenePtr, entityId);
+            return GetAxis(2, 1.0f);
         }
 
         public Vector3f GetLeft() {
-            return (Vector3f) Internals.TransformComponent_GetLeft(scenePtr, entityId);
+            return GetAxis(0, -1.0f);
         }
 
         public Vector3f GetRight() {
-            return (Vector3f) Internals.TransformComponent_GetRight(scenePtr, entityId);
+            return GetAxis(0, 1.0f);
         }
 
         public Vector3f GetUp() {
-            return (Vector3f) Internals.TransformComponent_GetUp(scenePtr, entityId);
+            return GetAxis(1, 1.0f);
         }
 
         public Vector3f GetDown() {
-            return (Vector3f) Internals.TransformComponent_GetDown(scenePtr, entityId);
-        }
-
-        private float GetPositionX()
-        {
-            return Internals.TransformComponent_GetPositionX(scenePtr, entityId);
-        }
-
-        private float GetPositionY()
-        {
-            return Internals.TransformComponent_GetPositionY(scenePtr, entityId);
-        }
-
-        private float GetPositionZ()
-        {
-            return Internals.TransformComponent_GetPositionZ(scenePtr, entityId);
-        }
-
-        private void SetPositionX(float x)
-        {
-            Internals.TransformComponent_SetPositionX(scenePtr, entityId, x);
-        }
-
-        private void SetPositionY(float y)
-        {
-            Internals.TransformComponent_SetPositionY(scenePtr, entityId, y);
-        }
-
-        private void SetPositionZ(float z)
-        {
-            Internals.TransformComponent_SetPositionZ(scenePtr, entityId, z);
-        }
-
-        private float GetRotationX()
-        {
-            return Internals.TransformComponent_GetRotationX(scenePtr, entityId);
-        }
-
-        private float GetRotationY()
-        {
-            return Internals.TransformComponent_GetRotationY(scenePtr, entityId);
-        }
-
-        private float GetRotationZ()
-        {
-            return Internals.TransformComponent_GetRotationZ(scenePtr, entityId);
-        }
-
-        private void SetRotationX(float x)
-        {
-            Internals.TransformComponent_SetRotationX(scenePtr, entityId, x);
+            return GetAxis(1, -1.0f);
         }
 
-        private void SetRotationY(float y)
+        // Column of the transform matrix, updated by the scene every frame.
+        private Vector3f GetAxis(int column, float sign)
         {
-            Internals.TransformComponent_SetRotationY(scenePtr, entityId, y);
-        }
-
-        private void SetRotationZ(float z)
-        {
-            Internals.TransformComponent_SetRotationZ(scenePtr, entityId, z);
-        }
-
-        private float GetScaleX()
-        {
-            return Internals.TransformComponent_GetScaleX(scenePtr, entityId);
-        }
-
-        private float GetScaleY()
-        {
-            return Internals.TransformComponent_GetScaleY(scenePtr, entityId);
-        }
-
-        private float GetScaleZ()
-        {
-            return Internals.TransformComponent_GetScaleZ(scenePtr, entityId);
-        }
-
-        private void SetScaleX(float x)
-        {
-            Internals.TransformComponent_SetScaleX(scenePtr, entityId, x);
-        }
-
-        private void SetScaleY(float y)
-        {
-            Internals.TransformComponent_SetScaleY(scenePtr, entityId, y);
+            if (component == null)
+            {
+                throw new ObjectDisposedException(nameof(TransformComponent));
+            }
+            float* matrix = (float*) (component + matrixOffset) + column * 4;
+            return new Vector3f(matrix[0] * sign, matrix[1] * sign, matrix[2] * sign);
         }
 
-        private void SetScaleZ(float z)
+        // Called by the engine once the component or its entity is removed.
+        private void Invalidate()
         {
-            Internals.TransformComponent_SetScaleZ(scenePtr, entityId, z);
+            component = null;
+            position.Invalidate();
+            rotation.Invalidate();
+            scale.Invalidate();
         }
     }
-}
\ No newline at end of file
+}
@@ -11,76 +11,41 @@ namespace WieselEngine
         public static readonly Vector3f Forward = new Vector3f(0, 0, 1);
         public static readonly Vector3f Back = new Vector3f(0, 0, -1);
 
-        protected Func<float> getX;
-        protected Func<float> getY;
-        protected Func<float> getZ;
-        protected Action<float> setX;
-        protected Action<float> setY;
-        protected Action<float> setZ;
-
         private float x = 0.0f;
-        public float X
+        public virtual float X
         {
             get
             {
-                if (getX != null)
-                {
-                    return getX();
-                }
                 return x;
             }
             set
             {
-                if (setX != null)
-                {
-                    setX(value);
-                    return;
-                }
                 x = value;
             }
         }
 
         private float y = 0.0f;
-        public float Y
+        public virtual float Y
         {
             get
             {
-                if (getY != null)
-                {
-                    return getY();
-                }
-
                 return y;
             }
             set
             {
-                if (setY != null)
-                {
-                    setY(value);
-                    return;
-                }
                 y = value;
             }
         }
 
         private float z = 0.0f;
-        public float Z
+        public virtual float Z
         {
             get
             {
-                if (getZ != null)
-                {
-                    return getZ();
-                }
                 return z;
             }
             set
             {
-                if (setZ != null)
-                {
-                    setZ(value);
-                    return;
-                }
                 z = value;
             }
         }
@@ -171,16 +136,89 @@ namespace WieselEngine
         }
     }
 
-    public class HandledVector3f : Vector3f
+    // Reads and writes three floats owned by native code, writes flag the
+    // owner as changed.
+    public unsafe class PointerVector3f : Vector3f
     {
-        public HandledVector3f(Func<float> getX, Action<float> setX, Func<float> getY, Action<float> setY, Func<float> getZ, Action<float> setZ)
+        private float* values;
+        private bool* changed;
+
+        public PointerVector3f(float* values, bool* changed)
+        {
+            this.values = values;
+            this.changed = changed;
+        }
+
+        public override float X
+        {
+            get
+            {
+                Check();
+                return values[0];
+            }
+            set
+            {
+                Set(0, value);
+            }
+        }
+
+        public override float Y
+        {
+            get
+            {
+                Check();
+                return values[1];
+            }
+            set
+            {
+                Set(1, value);
+            }
+        }
+
+        public override float Z
+        {
+            get
+            {
+                Check();
+                return values[2];
+            }
+            set
+            {
+                Set(2, value);
+            }
+        }
+
+        public void Set(float x, float y, float z)
         {
-            this.getX = getX;
-            this.setX = setX;
-            this.getY = getY;
-            this.setY = setY;
-            this.getZ = getZ;
-            this.setZ = setZ;
+            Set(0, x);
+            Set(1, y);
+            Set(2, z);
+        }
+
+        // The owner was removed, the memory may already be reused.
+        internal void Invalidate()
+        {
+            values = null;
+            changed = null;
+        }
+
+        private void Check()
+        {
+            if (values == null)
+            {
+                throw new ObjectDisposedException(nameof(PointerVector3f));
+            }
+        }
+
+        private void Set(int index, float value)
+        {
+            Check();
+            if (values[index] == value)
+            {
+                return;
+            }
+            values[index] = value;
+            *changed = true;
         }
     }
 
@@ -68,12 +68,11 @@ layout(location = 7) in vec3 inViewDir;
 layout(location = 8) in vec3 inViewPos;
 layout(location = 9) in mat3 inTBN;
 
-layout(location = 0) out vec4 outViewPos;
-layout(location = 1) out vec4 outWorldPos;
-layout(location = 2) out float outDepth;
-layout(location = 3) out vec4 outNormal;
-layout(location = 4) out vec4 outAlbedo;
-layout(location = 5) out vec4 outMaterial;
+// Positions are reconstructed from the linear depth.
+layout(location = 0) out float outDepth;
+layout(location = 1) out vec2 outNormal; // octahedral
+layout(location = 2) out vec4 outAlbedo;
+layout(location = 3) out vec4 outMaterial;
 
 
 vec3 getSurfaceNormal() {
@@ -88,9 +87,15 @@ vec3 getSurfaceNormal() {
     return normal;
 }
 
-float linearDepth(float depth) {
-    float z = depth * 2.0f - 1.0f;
-    return (2.0f * cam.near * cam.far) / (cam.far + cam.near - z * (cam.far - cam.near));
+vec2 octWrap(vec2 v) {
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Maps the unit sphere onto [-1, 1]^2.
+vec2 encodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    n.xy = n.z >= 0.0 ? n.xy : octWrap(n.xy);
+    return n.xy;
 }
 
 void main() {
@@ -124,10 +129,9 @@ void main() {
     }
     vec3 normal = getSurfaceNormal();
 
-    outViewPos = vec4(inViewPos, 1.0);
-    outDepth = linearDepth(gl_FragCoord.z);
-    outWorldPos = vec4(inWorldPos, 1.0);
-    outNormal = vec4(normal, 1.0);
+    // Distance along the view direction, the camera looks down -z.
+    outDepth = -inViewPos.z;
+    outNormal = encodeNormal(normalize(normal));
     outAlbedo = vec4(inColor, 1.0f) * baseColor;
     outMaterial = vec4(specular, roughness, metallic, 0);
     /*switch(cascadeIndex) {
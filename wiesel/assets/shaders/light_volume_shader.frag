@@ -0,0 +1,194 @@
+#version 450
+
+// Keep in sync with w_utils.hpp.
+#define MAX_POINT_SHADOWS 32
+
+layout(set = 0, binding = 0) uniform sampler2D samplerDepth;
+layout(set = 0, binding = 1) uniform sampler2D samplerNormal;
+layout(set = 0, binding = 2) uniform sampler2D samplerAlbedo;
+layout(set = 0, binding = 3) uniform sampler2D samplerMaterial;
+layout(set = 1, binding = 0) uniform sampler2D samplerSSAO;
+
+struct LightBase {
+    vec3 position;
+    float _pad0;
+    vec3 color;
+    float _pad1;
+    float ambient;
+    float diffuse;
+    float specular;
+    float density;
+};
+
+struct LightPoint {
+    LightBase base;
+
+    float constant;
+    float linear;
+    float exp;
+    float radius;
+    // -1 when the light has no shadow.
+    int shadowIndex;
+};
+
+layout(set = 2, binding = 1, std140) uniform Camera {
+    mat4 viewMatrix;
+    mat4 projection;
+    mat4 invProjection;
+    vec3 position;
+    float _pad0;
+    float near;
+    float far;
+    vec4 cascadeSplits;
+    int enableSSAO;
+    int enableLightVolumes;
+    mat4 invViewMatrix;
+} cam;
+
+layout(set = 2, binding = 4, std430) readonly buffer PointLights {
+    uint count;
+    LightPoint lights[];
+} pointLights;
+
+// Keep in sync with PointShadowData in w_utils.hpp, faces are in +x, -x, +y,
+// -y, +z, -z order.
+struct PointShadow {
+    mat4 viewProjection[6];
+    // Offset in xy and size in zw, in atlas uv.
+    vec4 atlasRects[6];
+};
+
+layout(set = 2, binding = 7, std430) readonly buffer PointShadows {
+    PointShadow shadows[MAX_POINT_SHADOWS];
+} pointShadows;
+
+// Cube faces of the shadow casting point lights, in tiles of varying size.
+layout(set = 2, binding = 8) uniform sampler2D shadowAtlas;
+
+layout(location = 0) in vec2 inUV;
+layout(location = 1) flat in uint inLightIndex;
+
+layout(location = 0) out vec4 outFragColor;
+
+uint getCubeFace(vec3 dir) {
+    vec3 a = abs(dir);
+    if (a.x >= a.y && a.x >= a.z) {
+        return dir.x > 0.0 ? 0u : 1u;
+    }
+    if (a.y >= a.z) {
+        return dir.y > 0.0 ? 2u : 3u;
+    }
+    return dir.z > 0.0 ? 4u : 5u;
+}
+
+float calculatePointShadow(int shadowIndex, vec3 lightPos, vec3 worldPos, vec3 normal) {
+    if (shadowIndex < 0) {
+        return 1.0;
+    }
+    uint face = getCubeFace(worldPos - lightPos);
+    // Pushed along the normal so surfaces facing the light don't shadow themselves.
+    vec4 shadowCoord = pointShadows.shadows[shadowIndex].viewProjection[face] * vec4(worldPos + normal * 0.02, 1.0);
+    shadowCoord /= shadowCoord.w;
+    if (shadowCoord.z < 0.0 || shadowCoord.z > 1.0) {
+        return 1.0;
+    }
+    vec4 rect = pointShadows.shadows[shadowIndex].atlasRects[face];
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    // The neighbouring tiles belong to other faces, samples stay inside this one.
+    vec2 minUV = rect.xy + texelSize * 1.5;
+    vec2 maxUV = rect.xy + rect.zw - texelSize * 1.5;
+    vec2 uv = rect.xy + (shadowCoord.xy * 0.5 + 0.5) * rect.zw;
+    float bias = 0.0005;
+    float shadow = 0.0;
+    for (int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y) {
+            vec2 pcfUV = clamp(uv + vec2(x, y) * texelSize, minUV, maxUV);
+            shadow += (shadowCoord.z - bias > texture(shadowAtlas, pcfUV).r) ? 1.0 : 0.0;
+        }
+    }
+    return 1.0 - shadow / 9.0;
+}
+
+vec3 decodeNormal(vec2 e) {
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+// View space position from the linear depth, on the ray through the pixel.
+vec3 reconstructViewPos(vec2 uv, float linearDepth) {
+    vec4 vd = cam.invProjection * vec4(uv * 2.0 - 1.0, 1.0, 1.0);
+    vec3 ray = vd.xyz / vd.w;
+    return ray * (linearDepth / -ray.z);
+}
+
+// Ssao is computed at half resolution, blends the four nearest texels with
+// bilinear weights that fall off with the depth difference so occlusion
+// doesn't bleed over edges.
+float upsampleSSAO(vec2 uv, float linearDepth) {
+    vec2 ssaoSize = vec2(textureSize(samplerSSAO, 0));
+    vec2 pos = uv * ssaoSize - 0.5;
+    ivec2 base = ivec2(floor(pos));
+    vec2 f = pos - vec2(base);
+    float bilinear[4] = float[](
+        (1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y),
+        (1.0 - f.x) * f.y, f.x * f.y);
+    float result = 0.0;
+    float totalWeight = 0.0;
+    for (int i = 0; i < 4; i++) {
+        ivec2 texel = clamp(base + ivec2(i & 1, i >> 1), ivec2(0), ivec2(ssaoSize) - 1);
+        // The depth the ao of this texel was computed with.
+        float sampleDepth = texture(samplerDepth, (vec2(texel) + 0.5) / ssaoSize).r;
+        float weight = bilinear[i] / (abs(linearDepth - sampleDepth) / max(linearDepth, 1e-4) + 1e-3);
+        result += texelFetch(samplerSSAO, texel, 0).r * weight;
+        totalWeight += weight;
+    }
+    return result / totalWeight;
+}
+
+void main() {
+    vec4 albedo = texture(samplerAlbedo, inUV);
+    if (albedo.a < 0.5) {
+        discard;
+    }
+    float linearDepth = texture(samplerDepth, inUV).r;
+    vec3 viewPos = reconstructViewPos(inUV, linearDepth);
+    vec3 worldPos = (cam.invViewMatrix * vec4(viewPos, 1.0)).xyz;
+
+    LightPoint light = pointLights.lights[inLightIndex];
+    float distance = length(light.base.position - worldPos);
+    if (distance > light.radius) {
+        discard;
+    }
+
+    vec3 normal = decodeNormal(texture(samplerNormal, inUV).rg);
+    float ambientOcclusion;
+    if (cam.enableSSAO != 0) {
+        ambientOcclusion = upsampleSSAO(inUV, linearDepth);
+    } else {
+        ambientOcclusion = 1.0f;
+    }
+    vec3 viewDir = normalize(cam.position - worldPos);
+    vec3 lightDir = normalize(light.base.position - worldPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.exp * distance * distance);
+
+    float lightAmbient = light.base.ambient * attenuation;
+    float lightDiffuse = light.base.diffuse * max(dot(normal, lightDir), 0.0) * attenuation;
+    if (lightDiffuse > 0.0) {
+        lightDiffuse *= calculatePointShadow(light.shadowIndex, light.base.position, worldPos, normal);
+    }
+
+    float lightSpecular = 0.0;
+    if (lightDiffuse > 0.0) {
+        vec3 halfwayDir = normalize(lightDir + viewDir);
+        float shininess = 32.0;
+        lightSpecular = pow(max(dot(normal, halfwayDir), 0.0), shininess) * light.base.specular * attenuation;
+    }
+
+    vec3 specularColor = vec3(1.0); // White specular color
+    vec3 result = (lightAmbient * albedo.rgb * ambientOcclusion + lightDiffuse * albedo.rgb + lightSpecular * specularColor) * light.base.color * light.base.density;
+    // Added on top of the lighting pass, alpha is kept.
+    outFragColor = vec4(result, 0.0);
+}
@@ -0,0 +1,87 @@
+#version 450
+
+struct LightBase {
+    vec3 position;
+    float _pad0;
+    vec3 color;
+    float _pad1;
+    float ambient;
+    float diffuse;
+    float specular;
+    float density;
+};
+
+struct LightPoint {
+    LightBase base;
+
+    float constant;
+    float linear;
+    float exp;
+    float radius;
+    // -1 when the light has no shadow.
+    int shadowIndex;
+};
+
+layout(set = 2, binding = 1, std140) uniform Camera {
+    mat4 viewMatrix;
+    mat4 projection;
+    mat4 invProjection;
+    vec3 position;
+    float _pad0;
+    float near;
+    float far;
+    vec4 cascadeSplits;
+    int enableSSAO;
+    int enableLightVolumes;
+    mat4 invViewMatrix;
+} cam;
+
+layout(set = 2, binding = 4, std430) readonly buffer PointLights {
+    uint count;
+    LightPoint lights[];
+} pointLights;
+
+layout(location = 0) out vec2 outUV;
+layout(location = 1) flat out uint outLightIndex;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+const vec2 corners[6] = vec2[](
+    vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+    vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0)
+);
+
+void main() {
+    LightPoint light = pointLights.lights[gl_InstanceIndex];
+    vec3 center = (cam.viewMatrix * vec4(light.base.position, 1.0)).xyz;
+    float radius = light.radius;
+
+    vec2 rectMin = vec2(-1.0);
+    vec2 rectMax = vec2(1.0);
+    if (-center.z + radius < cam.near || -center.z - radius > cam.far) {
+        // Outside of the view depth range, nothing to draw.
+        rectMax = rectMin;
+    } else if (-center.z - radius > cam.near) {
+        // Bound the projected corners of the cube around the light. Lights
+        // that cross the near plane keep the whole screen.
+        rectMin = vec2(1.0);
+        rectMax = vec2(-1.0);
+        for (int i = 0; i < 8; i++) {
+            vec3 offset = vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+            vec4 clip = cam.projection * vec4(center + offset * radius, 1.0);
+            vec2 ndc = clip.xy / clip.w;
+            rectMin = min(rectMin, ndc);
+            rectMax = max(rectMax, ndc);
+        }
+        rectMin = clamp(rectMin, -1.0, 1.0);
+        rectMax = clamp(rectMax, -1.0, 1.0);
+    }
+
+    vec2 pos = mix(rectMin, rectMax, corners[gl_VertexIndex]);
+    outUV = pos * 0.5 + 0.5;
+    outLightIndex = gl_InstanceIndex;
+    gl_Position = vec4(pos, 0.0, 1.0);
+}
@@ -1,20 +1,13 @@
 #version 450
 
-// todo: pass via specialization constant
-#define SHADOW_MAP_CASCADE_COUNT 4
-
 layout(set = 0, binding = 0, std140) uniform Matrices {
     mat4 modelMatrix;
     mat3 normalMatrix;
 } obj;
 
-layout(set = 1, binding = 0, std140) uniform ShadowMapMatrices {
-    mat4 viewProjectionMatrix[SHADOW_MAP_CASCADE_COUNT];
-    int enableShadows;
-} shadowMatrices;
-
+// Matrix of the cascade or the point light cube face being drawn.
 layout(push_constant) uniform Push {
-    int cascadeIndex;
+    mat4 viewProjectionMatrix;
 };
 
 layout(location = 0) in vec3 inVertexPosition;
@@ -34,5 +27,5 @@ void main() {
 	outFlags = inFlags;
     vec4 worldPos4 = obj.modelMatrix * vec4(inVertexPosition, 1.0);
     // lightViewProj is projection * viewMatrix of the light
-    gl_Position = shadowMatrices.viewProjectionMatrix[cascadeIndex] * worldPos4;
+    gl_Position = viewProjectionMatrix * worldPos4;
 }
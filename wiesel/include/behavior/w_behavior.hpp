@@ -35,6 +35,7 @@ class IBehavior {
   virtual ~IBehavior() {}
 
   virtual void OnUpdate(float_t deltaTime);
+  virtual void OnFixedUpdate(float_t timeStep);
   virtual void OnEvent(Event& event);
 
   template <typename T, typename... Args>
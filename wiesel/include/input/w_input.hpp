@@ -27,8 +27,14 @@ enum InputMode { InputModeKeyboardAndMouse, InputModeGamepad };
 
 class InputManager {
  public:
+  // Keys and axes are looked up by name once, their ids index flat arrays.
+  // Unknown keys get -1, unknown axes are created.
+  static int32_t GetKeyId(const std::string& key);
+  static int32_t GetAxisId(const std::string& axisName);
+  static bool GetKey(int32_t keyId);
   static bool GetKey(const std::string& key);
   static bool IsPressed(KeyCode keyCode);
+  static float GetAxis(int32_t axisId);
   static float GetAxis(const std::string& axisName);
 
   static int GetMouseX() { return m_MouseX; }
@@ -40,11 +46,18 @@ class InputManager {
  private:
   friend class Application;
 
-  // todo maybe can be improved?
-  static std::map<std::string, std::vector<KeyCode>> m_KeyboardMapping;
-  static std::map<KeyCode, KeyData> m_Keys;
+  static void AddMapping(const std::string& name, std::vector<KeyCode> keys);
+  static void SetPressed(KeyCode keyCode, bool pressed);
+  static float& Axis(const std::string& axisName) {
+    return m_Axes[GetAxisId(axisName)];
+  }
+
+  static std::map<std::string, int32_t> m_KeyIds;
+  static std::vector<std::vector<KeyCode>> m_KeyboardMapping;
+  static std::array<KeyData, KeyMenu + 1> m_Keys;
   static std::map<MouseCode, KeyData> m_MouseButtons;
-  static std::map<std::string, float> m_Axis;
+  static std::map<std::string, int32_t> m_AxisIds;
+  static std::vector<float> m_Axes;
   static int m_MouseX;
   static int m_MouseY;
   static float m_MouseAxisSensX;
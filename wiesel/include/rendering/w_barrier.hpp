@@ -0,0 +1,81 @@
+//
+//    Copyright 2023 Metehan Gezer
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+#include "rendering/w_command.hpp"
+#include "util/w_utils.hpp"
+#include "w_pch.hpp"
+
+namespace Wiesel {
+
+class AttachmentTexture;
+
+/*
+ * Collects memory, buffer and image barriers and records them with a single
+ * vkCmdPipelineBarrier. The stage masks are the union of the stages of the
+ * added barriers, so only add barriers that are needed at the same point.
+ */
+class BarrierBatch {
+ public:
+  BarrierBatch() = default;
+
+  void AddImageBarrier(VkImage image, VkImageAspectFlags aspectFlags,
+                       VkImageLayout oldLayout, VkImageLayout newLayout,
+                       VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess,
+                       uint32_t baseLayer = 0, uint32_t layerCount = 1);
+  // Picks the aspects from the texture, depth stencil formats get both.
+  void AddImageBarrier(const AttachmentTexture& texture,
+                       VkImageLayout oldLayout, VkImageLayout newLayout,
+                       VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess,
+                       uint32_t layerCount = 1);
+  void AddBufferBarrier(VkBuffer buffer, VkPipelineStageFlags srcStages,
+                        VkAccessFlags srcAccess,
+                        VkPipelineStageFlags dstStages,
+                        VkAccessFlags dstAccess, VkDeviceSize offset = 0,
+                        VkDeviceSize size = VK_WHOLE_SIZE);
+  // Global memory dependency, every call is merged into one VkMemoryBarrier.
+  void AddMemoryBarrier(VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                        VkPipelineStageFlags dstStages,
+                        VkAccessFlags dstAccess);
+
+  // Records the batch without clearing it, batches that are built once can be
+  // recorded every frame.
+  void Record(VkCommandBuffer commandBuffer) const;
+  void Record(const CommandBuffer& commandBuffer) const;
+  void Flush(VkCommandBuffer commandBuffer);
+  void Flush(const CommandBuffer& commandBuffer);
+  void Clear();
+
+  WIESEL_GETTER_FN bool IsEmpty() const;
+  WIESEL_GETTER_FN size_t GetImageBarrierCount() const {
+    return m_ImageBarriers.size();
+  }
+  WIESEL_GETTER_FN size_t GetBufferBarrierCount() const {
+    return m_BufferBarriers.size();
+  }
+  WIESEL_GETTER_FN bool HasMemoryBarrier() const { return m_HasMemoryBarrier; }
+
+ private:
+  void AddStages(VkPipelineStageFlags srcStages,
+                 VkPipelineStageFlags dstStages);
+
+ private:
+  VkPipelineStageFlags m_SrcStages = 0;
+  VkPipelineStageFlags m_DstStages = 0;
+  bool m_HasMemoryBarrier = false;
+  VkMemoryBarrier m_MemoryBarrier{};
+  std::vector<VkBufferMemoryBarrier> m_BufferBarriers;
+  std::vector<VkImageMemoryBarrier> m_ImageBarriers;
+};
+
+}  // namespace Wiesel
@@ -18,7 +18,8 @@ namespace Wiesel {
 enum MemoryType {
   MemoryTypeVertexBuffer,
   MemoryTypeIndexBuffer,
-  MemoryTypeUniformBuffer
+  MemoryTypeUniformBuffer,
+  MemoryTypeStorageBuffer
 };
 
 class MemoryBuffer {
@@ -48,4 +49,13 @@ class UniformBuffer : public MemoryBuffer {
   void* m_Data;
 };
 
+class StorageBuffer : public MemoryBuffer {
+ public:
+  StorageBuffer();
+  ~StorageBuffer() override;
+
+  // Null if the buffer is only accessed by the gpu.
+  void* m_Data;
+};
+
 }  // namespace Wiesel
\ No newline at end of file
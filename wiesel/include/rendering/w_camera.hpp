@@ -22,10 +22,22 @@ namespace Wiesel {
 
 struct FrustumPlanes {
   glm::vec4 Left, Right, Bottom, Top, Near, Far;
+
+  // Planes face inwards, with normalized normals.
+  static FrustumPlanes FromMatrix(const glm::mat4& viewProjection);
+  // Conservative, spheres just outside a corner still pass.
+  WIESEL_GETTER_FN bool IntersectsSphere(const glm::vec3& center,
+                                         float radius) const;
 };
 struct Cascade {
   float SplitDepth;
   glm::mat4 ViewProjMatrix;
+  // Bounding sphere the matrix was fitted to, the cascade is kept while the
+  // slice of the view frustum stays inside it.
+  glm::vec3 Center = glm::vec3(0.0f);
+  float Radius = 0.0f;
+  // The cached static casters of this cascade have to be redrawn.
+  bool IsStaticDirty = true;
 };
 
 struct CameraComponent {
@@ -55,10 +67,6 @@ struct CameraComponent {
   Ref<AttachmentTexture> GeometryDepthResolveImage;
   Ref<AttachmentTexture> GeometryAlbedoImage;
   Ref<AttachmentTexture> GeometryAlbedoResolveImage;
-  Ref<AttachmentTexture> GeometryViewPosImage;
-  Ref<AttachmentTexture> GeometryViewPosResolveImage;
-  Ref<AttachmentTexture> GeometryWorldPosImage;
-  Ref<AttachmentTexture> GeometryWorldPosResolveImage;
   Ref<AttachmentTexture> GeometryMaterialImage;
   Ref<AttachmentTexture> GeometryMaterialResolveImage;
   Ref<AttachmentTexture> GeometryDepthStencil;
@@ -78,8 +86,6 @@ struct CameraComponent {
   Ref<Framebuffer> IDFramebuffer;
 #endif
   Ref<Framebuffer> GeometryFramebuffer;
-  Ref<Framebuffer> SSAOGenFramebuffer;
-  Ref<Framebuffer> SSAOBlurFramebuffer;
   Ref<Framebuffer> LightingFramebuffer;
   Ref<Framebuffer> SpriteFramebuffer;
   Ref<Framebuffer> CompositeFramebuffer;
@@ -88,20 +94,35 @@ struct CameraComponent {
 
   Ref<DescriptorSet> GeometryOutputDescriptor;
   Ref<DescriptorSet> SSAOOutputDescriptor;
-  Ref<DescriptorSet> SSAOBlurOutputDescriptor;
   Ref<DescriptorSet> LightingOutputDescriptor;
   Ref<DescriptorSet> SpriteOutputDescriptor;
   Ref<DescriptorSet> CompositeOutputDescriptor;
   Ref<DescriptorSet> SSAOGenDescriptor;
+  Ref<DescriptorSet> SSAOBlurHorizontalDescriptor;
+  Ref<DescriptorSet> SSAOBlurVerticalDescriptor;
   FrustumPlanes Planes;
 
   // Shadow stuff
   bool DoesShadowPass = false;
-  std::array<Cascade, WIESEL_SHADOW_CASCADE_COUNT> ShadowMapCascades;
+  std::array<Cascade, WIESEL_SHADOW_MAX_CASCADE_COUNT> ShadowMapCascades;
   Ref<AttachmentTexture> ShadowDepthStencil;
-  std::array<Ref<ImageView>, WIESEL_SHADOW_CASCADE_COUNT> ShadowDepthViews;
+  std::array<Ref<ImageView>, WIESEL_SHADOW_MAX_CASCADE_COUNT> ShadowDepthViews;
   Ref<ImageView> ShadowDepthViewArray;
-  std::array<Ref<Framebuffer>, WIESEL_SHADOW_CASCADE_COUNT> ShadowFramebuffers;
+  std::array<Ref<Framebuffer>, WIESEL_SHADOW_MAX_CASCADE_COUNT> ShadowFramebuffers;
+  // Static casters, only redrawn for the cascades that are dirty. The shadow
+  // map above holds the dynamic casters and is redrawn every frame.
+  Ref<AttachmentTexture> ShadowStaticDepthStencil;
+  std::array<Ref<ImageView>, WIESEL_SHADOW_MAX_CASCADE_COUNT> ShadowStaticDepthViews;
+  Ref<ImageView> ShadowStaticDepthViewArray;
+  std::array<Ref<Framebuffer>, WIESEL_SHADOW_MAX_CASCADE_COUNT>
+      ShadowStaticFramebuffers;
+  // Shadow settings the resources above were created with, only the first
+  // ShadowCascadeCount cascades are used.
+  uint32_t ShadowCascadeCount = 0;
+  uint32_t ShadowMapResolution = 0;
+  // Renderer's shadow resources version the resources above and the global
+  // descriptor were created with.
+  uint32_t ShadowResourcesVersion = 0;
 
   glm::vec3 PreviousLightDir;
   bool ForceLightReset = false;
@@ -115,6 +136,8 @@ struct CameraComponent {
   void UpdateAll();
 
   void ComputeCascades(const glm::vec3& lightDir);
+  // Static casters moved, every cascade redraws its cached shadow map.
+  void InvalidateStaticShadows();
   void ExtractFrustumPlanes();
 
 };
@@ -130,6 +153,7 @@ struct CameraData {
   glm::mat4 ViewMatrix;
   glm::mat4 Projection;
   glm::mat4 InvProjection;
+  glm::mat4 InvViewMatrix;
   glm::vec2 ViewportSize;
   float NearPlane = 0.1f;
   float FarPlane = 1000.0f;
@@ -138,10 +162,6 @@ struct CameraData {
   Ref<AttachmentTexture> GeometryNormalResolveImage;
   Ref<AttachmentTexture> GeometryAlbedoImage;
   Ref<AttachmentTexture> GeometryAlbedoResolveImage;
-  Ref<AttachmentTexture> GeometryViewPosImage;
-  Ref<AttachmentTexture> GeometryViewPosResolveImage;
-  Ref<AttachmentTexture> GeometryWorldPosImage;
-  Ref<AttachmentTexture> GeometryWorldPosResolveImage;
   Ref<AttachmentTexture> GeometryDepthImage;
   Ref<AttachmentTexture> GeometryDepthResolveImage;
   Ref<AttachmentTexture> GeometryDepthStencil;
@@ -160,28 +180,32 @@ struct CameraData {
   Ref<AttachmentTexture> CompositeColorResolveImage;
 
   Ref<Framebuffer> GeometryFramebuffer;
-  Ref<Framebuffer> SSAOGenFramebuffer;
-  Ref<Framebuffer> SSAOBlurFramebuffer;
   Ref<Framebuffer> LightingFramebuffer;
   Ref<Framebuffer> SpriteFramebuffer;
   Ref<Framebuffer> CompositeFramebuffer;
   Ref<DescriptorSet> GlobalDescriptor; // to draw geometry
   Ref<DescriptorSet> ShadowDescriptor; // to draw geometry to shadow pass
   Ref<DescriptorSet> GeometryOutputDescriptor; // to draw geometry pass output
-  Ref<DescriptorSet> SSAOOutputDescriptor; // to draw ssao pass output
-  Ref<DescriptorSet> SSAOBlurOutputDescriptor; // to draw ssao blur pass output
+  Ref<DescriptorSet> SSAOOutputDescriptor; // to draw blurred ssao output
   Ref<DescriptorSet> LightingOutputDescriptor; // to draw lighting pass output
   Ref<DescriptorSet> SpriteOutputDescriptor; // to draw sprite pass output
   Ref<DescriptorSet> CompositeOutputDescriptor; // to draw composite pass output
   Ref<DescriptorSet>
-      SSAOGenDescriptor; // used to render geometry pass output to ssao pass
+      SSAOGenDescriptor; // used to compute ssao from geometry pass output
+  Ref<DescriptorSet> SSAOBlurHorizontalDescriptor; // ssao -> ssao blur
+  Ref<DescriptorSet> SSAOBlurVerticalDescriptor; // ssao blur -> ssao
   FrustumPlanes Planes;
 
   // Shadow stuff
   bool DoesShadowPass = false;
-  std::array<Cascade, WIESEL_SHADOW_CASCADE_COUNT> ShadowMapCascades;
+  std::array<Cascade, WIESEL_SHADOW_MAX_CASCADE_COUNT> ShadowMapCascades;
   Ref<AttachmentTexture> ShadowDepthStencil;
-  std::array<Ref<Framebuffer>, WIESEL_SHADOW_CASCADE_COUNT> ShadowFramebuffers;
+  std::array<Ref<Framebuffer>, WIESEL_SHADOW_MAX_CASCADE_COUNT> ShadowFramebuffers;
+  Ref<AttachmentTexture> ShadowStaticDepthStencil;
+  std::array<Ref<Framebuffer>, WIESEL_SHADOW_MAX_CASCADE_COUNT>
+      ShadowStaticFramebuffers;
+  uint32_t ShadowCascadeCount = 0;
+  uint32_t ShadowMapResolution = 0;
 
   void TransferFrom(CameraComponent& camera, TransformComponent& transform) {
     // Perhaps we could do this differently?
@@ -191,6 +215,7 @@ struct CameraData {
     ViewMatrix = camera.ViewMatrix;
     Projection = camera.Projection;
     InvProjection = camera.InvProjection;
+    InvViewMatrix = camera.InvViewMatrix;
     ViewportSize = camera.ViewportSize;
     NearPlane = camera.NearPlane;
     FarPlane = camera.FarPlane;
@@ -199,10 +224,6 @@ struct CameraData {
     GeometryNormalResolveImage = camera.GeometryNormalResolveImage;
     GeometryAlbedoImage = camera.GeometryAlbedoImage;
     GeometryAlbedoResolveImage = camera.GeometryAlbedoResolveImage;
-    GeometryViewPosImage = camera.GeometryViewPosImage;
-    GeometryViewPosResolveImage = camera.GeometryViewPosResolveImage;
-    GeometryWorldPosImage = camera.GeometryWorldPosImage;
-    GeometryWorldPosResolveImage = camera.GeometryWorldPosResolveImage;
     GeometryDepthImage = camera.GeometryDepthImage;
     GeometryDepthResolveImage = camera.GeometryDepthResolveImage;
     GeometryDepthStencil = camera.GeometryDepthStencil;
@@ -221,8 +242,6 @@ struct CameraData {
     CompositeColorResolveImage = camera.CompositeColorResolveImage;
 
     GeometryFramebuffer = camera.GeometryFramebuffer;
-    SSAOGenFramebuffer = camera.SSAOGenFramebuffer;
-    SSAOBlurFramebuffer = camera.SSAOBlurFramebuffer;
     LightingFramebuffer = camera.LightingFramebuffer;
     SpriteFramebuffer = camera.SpriteFramebuffer;
     CompositeFramebuffer = camera.CompositeFramebuffer;
@@ -230,17 +249,22 @@ struct CameraData {
     ShadowDescriptor = camera.ShadowDescriptor;
     GeometryOutputDescriptor = camera.GeometryOutputDescriptor;
     SSAOOutputDescriptor = camera.SSAOOutputDescriptor;
-    SSAOBlurOutputDescriptor = camera.SSAOBlurOutputDescriptor;
     LightingOutputDescriptor = camera.LightingOutputDescriptor;
     SpriteOutputDescriptor = camera.SpriteOutputDescriptor;
     CompositeOutputDescriptor = camera.CompositeOutputDescriptor;
     SSAOGenDescriptor = camera.SSAOGenDescriptor;
+    SSAOBlurHorizontalDescriptor = camera.SSAOBlurHorizontalDescriptor;
+    SSAOBlurVerticalDescriptor = camera.SSAOBlurVerticalDescriptor;
     Planes = camera.Planes;
 
     DoesShadowPass = camera.DoesShadowPass;
     ShadowMapCascades = camera.ShadowMapCascades;
     ShadowDepthStencil = camera.ShadowDepthStencil;
     ShadowFramebuffers = camera.ShadowFramebuffers;
+    ShadowStaticDepthStencil = camera.ShadowStaticDepthStencil;
+    ShadowStaticFramebuffers = camera.ShadowStaticFramebuffers;
+    ShadowCascadeCount = camera.ShadowCascadeCount;
+    ShadowMapResolution = camera.ShadowMapResolution;
   }
 
 };
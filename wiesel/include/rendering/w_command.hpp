@@ -11,32 +11,43 @@
 namespace Wiesel {
 
 class CommandBuffer;
+class Framebuffer;
+class RenderPass;
 
+// Command pools are not thread safe, a pool and the buffers created from it
+// must only be used by one thread at a time.
 class CommandPool {
  public:
   CommandPool();
   ~CommandPool();
 
-  Ref<CommandBuffer> CreateBuffer();
+  Ref<CommandBuffer> CreateBuffer(
+      VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 
   VkCommandPool m_Handle{};
  private:
   friend class CommandBuffer;
-  void ReturnBuffer(VkCommandBuffer buffer);
+  void ReturnBuffer(VkCommandBuffer buffer, VkCommandBufferLevel level);
 
   std::list<VkCommandBuffer> m_FreeBuffers;
+  std::list<VkCommandBuffer> m_FreeSecondaryBuffers;
 };
 
 class CommandBuffer {
  public:
-  CommandBuffer(CommandPool& pool, VkCommandBuffer m_CommandBuffer);
+  CommandBuffer(CommandPool& pool, VkCommandBuffer m_CommandBuffer,
+                VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
   ~CommandBuffer();
 
   void Reset();
   void Begin();
+  // Begins a secondary buffer that continues the given render pass, it can
+  // only be executed inside that pass.
+  void Begin(const RenderPass& renderPass, const Framebuffer& framebuffer);
   void End();
 
   VkCommandBuffer m_Handle;
+  VkCommandBufferLevel m_Level;
  private:
   CommandPool& m_Pool;
 
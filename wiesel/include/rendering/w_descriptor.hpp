@@ -18,6 +18,7 @@
 
 namespace Wiesel {
 class UniformBuffer;
+class StorageBuffer;
 class ImageView;
 class DescriptorSetLayout;
 
@@ -45,6 +46,21 @@ class DescriptorSet {
     });
   }
 
+  void AddStorageBuffer(uint32_t dstBinding, Ref<StorageBuffer> ssbo) {
+    m_StorageBufferData.push_back({
+        .DstBinding = dstBinding,
+        .Ssbo = ssbo
+    });
+  }
+
+  // Storage images are always accessed in the general layout.
+  void AddStorageImage(uint32_t dstBinding, Ref<ImageView> view) {
+    m_StorageImages.push_back({
+        .DstBinding = dstBinding,
+        .ImageView = view
+    });
+  }
+
   void Bake();
 
   bool m_Allocated;
@@ -57,11 +73,21 @@ class DescriptorSet {
     Ref<ImageView> ImageView;
     Ref<Sampler> Sampler;
   };
+  struct StorageImageData {
+    uint32_t DstBinding;
+    Ref<ImageView> ImageView;
+  };
   struct UniformBufferData {
     uint32_t DstBinding;
     Ref<UniformBuffer> Ubo;
   };
+  struct StorageBufferData {
+    uint32_t DstBinding;
+    Ref<StorageBuffer> Ssbo;
+  };
   std::vector<CombinedImageSamplerData> m_CombinedImageSamplers;
+  std::vector<StorageImageData> m_StorageImages;
   std::vector<UniformBufferData> m_UniformBufferData;
+  std::vector<StorageBufferData> m_StorageBufferData;
 };
 }  // namespace Wiesel
\ No newline at end of file
@@ -37,6 +37,9 @@ struct Mesh {
   std::vector<Vertex3D> Vertices;
   std::vector<Index> Indices;
   std::string ModelPath;
+  // Sphere around the vertices in model space, computed by Allocate.
+  glm::vec3 BoundsCenter{0.0f};
+  float BoundsRadius = 0.0f;
 
   bool IsAllocated;
   // Render Data
@@ -59,6 +62,9 @@ struct Model {
   std::string TexturesPath;
   std::map<std::string, Ref<Texture>> Textures;
   bool ReceiveShadows = true;  // todo shadows
+  // Static models are drawn into the cached shadow cascades, which are only
+  // redrawn when one of them moves.
+  bool IsStatic = false;
 };
 
 struct ModelComponent : public IComponent {
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include "rendering/w_command.hpp"
 #include "rendering/w_renderpass.hpp"
 #include "util/w_utils.hpp"
 #include "w_descriptorlayout.hpp"
@@ -27,6 +28,9 @@ struct PipelineProperties {
   bool m_EnableAlphaBlending;
   bool m_EnableDepthTest = true;
   bool m_EnableDepthWrite = true;
+  // Adds the color to the attachment and keeps its alpha, replaces alpha
+  // blending.
+  bool m_EnableAdditiveBlending = false;
 };
 
 struct PushConstant {
@@ -69,9 +73,20 @@ struct Pipeline {
     });
   }
 
+  // Pipelines with a single compute shader are compute pipelines, they don't
+  // need a render pass or vertex data.
   void Bake();
+  WIESEL_GETTER_FN bool IsCompute() const;
+  // Copies everything but the Vulkan handles, so a new version can be baked
+  // on another thread while this one is still in use.
+  WIESEL_GETTER_FN Ref<Pipeline> Clone() const;
+  // Swaps the handles and shaders with a baked clone, the clone then
+  // destroys the old ones.
+  void TakeHandles(Pipeline& other);
+  WIESEL_GETTER_FN bool UsesShader(const std::string& path) const;
 
   void Bind(PipelineBindPoint bindPoint);
+  void Bind(PipelineBindPoint bindPoint, const CommandBuffer& commandBuffer);
   struct SpecializationData {
     std::vector<VkSpecializationMapEntry> MapEntries;
     size_t DataSize;
@@ -93,6 +108,8 @@ struct Pipeline {
   std::vector<VkVertexInputAttributeDescription> m_VertexAttributeDescriptions;
   std::vector<PushConstant> m_PushConstants;
   bool m_IsAllocated = false;
+  // Incremented by every Bake.
+  uint32_t m_Generation = 0;
 };
 
 }  // namespace Wiesel
\ No newline at end of file
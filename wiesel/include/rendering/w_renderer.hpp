@@ -23,11 +23,13 @@
 #include "rendering/w_descriptor.hpp"
 #include "rendering/w_framebuffer.hpp"
 #include "rendering/w_mesh.hpp"
+#include "rendering/w_shadowatlas.hpp"
 #include "rendering/w_texture.hpp"
 #include "rendering/w_sprite.hpp"
 #include "scene/w_components.hpp"
 #include "scene/w_lights.hpp"
 #include "util/w_color.hpp"
+#include "util/w_filewatcher.hpp"
 #include "util/w_utils.hpp"
 #include "w_pipeline.hpp"
 #include "w_renderpass.hpp"
@@ -38,12 +40,67 @@
 
 namespace Wiesel {
 
+// Matrix of the cascade or the point light cube face being drawn.
 struct ShadowPipelinePushConstant {
-  int CascadeIndex;
+  glm::mat4 ViewProjection;
+};
+
+struct SSAOGenPipelinePushConstant {
+  uint32_t KernelSize;
+  float Radius;
+};
+
+struct SSAOBlurPipelinePushConstant {
+  glm::ivec2 Direction;
+};
+
+enum class SSAOQuality { Low, Medium, High, Ultra };
+
+struct SSAOQualitySettings {
+  uint32_t KernelSize;
+  float Radius;
+};
+
+SSAOQualitySettings GetSSAOQualitySettings(SSAOQuality quality);
+const char* GetSSAOQualityName(SSAOQuality quality);
+
+enum class ShadowDepthFormat { D16, D32 };
+
+struct ShadowSettings {
+  uint32_t CascadeCount = WIESEL_SHADOW_MAX_CASCADE_COUNT;
+  uint32_t Resolution = 4096;
+  ShadowDepthFormat DepthFormat = ShadowDepthFormat::D32;
+  // Shared by the shadow casting point lights, a power of two.
+  uint32_t AtlasResolution = 4096;
+  // Point light cube faces redrawn per frame, applied right away.
+  uint32_t AtlasUpdateBudget = 12;
+
+  bool operator==(const ShadowSettings&) const = default;
+};
+
+const char* GetShadowDepthFormatName(ShadowDepthFormat format);
+
+// Pipelines created since startup. Cache hits are only known when the driver
+// supports VK_EXT_pipeline_creation_feedback.
+struct PipelineCacheStats {
+  // The cache was loaded from disk and matched this device and driver.
+  bool LoadedFromDisk = false;
+  bool HasFeedback = false;
+  uint32_t PipelineCount = 0;
+  uint32_t CacheHits = 0;
+  std::chrono::microseconds CreationTime{0};
+  // Pipeline creation time during Initialize, cold or warm.
+  std::chrono::microseconds StartupCreationTime{0};
 };
 
 struct RendererProperties {};
 
+// Records the draws in [begin, end) to the given command buffer, called from
+// job threads so it must not touch anything that isn't read only during the
+// recording.
+using DrawRecordFn = std::function<void(
+    const CommandBuffer& commandBuffer, uint32_t begin, uint32_t end)>;
+
 class Renderer {
  public:
   explicit Renderer(Ref<AppWindow> window);
@@ -62,7 +119,20 @@ class Renderer {
   Ref<UniformBuffer> CreateUniformBuffer(VkDeviceSize size);
   void DestroyUniformBuffer(UniformBuffer& buffer);
 
+  // Host visible storage buffers are mapped like uniform buffers, the others
+  // are device local and only written by shaders.
+  Ref<StorageBuffer> CreateStorageBuffer(VkDeviceSize size, bool hostVisible);
+  void DestroyStorageBuffer(StorageBuffer& buffer);
+
   void SetupCameraComponent(CameraComponent& component);
+  // (Re)creates the shadow maps of the camera with the current shadow
+  // settings, along with the global descriptor that samples them.
+  void SetupShadowResources(CameraComponent& component);
+  WIESEL_GETTER_FN bool IsShadowResourcesOutdated(
+      const CameraComponent& component);
+  // Allocates atlas tiles for the requests and points the lights at them,
+  // called once per frame after the point lights are updated.
+  void UpdatePointShadows(const std::vector<PointShadowRequest>& requests);
 
   Ref<Texture> CreateBlankTexture();
   Ref<Texture> CreateBlankTexture(const TextureProps& textureProps,
@@ -82,6 +152,12 @@ class Renderer {
 
   Ref<AttachmentTexture> CreateAttachmentTexture(
       const AttachmentTextureProps& props);
+  // Binds every attachment to the same memory, only for attachments whose
+  // lifetimes in a frame don't overlap. Each one is written before it's read.
+  std::vector<Ref<AttachmentTexture>> CreateAliasedAttachmentTextures(
+      const std::vector<AttachmentTextureProps>& props);
+  AttachmentMemoryReport GetAttachmentMemoryReport(
+      const CameraComponent& camera);
 
   void SetAttachmentTextureBuffer(Ref<AttachmentTexture> texture, void* buffer,
                                   size_t sizePerPixel);
@@ -123,11 +199,46 @@ class Renderer {
   void SetSSAOEnabled(bool value);
   WIESEL_GETTER_FN bool IsSSAOEnabled();
   WIESEL_GETTER_FN bool* IsSSAOEnabledPtr();
+  // Regenerates the sample kernel, waits for the device to be idle.
+  void SetSSAOQuality(SSAOQuality quality);
+  WIESEL_GETTER_FN SSAOQuality GetSSAOQuality();
+  // Applied at the start of the next frame, the shadow render pass and the
+  // pipelines are rebuilt and cameras recreate their shadow maps.
+  void SetShadowSettings(const ShadowSettings& settings);
+  WIESEL_GETTER_FN const ShadowSettings& GetShadowSettings();
+
+  // Draws every point light as a screen space rectangle that bounds its
+  // radius, instead of the clustered fullscreen lighting.
+  void SetLightVolumesEnabled(bool value);
+  WIESEL_GETTER_FN bool IsLightVolumesEnabled();
+  WIESEL_GETTER_FN bool* IsLightVolumesEnabledPtr();
+
+  void SetParallelRecordingEnabled(bool value);
+  WIESEL_GETTER_FN bool IsParallelRecordingEnabled();
+  WIESEL_GETTER_FN bool* IsParallelRecordingEnabledPtr();
 
   void SetRecreatePipeline(bool value);
   WIESEL_GETTER_FN bool IsRecreatePipeline();
 
+  // Watches assets/shaders. Changed shaders are recompiled and the pipelines
+  // that use them are rebaked on a background thread, then swapped in at the
+  // start of a frame.
+  void SetShaderHotReloadEnabled(bool value);
+  WIESEL_GETTER_FN bool IsShaderHotReloadEnabled();
+  WIESEL_GETTER_FN bool* IsShaderHotReloadEnabledPtr();
+
   WIESEL_GETTER_FN VkDevice GetLogicalDevice();
+  WIESEL_GETTER_FN VkPipelineCache GetPipelineCache() const {
+    return m_PipelineCache;
+  }
+  WIESEL_GETTER_FN bool HasPipelineCreationFeedback() const {
+    return m_PipelineCacheStats.HasFeedback;
+  }
+  WIESEL_GETTER_FN const PipelineCacheStats& GetPipelineCacheStats() const {
+    return m_PipelineCacheStats;
+  }
+  // Called by pipelines after they are created.
+  void RecordPipelineCreation(bool cacheHit, std::chrono::microseconds time);
   WIESEL_GETTER_FN float GetAspectRatio() const;
   WIESEL_GETTER_FN const WindowSize& GetWindowSize() const;
 
@@ -166,12 +277,8 @@ class Renderer {
     return m_SkyboxPipeline;
   }
 
-  WIESEL_GETTER_FN const Ref<Pipeline> GetSSAOGenPipeline() const {
-    return m_SSAOGenPipeline;
-  }
-
-  WIESEL_GETTER_FN const Ref<Pipeline> GetSSAOBlurPipeline() const {
-    return m_SSAOBlurPipeline;
+  WIESEL_GETTER_FN const Ref<Pipeline> GetLightCullingPipeline() const {
+    return m_LightCullingPipeline;
   }
 
   WIESEL_GETTER_FN const Ref<Pipeline> GetLightingPipeline() const {
@@ -207,28 +314,55 @@ class Renderer {
 
   void SetViewport(VkExtent2D extent);
   void SetViewport(glm::vec2 extent);
+  void SetViewport(glm::vec2 extent, const CommandBuffer& commandBuffer);
+  void SetViewport(glm::uvec2 offset, glm::uvec2 extent,
+                   const CommandBuffer& commandBuffer);
 
   void DrawModel(ModelComponent& model, const TransformComponent& transform,
                  bool shadowPass);
+  void DrawModel(ModelComponent& model, const TransformComponent& transform,
+                 bool shadowPass, const CommandBuffer& commandBuffer);
   void DrawMesh(Ref<Mesh> mesh, const TransformComponent& transform, bool shadowPass);
+  void DrawMesh(Ref<Mesh> mesh, const TransformComponent& transform,
+                bool shadowPass, const CommandBuffer& commandBuffer);
   void DrawSprite(SpriteComponent& sprite, const TransformComponent& transform);
   void DrawSkybox(Ref<Skybox> skybox);
   void DrawFullscreen(Ref<Pipeline> pipeline, std::initializer_list<Ref<DescriptorSet>> descriptors);
+  // Draws the light volumes of the point lights, additively on top of the
+  // lighting pass.
+  void DrawPointLightVolumes();
 
   void BeginRender();
   void BeginFrame();
-  void BeginShadowPass(uint32_t cascade);
+  // Static casters render into the cached cascades of the camera.
+  void BeginShadowPass(uint32_t cascade, bool staticCasters);
   void EndShadowPass();
+  // Record every shadow cascade (if the camera does a shadow pass) or the
+  // geometry pass into secondary command buffers on the job system, then
+  // execute them on the frame command buffer in submit order. Replaces the
+  // Begin/End pairs of these passes. For static casters only the dirty
+  // cached cascades are recorded.
+  void RecordShadowPasses(uint32_t drawCount, bool staticCasters,
+                          const DrawRecordFn& shadowFn);
+  void RecordGeometryPass(uint32_t drawCount, const DrawRecordFn& geometryFn);
+  // Redraws the atlas tiles picked this frame, drawFn draws the casters with
+  // the shadow pipeline on the frame command buffer.
+  void RecordPointShadowPass(
+      const std::function<void(const PointShadowFaceUpdate&)>& drawFn);
+  WIESEL_GETTER_FN bool HasPointShadowUpdates() const;
 #ifdef ID_BUFFER_PASS
   void BeginIDPass();
   void EndIDPass();
 #endif
   void BeginGeometryPass();
   void EndGeometryPass();
-  void BeginSSAOGenPass();
-  void EndSSAOGenPass();
-  void BeginSSAOBlurPass();
-  void EndSSAOBlurPass();
+  // Computes the ao at half resolution, then blurs it along one axis per
+  // dispatch. Have to be recorded outside of a render pass.
+  void DispatchSSAOGen();
+  void DispatchSSAOBlur(bool vertical);
+  // Bins the point lights into the clusters of the current camera, has to be
+  // recorded outside of a render pass.
+  void DispatchLightCulling();
   void BeginLightingPass();
   void EndLightingPass();
   void BeginSpritePass();
@@ -286,9 +420,14 @@ class Renderer {
   void CreateSurface();
   void PickPhysicalDevice();
   void CreateLogicalDevice();
+  // Loads the pipeline cache written by the last run on this device.
+  void CreatePipelineCache();
+  void SavePipelineCache();
   void CreateDescriptorLayouts();
   void CreateSwapChain();
   void CreateGeometryRenderPass();
+  void CreateShadowRenderPass();
+  void CreateShadowAtlas();
   void CreateGeometryGraphicsPipelines();
   void CreatePresentGraphicsPipelines();
   void CreateCommandPools();
@@ -296,6 +435,7 @@ class Renderer {
   void CreatePermanentResources();
   void CreateSyncObjects();
   void CreateGlobalUniformBuffers();
+  void GenerateSSAOKernel();
   void CleanupGeometryGraphics();
   void CleanupPresentGraphics();
   void CleanupDescriptorLayouts();
@@ -308,11 +448,25 @@ class Renderer {
       const std::vector<VkPresentModeKHR>& availablePresentModes);
   VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
   bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+  bool IsDeviceExtensionSupported(VkPhysicalDevice device,
+                                  const char* extension);
   SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device);
   VkCommandBuffer BeginSingleTimeCommands();
   void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
   uint32_t FindMemoryType(uint32_t typeFilter,
                           VkMemoryPropertyFlags properties);
+  std::optional<uint32_t> TryFindMemoryType(uint32_t typeFilter,
+                                            VkMemoryPropertyFlags properties);
+  // Creates the images of an attachment without binding any memory.
+  Ref<AttachmentTexture> CreateAttachmentImages(
+      const AttachmentTextureProps& props);
+  void CreateAttachmentViews(AttachmentTexture& texture,
+                             const AttachmentTextureProps& props);
+  void CreateImageHandle(uint32_t width, uint32_t height, uint32_t mipLevels,
+                         VkSampleCountFlagBits numSamples, VkFormat format,
+                         VkImageTiling tiling, VkImageUsageFlags usage,
+                         VkImage& image, VkImageCreateFlags flags,
+                         uint32_t arrayLayers);
 
   std::vector<const char*> GetRequiredExtensions();
   QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device);
@@ -321,10 +475,17 @@ class Renderer {
                                VkImageTiling tiling,
                                VkFormatFeatureFlags features);
   VkFormat FindDepthFormat();
+  VkFormat GetShadowDepthFormat();
   bool HasStencilComponent(VkFormat format);
   void GenerateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth,
                        int32_t texHeight, uint32_t mipLevels);
   VkSampleCountFlagBits GetMaxUsableSampleCount();
+  void RecordSecondaryPasses(bool shadowPass, bool staticCasters,
+                             uint32_t drawCount, const DrawRecordFn& fn);
+  WIESEL_GETTER_FN std::vector<Ref<Pipeline>> GetPipelines() const;
+  void UpdateShaderHotReload();
+  void StartShaderReload();
+  void ApplyShaderReload();
 #ifdef VULKAN_VALIDATION
   bool CheckValidationLayerSupport();
   void SetupDebugMessenger();
@@ -359,6 +520,10 @@ class Renderer {
   VkInstance m_Instance{};
   VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
   VkDevice m_LogicalDevice{};
+  VkPipelineCache m_PipelineCache = VK_NULL_HANDLE;
+  PipelineCacheStats m_PipelineCacheStats{};
+  // Pipelines are also baked by the shader reload thread.
+  std::mutex m_PipelineCacheStatsMutex;
   VkSurfaceKHR m_Surface{};
   VkQueue m_GraphicsQueue{};
   VkQueue m_PresentQueue{};
@@ -373,6 +538,11 @@ class Renderer {
 
   Ref<CommandPool> m_CommandPool;
   Ref<CommandBuffer> m_CommandBuffer;
+  // One pool per job system thread, used to record secondary buffers.
+  std::vector<Ref<CommandPool>> m_RecordingCommandPools;
+  // Secondary buffers of the current frame, released once the frame fence
+  // is signaled.
+  std::vector<Ref<CommandBuffer>> m_SecondaryCommandBuffers;
 
   VkSemaphore m_ImageAvailableSemaphore;
   VkSemaphore m_RenderFinishedSemaphore;
@@ -386,6 +556,11 @@ class Renderer {
   bool m_Vsync;
   Ref<UniformBuffer> m_LightsUniformBuffer;
   LightsUniformData m_LightsUniformData;
+  Ref<StorageBuffer> m_PointLightsStorageBuffer;
+  PointLightsStorageData m_PointLightsStorageData;
+  // Light count and light indices of every cluster, written by the light
+  // culling pass.
+  Ref<StorageBuffer> m_LightClustersStorageBuffer;
   Ref<UniformBuffer> m_CameraUniformBuffer;
   Ref<UniformBuffer> m_ShadowCameraUniformBuffer;
   Ref<UniformBuffer> m_SSAOKernelUniformBuffer;
@@ -394,9 +569,43 @@ class Renderer {
   SSAOKernelUniformData m_SSAOKernelUniformData;
   bool m_EnableWireframe;
   bool m_EnableSSAO;
+  SSAOQuality m_SSAOQuality;
+  ShadowSettings m_ShadowSettings;
+  ShadowSettings m_NextShadowSettings;
+  ShadowSpecializationData m_ShadowSpecializationData;
+  bool m_RecreateShadowResources;
+  // Bumped whenever the shadow render pass is rebuilt, cameras with an older
+  // version recreate their shadow maps.
+  uint32_t m_ShadowResourcesVersion;
+  bool m_EnableLightVolumes;
+  bool m_EnableParallelRecording;
+  bool m_EnableShaderHotReload;
   bool m_RecreatePipeline;
   bool m_RecreateSwapChain;
 
+  struct ShaderReload {
+    struct Entry {
+      Ref<Pipeline> Target;
+      // Generation of the target when the clone was made, the target was
+      // rebaked on the main thread in the meantime if it doesn't match.
+      uint32_t Generation;
+      Ref<Pipeline> Clone;
+    };
+    std::vector<Entry> Entries;
+    std::vector<std::string> Paths;
+    // m_RecreationGeneration when the clones were made.
+    uint64_t RecreationGeneration = 0;
+    std::thread Thread;
+    std::atomic<bool> Done{false};
+    bool Succeeded = false;
+  };
+  // Bumped whenever BeginRender recreates render passes or pipelines, a
+  // shader reload that started before is thrown away and started again.
+  uint64_t m_RecreationGeneration = 0;
+  Scope<FileWatcher> m_ShaderWatcher;
+  std::set<std::string> m_ChangedShaders;
+  ShaderReload m_ShaderReload;
+
   Ref<CameraData> m_Camera;
   glm::vec2 m_ViewportSize;
 
@@ -422,16 +631,23 @@ class Renderer {
   Ref<Pipeline> m_ShadowPipeline;
   Ref<ShadowPipelinePushConstant> m_ShadowPipelinePushConstant;
 
+  Ref<RenderPass> m_ShadowAtlasRenderPass;
+  Ref<AttachmentTexture> m_ShadowAtlasTexture;
+  Ref<Framebuffer> m_ShadowAtlasFramebuffer;
+  ShadowAtlas m_ShadowAtlas;
+  Ref<StorageBuffer> m_PointShadowsStorageBuffer;
+
   Ref<RenderPass> m_LightingRenderPass;
   Ref<DescriptorSetLayout> m_SkyboxDescriptorLayout;
   Ref<Pipeline> m_SkyboxPipeline;
   Ref<Pipeline> m_LightingPipeline;
+  Ref<Pipeline> m_LightCullingPipeline;
+  Ref<Pipeline> m_LightVolumePipeline;
 
-  Ref<RenderPass> m_SSAOGenRenderPass;
   Ref<Pipeline> m_SSAOGenPipeline;
-
-  Ref<RenderPass> m_SSAOBlurRenderPass;
+  Ref<SSAOGenPipelinePushConstant> m_SSAOGenPipelinePushConstant;
   Ref<Pipeline> m_SSAOBlurPipeline;
+  Ref<SSAOBlurPipelinePushConstant> m_SSAOBlurPipelinePushConstant;
 
   Ref<RenderPass> m_SpriteRenderPass;
   Ref<Pipeline> m_SpritePipeline;
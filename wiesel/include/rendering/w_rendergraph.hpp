@@ -0,0 +1,203 @@
+//
+//    Copyright 2023 Metehan Gezer
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+#include "rendering/w_barrier.hpp"
+#include "rendering/w_buffer.hpp"
+#include "rendering/w_command.hpp"
+#include "rendering/w_texture.hpp"
+#include "util/w_utils.hpp"
+#include "w_pch.hpp"
+
+namespace Wiesel {
+
+enum class RenderGraphUsage {
+  ColorAttachment,
+  DepthStencilAttachment,
+  FragmentSampled,
+  ComputeSampled,
+  // Written by compute shaders in the general layout.
+  ComputeStorageImage,
+  // Storage buffers.
+  ComputeStorageWrite,
+  FragmentStorageRead,
+};
+
+using RenderGraphResourceId = uint32_t;
+
+class RenderGraph;
+
+class RenderGraphPassBuilder {
+ public:
+  RenderGraphPassBuilder& Read(
+      RenderGraphResourceId resource,
+      RenderGraphUsage usage = RenderGraphUsage::FragmentSampled);
+  RenderGraphPassBuilder& Write(
+      RenderGraphResourceId resource,
+      RenderGraphUsage usage = RenderGraphUsage::ColorAttachment);
+  // The render pass transitions the attachment itself, it starts from an
+  // undefined layout and leaves it in the layout of finalUsage.
+  RenderGraphPassBuilder& Write(RenderGraphResourceId resource,
+                                RenderGraphUsage usage,
+                                RenderGraphUsage finalUsage);
+  // Disabled passes are culled, together with every pass that only feeds
+  // them.
+  RenderGraphPassBuilder& SetEnabled(bool enabled);
+
+ private:
+  friend class RenderGraph;
+
+  RenderGraphPassBuilder(RenderGraph& graph, uint32_t pass)
+      : m_Graph(graph), m_Pass(pass) {}
+
+  RenderGraph& m_Graph;
+  uint32_t m_Pass;
+};
+
+// Where a graph left a resource. Graphs recorded into the same command buffer
+// import the same shared resources, the next one starts from this state so
+// its first access waits for the last access of the previous one. The layout
+// is always the resting one.
+struct RenderGraphResourceState {
+  VkPipelineStageFlags Stages = 0;
+  VkAccessFlags Access = 0;
+  bool Written = false;
+  VkPipelineStageFlags VisibleStages = 0;
+
+  bool operator==(const RenderGraphResourceState&) const = default;
+};
+
+// Attachments with non-overlapping lifetimes that can share one allocation.
+struct RenderGraphAliasSlot {
+  VkDeviceSize Size = 0;
+  VkDeviceSize Alignment = 0;
+  uint32_t MemoryTypeBits = ~0u;
+  int32_t LastPass = -1;
+  std::vector<RenderGraphResourceId> Resources;
+};
+
+/*
+ * Frame graph declared every frame from the passes of a camera. Passes
+ * declare which attachments they read and write, Compile culls the passes
+ * that don't contribute to an output and computes the barriers between
+ * passes, Execute records them with one vkCmdPipelineBarrier per pass. A
+ * graph that is declared the same way as the last compiled one reuses its
+ * barriers.
+ *
+ * Resources are imported attachments, they are expected to be in the layout
+ * of their resting usage when the graph starts and are put back into it once
+ * the graph is done. Attachments rest ready to be sampled, the render passes
+ * that write them leave them in that layout. Attachments that share memory
+ * with others wait for the aliases used earlier in the frame before they are
+ * written, they have to be written before they are read and can't be alive at
+ * the same time.
+ *
+ * Storage buffers can be imported as well, they have no layout so only the
+ * memory dependencies between passes are tracked.
+ */
+class RenderGraph {
+ public:
+  using ExecuteFn = std::function<void()>;
+
+  RenderGraph() = default;
+  RenderGraph(const RenderGraph&) = delete;
+
+  // Importing the same texture twice returns the same resource, resolve
+  // images alias their msaa image when msaa is disabled.
+  RenderGraphResourceId ImportTexture(
+      const std::string& name, Ref<AttachmentTexture> texture,
+      RenderGraphUsage restingUsage = RenderGraphUsage::FragmentSampled,
+      uint32_t layerCount = 1);
+  RenderGraphResourceId ImportBuffer(
+      const std::string& name, Ref<StorageBuffer> buffer,
+      RenderGraphUsage restingUsage = RenderGraphUsage::FragmentStorageRead);
+  // Outputs are read outside the graph, passes writing them are never culled.
+  void MarkOutput(RenderGraphResourceId resource);
+  // Starts the resources that are also imported by the previous graph from
+  // the state it left them in. Call it after every resource is imported.
+  void CarryStateFrom(const RenderGraph& previous);
+
+  RenderGraphPassBuilder AddPass(const std::string& name, ExecuteFn fn);
+
+  void Compile();
+  void Execute(const CommandBuffer& commandBuffer);
+  // Clears every pass and resource, the graph can be declared again after
+  // this. The compiled passes are kept for Compile to reuse.
+  void Reset();
+
+  // Greedily packs the transient resources into slots, two resources can
+  // only share a slot if their lifetimes don't overlap. Requires Compile.
+  // Compile throws if the attachments that already share memory break the
+  // same rule.
+  std::vector<RenderGraphAliasSlot> PlanAliasing() const;
+
+  void Dump(std::ostream& stream) const;
+
+  WIESEL_GETTER_FN bool IsCompiled() const { return m_Compiled; }
+  WIESEL_GETTER_FN uint32_t GetBarrierBatchCount() const;
+
+ private:
+  friend class RenderGraphPassBuilder;
+
+  struct Access {
+    RenderGraphResourceId Resource;
+    RenderGraphUsage Usage;
+    bool Write;
+    std::optional<RenderGraphUsage> FinalUsage;
+
+    bool operator==(const Access&) const = default;
+  };
+
+  struct Pass {
+    std::string Name;
+    ExecuteFn Fn;
+    std::vector<Access> Accesses;
+    bool Enabled = true;
+    bool Culled = false;
+    BarrierBatch Barriers;
+  };
+
+  struct Resource {
+    std::string Name;
+    // Exactly one of these is set.
+    Ref<AttachmentTexture> Texture;
+    Ref<StorageBuffer> Buffer;
+    RenderGraphUsage RestingUsage;
+    uint32_t LayerCount;
+    bool IsOutput = false;
+    RenderGraphResourceState InitialState;
+    // Filled by Compile.
+    int32_t FirstPass = -1;
+    int32_t LastPass = -1;
+    // The first access in the frame is a write, the contents don't have to
+    // survive between frames.
+    bool IsTransient = false;
+    RenderGraphResourceState FinalState;
+  };
+
+  // Everything but the callbacks of the passes matches the compiled graph.
+  WIESEL_GETTER_FN bool MatchesCompiled() const;
+  // Attachments that share memory are paired when they are created, checks
+  // that the kept passes never need two of them at once.
+  void ValidateAliasing() const;
+
+  std::vector<Pass> m_Passes;
+  std::vector<Resource> m_Resources;
+  // The graph that was compiled before the last Reset. It holds references
+  // to its resources, so they can't be replaced by new ones at the same
+  // address while it is compared against.
+  std::vector<Pass> m_CompiledPasses;
+  std::vector<Resource> m_CompiledResources;
+  BarrierBatch m_FinalBarriers;
+  bool m_Compiled = false;
+};
+
+}  // namespace Wiesel
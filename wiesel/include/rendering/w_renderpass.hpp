@@ -52,7 +52,8 @@ class RenderPass {
 
   void Bake();
 
-  void Begin(Ref<Framebuffer> framebuffer, const Colorf& clearColor);
+  void Begin(Ref<Framebuffer> framebuffer, const Colorf& clearColor,
+             VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
   void End();
 
   Ref<Framebuffer> CreateFramebuffer(uint32_t index, std::span<AttachmentTexture*> outputAttachments, glm::vec2 extent);
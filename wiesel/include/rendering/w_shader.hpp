@@ -13,7 +13,7 @@
 
 namespace Wiesel {
 // todo
-enum ShaderType { ShaderTypeVertex, ShaderTypeFragment };
+enum ShaderType { ShaderTypeVertex, ShaderTypeFragment, ShaderTypeCompute };
 
 enum ShaderSource { ShaderSourcePrecompiled, ShaderSourceSource };
 
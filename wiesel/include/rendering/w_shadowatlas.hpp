@@ -0,0 +1,102 @@
+//
+//    Copyright 2023 Metehan Gezer
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+#include "util/w_utils.hpp"
+#include "w_pch.hpp"
+
+namespace Wiesel {
+
+// A point light that casts shadows this frame.
+struct PointShadowRequest {
+  // Stays the same between frames, the entity of the light.
+  uint32_t LightId;
+  // Index of the light in the point light buffer this frame.
+  uint32_t LightIndex;
+  glm::vec3 Position;
+  float Radius;
+  // Share of the screen height the light's sphere covers, 0 to 1.
+  float Importance;
+};
+
+// A cube face that is redrawn this frame.
+struct PointShadowFaceUpdate {
+  glm::uvec2 Offset;
+  uint32_t Size;
+  glm::mat4 ViewProjection;
+  // Far plane of the face, casters further from the light can't reach it.
+  glm::vec3 LightPosition;
+  float Range;
+};
+
+// Packs the cube faces of shadow casting point lights into square tiles of a
+// single depth texture. Tiles are sized by the importance of their light and
+// only a budget of faces is redrawn per frame, the others keep the contents
+// and matrices they were last drawn with. This only does the bookkeeping, the
+// renderer owns the texture and draws the updates.
+class ShadowAtlas {
+ public:
+  ShadowAtlas() = default;
+  ~ShadowAtlas() = default;
+
+  // Forgets every tile, for a new texture.
+  void Reset(uint32_t resolution);
+  // Allocates tiles for the requests, the most important ones first, and
+  // picks at most budget faces to redraw.
+  void Update(std::vector<PointShadowRequest> requests, uint32_t budget);
+  void ClearFaceUpdates();
+
+  // -1 until every face of the light was drawn at least once.
+  WIESEL_GETTER_FN int32_t GetShadowIndex(uint32_t lightId) const;
+  WIESEL_GETTER_FN const std::vector<PointShadowFaceUpdate>& GetFaceUpdates()
+      const {
+    return m_FaceUpdates;
+  }
+  WIESEL_GETTER_FN const PointShadowsStorageData& GetShadowData() const {
+    return m_ShadowData;
+  }
+
+ private:
+  struct Face {
+    glm::uvec2 Offset{0};
+    uint32_t Size = 0;
+    glm::mat4 ViewProjection{1.0f};
+    // Drawn at the current offset and size.
+    bool IsValid = false;
+    // The light moved since it was drawn.
+    bool IsStale = false;
+    uint64_t LastDrawnFrame = 0;
+  };
+  struct Entry {
+    uint32_t LightId;
+    uint32_t TileSize = 0;
+    glm::vec3 Position{0.0f};
+    float Radius = 0.0f;
+    float Importance = 0.0f;
+    std::array<Face, 6> Faces;
+  };
+
+  WIESEL_GETTER_FN uint32_t GetTileSize(float importance) const;
+  void Pack();
+  void ScheduleFaces(uint32_t budget);
+  void UpdateShadowData();
+
+  uint32_t m_Resolution = 0;
+  uint32_t m_MinTileSize = 0;
+  uint32_t m_MaxTileSize = 0;
+  uint64_t m_Frame = 0;
+  // Ordered by importance, the index is the shadow index of the light.
+  std::vector<Entry> m_Entries;
+  std::vector<PointShadowFaceUpdate> m_FaceUpdates;
+  PointShadowsStorageData m_ShadowData{};
+};
+
+}  // namespace Wiesel
@@ -202,6 +202,32 @@ struct AttachmentTextureProps {
   bool Sampled = false;
   uint32_t LayerCount = 1;
   bool TransferDest = false;
+  // Written by compute shaders as a storage image.
+  bool Storage = false;
+};
+
+// Device memory shared by attachments whose lifetimes in a frame don't
+// overlap, freed once the last attachment bound to it is destroyed.
+class AliasedMemory {
+ public:
+  AliasedMemory() = default;
+  ~AliasedMemory();
+
+  VkDeviceMemory m_Handle;
+  VkDeviceSize m_Size;
+};
+
+// Memory used by the attachments of a camera, sizes are in bytes.
+struct AttachmentMemoryReport {
+  uint32_t AttachmentCount = 0;
+  // What the attachments would take with an allocation each.
+  VkDeviceSize Requested = 0;
+  VkDeviceSize Allocated = 0;
+  VkDeviceSize LazilyAllocated = 0;
+  // Actually committed for the lazily allocated attachments, tile based
+  // gpus never back attachments that are not stored.
+  VkDeviceSize LazilyCommitted = 0;
+  VkDeviceSize AliasingSaved = 0;
 };
 
 class DescriptorSet;
@@ -210,6 +236,16 @@ struct AttachmentTextureInfo {
   AttachmentTextureType Type;
   VkFormat Format;
   VkSampleCountFlagBits MsaaSamples;
+  // Layout the render pass leaves the attachment in, undefined keeps the
+  // attachment layout. Sampled outputs use shader read only so the passes
+  // reading them don't need a transition.
+  VkImageLayout FinalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  // Contents are only needed during the pass, msaa images that are resolved
+  // and depth buffers nobody samples. They aren't stored at the end of it.
+  bool Transient = false;
+  // Previous contents are kept instead of cleared, for attachments that are
+  // only partly redrawn. Has to be in FinalLayout when the pass begins.
+  bool Load = false;
   /*VkAttachmentLoadOp LoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
   VkAttachmentStoreOp StoreOp = VK_ATTACHMENT_STORE_OP_STORE;
   VkAttachmentLoadOp StencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
@@ -233,6 +269,12 @@ class AttachmentTexture {
   Ref<DescriptorSet> m_Descriptors; // Deprecated, I'll move this
   VkImageAspectFlags m_AspectFlags;
   uint32_t m_MipLevels;
+  // Size of the memory the images require, with an allocation each.
+  VkDeviceSize m_MemorySize = 0;
+  bool m_IsLazilyAllocated = false;
+  // Set when the images are bound to memory shared with other attachments,
+  // m_DeviceMemories is empty then.
+  Ref<AliasedMemory> m_AliasedMemory;
 
   bool m_IsAllocated;
 
@@ -55,6 +55,10 @@ struct TagComponent : public IComponent {
 };
 
 struct TransformComponent : public IComponent {
+  // Scripts hold pointers into the storage, deleting in place keeps the other
+  // transforms from being moved.
+  static constexpr auto in_place_delete = true;
+
   TransformComponent() = default;
   TransformComponent(const TransformComponent&) = default;
 
@@ -97,6 +101,13 @@ struct TransformComponent : public IComponent {
   bool IsChanged = true;
   glm::mat4 TransformMatrix = {};
   glm::mat3 NormalMatrix = {};
+
+  // State before the last fixed step. Transforms that moved in it are drawn
+  // in between, the matrices lag behind by up to one step.
+  glm::vec3 PreviousPosition = {0.0f, 0.0f, 0.0f};
+  glm::vec3 PreviousRotation = {0.0f, 0.0f, 0.0f};
+  glm::vec3 PreviousScale = {1.0f, 1.0f, 1.0f};
+  bool IsInterpolated = false;
 };
 
 struct RectangleTransformComponent  : public IComponent{
@@ -55,14 +55,18 @@ struct alignas(16) LightPoint {
       : Base({}),
         Constant(1.0f),
         Linear(0.09f),
-        Exp(0.032f) {}
+        Exp(0.032f),
+        Radius(0.0f),
+        ShadowIndex(-1) {}
 
   LightPoint(glm::vec3 position, LightBase base, float constant, float linear,
              float exp)
       : Base(base),
         Constant(constant),
         Linear(linear),
-        Exp(exp) {}
+        Exp(exp),
+        Radius(0.0f),
+        ShadowIndex(-1) {}
 
   ~LightPoint() = default;
 
@@ -70,23 +74,43 @@ struct alignas(16) LightPoint {
   float Constant;
   float Linear;
   float Exp;
+  // Distance where the light falls below 1/256, set by UpdateLight. Lights
+  // are only binned into the clusters their radius reaches.
+  float Radius;
+  // Index of the light's cube faces in the shadow atlas, -1 when it has no
+  // shadow. Set by the renderer every frame.
+  int32_t ShadowIndex;
 };
 
 static const int MAX_LIGHTS = 16;
+static const int MAX_POINT_LIGHTS = 4096;
 
 struct alignas(16) LightsUniformData {
-  LightsUniformData() : DirectLightCount(0), PointLightCount(0){};
+  LightsUniformData() : DirectLightCount(0){};
 
   uint32_t DirectLightCount;
-  uint32_t PointLightCount;
   LightDirect DirectLights[MAX_LIGHTS];
-  LightPoint PointLights[MAX_LIGHTS];
+};
+
+// Point lights live in a storage buffer, the light culling pass bins them
+// into clusters and the lighting pass only reads the lights of its cluster.
+struct alignas(16) PointLightsStorageData {
+  PointLightsStorageData() : PointLightCount(0){};
+
+  // Only the used part of the buffer has to be uploaded.
+  WIESEL_GETTER_FN size_t GetUsedSize() const {
+    return offsetof(PointLightsStorageData, PointLights) +
+           sizeof(LightPoint) * PointLightCount;
+  }
+
+  uint32_t PointLightCount;
+  LightPoint PointLights[MAX_POINT_LIGHTS];
 };
 
 void UpdateLight(LightsUniformData& lights, const LightDirect& light,
                  const TransformComponent& transform);
 
-void UpdateLight(LightsUniformData& lights, const LightPoint& light,
+void UpdateLight(PointLightsStorageData& lights, const LightPoint& light,
                  const TransformComponent& transform);
 
 struct LightDirectComponent {
@@ -101,6 +125,9 @@ struct LightPointComponent {
   LightPointComponent(const LightPointComponent&) = default;
 
   LightPoint LightData;
+  // Gets tiles in the shadow atlas, sized by how much of the screen it
+  // covers.
+  bool CastShadows = false;
 };
 
 }  // namespace Wiesel
\ No newline at end of file
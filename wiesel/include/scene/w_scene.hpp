@@ -12,17 +12,22 @@
 #pragma once
 
 #include <entt/entt.hpp>
+#include <typeindex>
 
 #include "rendering/w_skybox.hpp"
 #include "events/w_appevents.hpp"
 #include "events/w_events.hpp"
+#include "events/w_mouseevents.hpp"
 #include "rendering/w_camera.hpp"
+#include "rendering/w_rendergraph.hpp"
 #include "scene/w_components.hpp"
+#include "util/w_jobsystem.hpp"
 #include "w_pch.hpp"
 
 namespace Wiesel {
 class Entity;
 class CanvasSystem;
+class Renderer;
 
 class Scene {
  public:
@@ -51,6 +56,21 @@ class Scene {
 
   void SetSkybox(Ref<Skybox> skybox) { m_Skybox = skybox; }
 
+  // Rate of OnFixedUpdate, in steps per second.
+  void SetFixedUpdateRate(float rate) {
+    if (!(rate > 0.0f)) {
+      throw std::runtime_error("fixed update rate must be positive!");
+    }
+    m_FixedTimeStep = 1.0f / rate;
+  }
+  WIESEL_GETTER_FN float GetFixedUpdateRate() const {
+    return 1.0f / m_FixedTimeStep;
+  }
+  // Steps run in a single frame at most. A frame that falls further behind
+  // drops the rest, catching up would only make the next frame slower.
+  void SetMaxFixedSteps(uint32_t steps) { m_MaxFixedSteps = steps; }
+  WIESEL_GETTER_FN uint32_t GetMaxFixedSteps() const { return m_MaxFixedSteps; }
+
   template <typename T, typename... Args>
   T& AddComponent(entt::entity handle, Args&&... args) {
     if (HasComponent<T>(handle)) {
@@ -80,6 +100,7 @@ class Scene {
     }
     auto& component = GetComponent<T>(handle);
     OnRemoveComponent<T>(handle, component);
+    RemoveScriptWrapper(handle, std::type_index(typeid(T)));
     m_Registry.remove<T>(handle);
   }
 
@@ -93,6 +114,12 @@ class Scene {
    */
   std::vector<entt::entity>& GetSceneHierarchy() { return m_SceneHierarchy; }
 
+  // Graph of the last camera that was rendered, used by the editor to dump
+  // it. Null until a camera is rendered.
+  WIESEL_GETTER_FN const RenderGraph* GetRenderGraph() const {
+    return m_LastRenderGraph;
+  }
+
   void LinkEntities(entt::entity parent, entt::entity child);
   void UnlinkEntities(entt::entity parent, entt::entity child);
 
@@ -101,6 +128,27 @@ class Scene {
   glm::mat4 MakeLocal(const TransformComponent& transform);
   glm::mat4 GetWorldMatrix(entt::entity entity);
   void UpdateMatrices(entt::entity entity);
+  void BuildUpdateGraph();
+  void FixedUpdate(float_t timeStep);
+  // Picks the transforms moved by the last fixed steps after a frame that
+  // stepped, they are redrawn every frame until they stop.
+  void UpdateInterpolation();
+  // Scripts cache their wrappers of components, the wrapper of a removed
+  // component must not be handed out again.
+  void RemoveScriptWrapper(entt::entity entity, std::type_index type);
+  void UpdateTransforms();
+  void UpdateDirectLights();
+  void UpdatePointLights();
+  void UpdateCameras();
+  void UpdateCascades();
+  void GatherRenderModels();
+  // Point lights that cast shadows ask the renderer for atlas tiles, sized
+  // by how much of the first enabled camera's view they cover.
+  void UpdatePointShadows(Ref<Renderer> renderer);
+  void RecordShadowPass(Ref<Renderer> renderer, bool staticCasters);
+  void RecordPointShadowPass(Ref<Renderer> renderer);
+  void RecordGeometryPass(Ref<Renderer> renderer);
+  void BuildRenderGraph(Ref<Renderer> renderer, RenderGraph& graph);
   bool Render();
 
  private:
@@ -111,9 +159,35 @@ class Scene {
   bool m_IsRunning = false;
   bool m_IsPaused = false;
   bool m_FirstUpdate = true;
+  float m_FixedTimeStep = 1.0f / 60.0f;
+  uint32_t m_MaxFixedSteps = 5;
+  float m_FixedTimeAccumulator = 0.0f;
+  // Where the frame is between the last two fixed steps, 0 to 1.
+  float m_FixedAlpha = 0.0f;
+  // Mouse moves are sent to scripts once per frame, right before they update.
+  std::optional<MouseMovedEvent> m_PendingMouseMove;
   std::vector<entt::entity> m_SceneHierarchy;
   // this camera is used to render the scene to the current camera
   Ref<CameraData> m_CurrentCamera;
   Ref<Skybox> m_Skybox;
+
+  // Stages of OnUpdate that run after the behaviors, built once and executed
+  // every frame. Entity lists are gathered on the main thread before the graph
+  // runs. Every pool the jobs touch, including the ones they only try_get, is
+  // created there too, so the jobs only ever read the registry.
+  JobGraph m_UpdateGraph;
+  std::vector<entt::entity> m_UpdateTransformEntities;
+  std::vector<entt::entity> m_UpdateDirectLightEntities;
+  std::vector<entt::entity> m_UpdatePointLightEntities;
+  std::vector<entt::entity> m_UpdateCameraEntities;
+  std::vector<Pair<ModelComponent*, TransformComponent*>> m_RenderModels;
+  // Set when a static model moved or the set of static meshes changed, the
+  // cached shadow cascades of every camera are redrawn.
+  std::atomic<bool> m_StaticShadowsChanged = true;
+  size_t m_StaticMeshCount = 0;
+  // Graph of every rendered camera, declared every frame and only recompiled
+  // when its declaration changes.
+  std::unordered_map<entt::entity, Scope<RenderGraph>> m_RenderGraphs;
+  RenderGraph* m_LastRenderGraph = nullptr;
 };
 }  // namespace Wiesel
\ No newline at end of file
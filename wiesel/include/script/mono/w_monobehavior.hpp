@@ -25,8 +25,10 @@ class MonoBehavior : public IBehavior {
   MonoBehavior(Entity entity, const std::string& scriptName);
   ~MonoBehavior() override;
 
+  // Scenes update scripts in batches through ScriptManager::UpdateScripts.
   void OnUpdate(float_t deltaTime) override;
   void OnEvent(Event& event) override;
+  void SetEnabled(bool enabled) override;
 
   template<class T>
   void AttachExternComponent(std::string variable, entt::entity entity) {
@@ -40,9 +42,6 @@ class MonoBehavior : public IBehavior {
  private:
   void InstantiateScript();
   bool OnReloadScripts(ScriptsReloadedEvent& event);
-  bool OnKeyPressed(KeyPressedEvent& event);
-  bool OnKeyReleased(KeyReleasedEvent& event);
-  bool OnMouseMoved(MouseMovedEvent& event);
 
   ScriptInstance* m_ScriptInstance;
 };
@@ -17,6 +17,7 @@
 #include "events/w_keyevents.hpp"
 #include "events/w_mouseevents.hpp"
 #include "scene/w_entity.hpp"
+#include "script/w_scriptprofiler.hpp"
 #include <typeindex>
 
 namespace Wiesel {
@@ -90,42 +91,118 @@ class FieldData {
   FieldType m_FieldType;
 };
 
+// Unmanaged thunks of the script callbacks, called like C functions with the
+// instance first and the exception out-param last. They are much cheaper than
+// mono_runtime_invoke, which boxes the arguments and the result.
+using OnStartThunk = void (*)(MonoObject*, MonoException**);
+using OnUpdateThunk = void (*)(MonoObject*, float, MonoException**);
+using OnKeyPressedThunk = MonoBoolean (*)(MonoObject*, int32_t, MonoBoolean,
+                                          MonoException**);
+using OnKeyReleasedThunk = MonoBoolean (*)(MonoObject*, int32_t,
+                                           MonoException**);
+using OnMouseMovedThunk = MonoBoolean (*)(MonoObject*, float, float, int32_t,
+                                          MonoException**);
+// MonoBehavior.UpdateAll(MonoBehavior[] instances, int count, float deltaTime),
+// FixedUpdateAll has the same signature.
+using UpdateAllThunk = void (*)(MonoArray*, int32_t, float, MonoException**);
+
 class ScriptData {
  public:
   ScriptData(MonoClass* klass, MonoMethod* onStartMethod,
              MonoMethod* onUpdateMethod,
+             MonoMethod* onFixedUpdateMethod,
              MonoMethod* setHandleMethod,
              MonoMethod* keyPressedMethod,
              MonoMethod* keyReleasedMethod,
              MonoMethod* mouseMovedMethod,
              std::unordered_map<std::string, FieldData> fields) : m_Class(klass),
         m_OnUpdateMethod(onUpdateMethod),
+        m_OnFixedUpdateMethod(onFixedUpdateMethod),
         m_OnStartMethod(onStartMethod),
         m_SetHandleMethod(setHandleMethod),
         m_OnKeyPressedMethod(keyPressedMethod),
         m_OnKeyReleasedMethod(keyReleasedMethod),
         m_OnMouseMovedMethod(mouseMovedMethod),
-        m_Fields(fields) {}
+        m_Fields(fields) {
+    // Thunks are compiled for the current domain, this is created after the
+    // app domain is set.
+    m_OnStartThunk = GetThunk<OnStartThunk>(onStartMethod);
+    m_OnUpdateThunk = GetThunk<OnUpdateThunk>(onUpdateMethod);
+    m_OnKeyPressedThunk = GetThunk<OnKeyPressedThunk>(keyPressedMethod);
+    m_OnKeyReleasedThunk = GetThunk<OnKeyReleasedThunk>(keyReleasedMethod);
+    m_OnMouseMovedThunk = GetThunk<OnMouseMovedThunk>(mouseMovedMethod);
+    m_HandlesKeyPressed = m_OnKeyPressedThunk && !IsEmptyHandler(keyPressedMethod);
+    m_HandlesKeyReleased =
+        m_OnKeyReleasedThunk && !IsEmptyHandler(keyReleasedMethod);
+    m_HandlesMouseMoved =
+        m_OnMouseMovedThunk && !IsEmptyHandler(mouseMovedMethod);
+  }
 
   MonoClass* GetClass() const { return m_Class; }
   MonoMethod* GetOnUpdateMethod() const { return m_OnUpdateMethod; }
+  MonoMethod* GetOnFixedUpdateMethod() const { return m_OnFixedUpdateMethod; }
   MonoMethod* GetOnStartMethod() const { return m_OnStartMethod; }
   MonoMethod* GetSetHandleMethod() const { return m_SetHandleMethod; }
   MonoMethod* GetOnKeyPressedMethod() const { return m_OnKeyPressedMethod; }
   MonoMethod* GetOnKeyReleasedMethod() const { return m_OnKeyReleasedMethod; }
   MonoMethod* GetOnMouseMovedMethod() const { return m_OnMouseMovedMethod; }
+  OnStartThunk GetOnStartThunk() const { return m_OnStartThunk; }
+  OnUpdateThunk GetOnUpdateThunk() const { return m_OnUpdateThunk; }
+  OnKeyPressedThunk GetOnKeyPressedThunk() const { return m_OnKeyPressedThunk; }
+  OnKeyReleasedThunk GetOnKeyReleasedThunk() const {
+    return m_OnKeyReleasedThunk;
+  }
+  OnMouseMovedThunk GetOnMouseMovedThunk() const { return m_OnMouseMovedThunk; }
+  // True if the class overrides the handler of the event with a method that
+  // does something.
+  bool HandlesEvent(EventType type) const;
   std::unordered_map<std::string, FieldData>& GetFields() { return m_Fields; }
+  ScriptMethodStats& GetStats(ScriptMethod method) {
+    return m_Stats[static_cast<size_t>(method)];
+  }
+  // Looks up a field of the class by name, public or not, and remembers it.
+  MonoClassField* GetClassField(const std::string& name) {
+    auto it = m_ClassFields.find(name);
+    if (it != m_ClassFields.end()) {
+      return it->second;
+    }
+    MonoClassField* field = mono_class_get_field_from_name(m_Class, name.c_str());
+    m_ClassFields.insert(std::pair(name, field));
+    return field;
+  }
 
  private:
+  template <typename T>
+  static T GetThunk(MonoMethod* method) {
+    if (!method) {
+      return nullptr;
+    }
+    return reinterpret_cast<T>(mono_method_get_unmanaged_thunk(method));
+  }
+  // Handlers that only return, or return false.
+  static bool IsEmptyHandler(MonoMethod* method);
+
   MonoClass* m_Class;
   MonoMethod* m_OnUpdateMethod;
+  MonoMethod* m_OnFixedUpdateMethod;
   MonoMethod* m_OnStartMethod;
   MonoMethod* m_SetHandleMethod;
   MonoMethod* m_OnKeyPressedMethod;
   MonoMethod* m_OnKeyReleasedMethod;
   MonoMethod* m_OnMouseMovedMethod;
+  OnStartThunk m_OnStartThunk;
+  OnUpdateThunk m_OnUpdateThunk;
+  OnKeyPressedThunk m_OnKeyPressedThunk;
+  OnKeyReleasedThunk m_OnKeyReleasedThunk;
+  OnMouseMovedThunk m_OnMouseMovedThunk;
+  bool m_HandlesKeyPressed;
+  bool m_HandlesKeyReleased;
+  bool m_HandlesMouseMoved;
 
   std::unordered_map<std::string, FieldData> m_Fields;
+  std::unordered_map<std::string, MonoClassField*> m_ClassFields;
+  std::array<ScriptMethodStats, static_cast<size_t>(ScriptMethod::Count)>
+      m_Stats;
 };
 
 
@@ -152,6 +229,14 @@ class ScriptInstance {
 
  private:
   friend class MonoBehavior;
+  friend class ScriptManager;
+
+  // Logs exceptions thrown by the callbacks, returns true if there was one.
+  bool HandleException(MonoException* exception);
+  // Called before the domain the instance lives in is unloaded. Frees the
+  // handle and forgets the script data, the instance is only deleted after
+  // that.
+  void Detach();
 
   bool m_StartRan = false;
   MonoObject* m_Instance;
@@ -163,6 +248,10 @@ class ScriptInstance {
 
 struct ScriptManagerProperties {
   bool EnableDebugger;
+  bool EnableProfiler;
+  // Precompiles the scripts to native code, so they don't stall the first
+  // time they run. Meant for release builds, it makes reloads slower.
+  bool EnableAot;
 };
 
 class ScriptManager {
@@ -172,7 +261,12 @@ class ScriptManager {
 
   static void Init(const ScriptManagerProperties&& properties);
   static void Destroy();
+  // Compiles the scripts on a background thread, they are swapped in by
+  // UpdateReload once that finishes.
   static void Reload();
+  // Called at the start of every frame.
+  static void UpdateReload();
+  static bool IsReloading() { return m_Reload != nullptr; }
 
   static void LoadCore();
   static void LoadApp();
@@ -183,17 +277,115 @@ class ScriptManager {
   static MonoDomain* GetAppDomain() { return m_AppDomain; }
   static MonoClass* GetVector3fClass() { return m_MonoVector3fClass; }
   static MonoClass* GetMonoBehaviorClass() { return m_MonoBehaviorClass; }
+  static MonoClassField* GetBehaviorPtrField() { return m_BehaviorPtrField; }
+  static MonoClassField* GetScenePtrField() { return m_ScenePtrField; }
+  static MonoClassField* GetEntityIdField() { return m_EntityIdField; }
   static const std::vector<std::string> GetScriptNames() { return m_ScriptNames; }
+  static const std::map<std::string, ScriptData*>& GetAllScriptData() {
+    return m_ScriptData;
+  }
 
-  static MonoObject* GetComponentByName(Scene* scene, entt::entity entity, const std::string& name);
+  // Ids are indices into the registered components, scripts resolve them
+  // once per component type. -1 if there is no such component.
+  static int32_t GetComponentId(const std::string& name);
+  static MonoObject* GetComponentById(Scene* scene, entt::entity entity,
+                                      int32_t id);
   template<class T>
   static MonoObject* GetComponent(Scene* scene, entt::entity entity);
-  static bool HasComponentByName(Scene* scene, entt::entity entity, const std::string& name);
+  static bool HasComponentById(Scene* scene, entt::entity entity, int32_t id);
   static ScriptInstance* CreateScriptInstance(MonoBehavior* behavior);
 
+  // Runs OnUpdate of the enabled scripts in the scene, crossing into managed
+  // code once per script class instead of once per script.
+  static void UpdateScripts(Scene* scene, float deltaTime);
+  // Same as UpdateScripts for OnFixedUpdate, called once per fixed step.
+  static void FixedUpdateScripts(Scene* scene, float timeStep);
+  // Sends input events to the scripts of the scene whose class handles them.
+  static void DispatchEvent(Scene* scene, Event& event);
+  static void AddInstance(ScriptInstance* instance);
+  static void RemoveInstance(ScriptInstance* instance);
+  // Rebuilds the instance arrays before the next update, when a script is
+  // enabled or disabled.
+  static void MarkInstancesDirty();
+  static void RemoveScene(Scene* scene);
+  // Drops the cached wrappers of a removed component or destroyed entity.
+  static void RemoveComponentWrapper(Scene* scene, entt::entity entity,
+                                     std::type_index type);
+  static void RemoveEntityWrappers(Scene* scene, entt::entity entity);
+
   template<class T>
   static void RegisterComponent(std::string name, ComponentGetter getter, ComponentChecker checker);
  private:
+  // The scripts of a class in a scene, updated with a single managed call.
+  struct ScriptBatch {
+    std::vector<ScriptInstance*> Instances;
+    // GC handle of a MonoBehavior[] holding the enabled instances.
+    uint32_t ArrayHandle = 0;
+    int32_t Count = 0;
+    bool Dirty = true;
+  };
+
+  struct ScriptReload {
+    std::thread Thread;
+    std::atomic<bool> Done = false;
+    bool Succeeded = false;
+    // Build to load, the loaded one when nothing changed.
+    std::string AssemblyPath;
+  };
+
+  static constexpr const char* kCoreAssemblyPath = "obj/Core.dll";
+  static constexpr const char* kAppAssemblyPath = "obj/App.dll";
+
+  // Compiling only touches files, these are safe to call from any thread.
+  // Assemblies are rebuilt only when their sources, references or options
+  // changed since the last build.
+  static bool CompileCore(bool& changed);
+  static bool IsCoreUpToDate();
+  static bool CompileApp(bool& changed);
+  static std::vector<std::string> FindAppLinkLibs();
+  static bool CompileAssembly(const std::string& outputFile,
+                              std::vector<std::string> sourceFiles,
+                              const std::string& libDir,
+                              const std::vector<std::string>& linkLibs,
+                              bool allowUnsafe, bool& changed);
+  // Sorts the sources, the hash doesn't depend on their order.
+  static std::string HashAssembly(std::vector<std::string>& sourceFiles,
+                                  const std::vector<std::string>& linkLibs,
+                                  bool allowUnsafe);
+  static bool IsAssemblyUpToDate(const std::string& outputFile,
+                                 const std::string& hash);
+  static bool BuildAssembly(const std::string& outputFile,
+                            const std::vector<std::string>& sourceFiles,
+                            const std::string& libDir,
+                            const std::vector<std::string>& linkLibs,
+                            bool allowUnsafe, const std::string& hash);
+  static void SwapAssemblies(const std::string& assemblyPath);
+
+  struct ComponentInfo {
+    std::type_index Type;
+    ComponentGetter Getter;
+    ComponentChecker Checker;
+  };
+
+  // Wrappers are created once per component and kept alive by a GC handle,
+  // scripts get the same object every time they ask for a component.
+  using ComponentWrapperKey = std::tuple<Scene*, entt::entity, std::type_index>;
+
+  using ScriptBatchKey = std::pair<Scene*, ScriptData*>;
+
+  // Calls into managed code, which can create or destroy scripts. Returns
+  // null if the batch was removed meanwhile.
+  static ScriptBatch* RebuildBatch(const ScriptBatchKey& key);
+  static void RunBatches(Scene* scene, float deltaTime, UpdateAllThunk thunk,
+                         ScriptMethod method,
+                         MonoMethod* (ScriptData::*getMethod)() const);
+  static void ClearBatches();
+  static MonoObject* GetComponentWrapper(Scene* scene, entt::entity entity,
+                                         std::type_index type,
+                                         const ComponentGetter& getter);
+  static void FreeComponentWrapper(uint32_t handle);
+  static void ClearComponentWrappers();
+
   static MonoDomain* m_RootDomain;
   static MonoAssembly* m_CoreAssembly;
   static MonoImage* m_CoreAssemblyImage;
@@ -205,12 +397,34 @@ class ScriptManager {
   static MonoClass* m_MonoTransformComponentClass;
   static MonoClass* m_MonoVector3fClass;
   static MonoMethod* m_SetHandleMethod;
-  static std::map<std::string, ComponentGetter> m_ComponentGetters;
-  static std::map<std::type_index, ComponentGetter> m_ComponentGettersByType;
-  static std::map<std::string, ComponentChecker> m_ComponentCheckers;
+  static MonoMethod* m_TransformComponentConstructor;
+  static MonoMethod* m_TransformComponentInvalidate;
+  static MonoClassField* m_BehaviorPtrField;
+  static MonoClassField* m_ScenePtrField;
+  static MonoClassField* m_EntityIdField;
+  static UpdateAllThunk m_UpdateAllThunk;
+  static UpdateAllThunk m_FixedUpdateAllThunk;
+  static std::map<ScriptBatchKey, ScriptBatch> m_ScriptBatches;
+  // Bumped whenever a script is added or removed, loops that call into managed
+  // code use it to tell if the instances they copied are still alive.
+  static uint64_t m_InstancesVersion;
+  // Scripts of each scene by the input events their class handles, filled
+  // when the scripts are instantiated.
+  static std::map<std::pair<Scene*, EventType>, std::vector<ScriptInstance*>>
+      m_EventSubscribers;
+  static std::vector<ComponentInfo> m_Components;
+  static std::map<std::string, int32_t> m_ComponentIds;
+  static std::map<std::type_index, int32_t> m_ComponentIdsByType;
+  static std::map<ComponentWrapperKey, uint32_t> m_ComponentWrappers;
   static std::map<std::string, ScriptData*> m_ScriptData;
   static std::vector<std::string> m_ScriptNames;
   static bool m_EnableDebugger;
+  static bool m_EnableAot;
+  static Scope<ScriptReload> m_Reload;
+  // Build of App loaded in m_AppDomain. Reloads that changed it load a
+  // numbered copy, mono keeps the file mapped while the domain is alive.
+  static std::string m_AppAssemblyPath;
+  static uint32_t m_AppBuildNumber;
 };
 
 }
\ No newline at end of file
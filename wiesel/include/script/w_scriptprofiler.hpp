@@ -0,0 +1,84 @@
+//
+//    Copyright 2023 Metehan Gezer
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+#include "util/w_utils.hpp"
+#include "w_pch.hpp"
+
+namespace Wiesel {
+
+enum class ScriptMethod {
+  OnStart,
+  OnUpdate,
+  OnFixedUpdate,
+  OnKeyPressed,
+  OnKeyReleased,
+  OnMouseMoved,
+  Count
+};
+
+const char* GetScriptMethodName(ScriptMethod method);
+
+// Time spent in one callback of a script class. Updates are batched, a
+// sample covers every instance of the class updated in that frame.
+class ScriptMethodStats {
+ public:
+  void AddSample(std::chrono::nanoseconds time, uint32_t calls);
+
+  WIESEL_GETTER_FN uint64_t GetCalls() const { return m_Calls; }
+  WIESEL_GETTER_FN std::chrono::nanoseconds GetTotal() const {
+    return m_Total;
+  }
+  WIESEL_GETTER_FN std::chrono::nanoseconds GetMax() const { return m_Max; }
+  // Over the recent samples only.
+  WIESEL_GETTER_FN std::chrono::nanoseconds GetP99() const;
+
+ private:
+  static constexpr size_t kSampleCount = 256;
+
+  uint64_t m_Calls = 0;
+  std::chrono::nanoseconds m_Total{0};
+  std::chrono::nanoseconds m_Max{0};
+  std::array<std::chrono::nanoseconds, kSampleCount> m_Samples{};
+  size_t m_SampleCount = 0;
+  size_t m_NextSample = 0;
+};
+
+// Managed heap activity of the last frame.
+struct ScriptGCStats {
+  uint64_t Allocations = 0;
+  uint64_t AllocatedBytes = 0;
+  uint32_t Collections = 0;
+  uint32_t MajorCollections = 0;
+};
+
+/*
+ * Counts managed allocations and collections through the mono profiler API.
+ * Allocations are only reported when the profiler is installed before the
+ * runtime is initialized.
+ */
+class ScriptProfiler {
+ public:
+  static void Init();
+  // Called at the start of every frame.
+  static void EndFrame();
+
+  WIESEL_GETTER_FN static bool IsEnabled() { return s_Enabled; }
+  WIESEL_GETTER_FN static const ScriptGCStats& GetGCStats() {
+    return s_LastFrame;
+  }
+
+ private:
+  static bool s_Enabled;
+  static ScriptGCStats s_LastFrame;
+};
+
+}  // namespace Wiesel
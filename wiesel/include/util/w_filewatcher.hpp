@@ -0,0 +1,38 @@
+//
+//    Copyright 2023 Metehan Gezer
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+#include "util/w_utils.hpp"
+#include "w_pch.hpp"
+
+namespace Wiesel {
+
+/*
+ * Reports the files of a directory that were written since the last poll.
+ * Compares modification times, at most a few times per second.
+ */
+class FileWatcher {
+ public:
+  explicit FileWatcher(const std::string& directory);
+  ~FileWatcher();
+  FileWatcher(const FileWatcher&) = delete;
+
+  // Never blocks, every changed file is reported once.
+  std::vector<std::string> Poll();
+
+ private:
+  std::filesystem::path m_Directory;
+  std::unordered_map<std::string, std::filesystem::file_time_type>
+      m_WriteTimes;
+  std::chrono::steady_clock::time_point m_LastPoll;
+};
+
+}  // namespace Wiesel
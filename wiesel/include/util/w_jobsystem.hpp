@@ -0,0 +1,168 @@
+//
+//    Copyright 2023 Metehan Gezer
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+
+#include "util/w_utils.hpp"
+#include "w_pch.hpp"
+
+namespace Wiesel {
+
+struct JobSystemProperties {
+  // Number of worker threads to spawn, 0 picks hardware concurrency - 1.
+  // The thread that waits on a job always helps executing jobs, so 0 workers
+  // on a single core machine still works, everything runs inline.
+  uint32_t WorkerCount = 0;
+};
+
+struct JobWorkerStats {
+  uint64_t JobCount;
+  std::chrono::nanoseconds BusyTime;
+  // Busy time divided by the time passed since the last ResetWorkerStats.
+  float Utilization;
+};
+
+// Called after every job finishes on the thread that executed it.
+// Thread index 0 is the main thread, or a non-worker thread running its own
+// job when there are no workers.
+using JobProfileHookFn = std::function<void(
+    uint32_t threadIndex, const char* name,
+    std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end)>;
+
+class JobCounter {
+ public:
+  JobCounter() = default;
+  JobCounter(const JobCounter&) = delete;
+
+  WIESEL_GETTER_FN bool IsDone() const {
+    return m_Pending.load(std::memory_order_acquire) == 0;
+  }
+
+ private:
+  friend class JobSystem;
+
+  std::atomic<uint32_t> m_Pending{0};
+  // First exception thrown by one of the jobs.
+  std::mutex m_ExceptionMutex;
+  std::exception_ptr m_Exception;
+};
+
+/*
+ * A set of tasks with dependencies between them. The graph can be built once
+ * and executed every frame, tasks without pending dependencies are pushed to
+ * the job system and the rest are released as their dependencies finish.
+ */
+class JobGraph {
+ public:
+  using TaskId = uint32_t;
+
+  JobGraph() = default;
+  JobGraph(const JobGraph&) = delete;
+
+  TaskId AddTask(const char* name, std::function<void()> fn);
+  // Makes "after" wait until "before" is finished.
+  void AddDependency(TaskId before, TaskId after);
+  // Blocks until every task in the graph is finished, the calling thread
+  // executes jobs while waiting. A task that throws skips its successors, the
+  // exception is rethrown here.
+  void Execute();
+
+  WIESEL_GETTER_FN bool IsEmpty() const { return m_Tasks.empty(); }
+
+ private:
+  void SubmitTask(TaskId id, JobCounter& counter);
+
+ private:
+  struct Task {
+    const char* Name;
+    std::function<void()> Fn;
+    std::vector<TaskId> Successors;
+    uint32_t DependencyCount = 0;
+  };
+
+  std::vector<Task> m_Tasks;
+  std::unique_ptr<std::atomic<uint32_t>[]> m_RemainingDependencies;
+  size_t m_RemainingDependenciesSize = 0;
+};
+
+/*
+ * Work stealing job system. Every thread owns a queue, jobs submitted from a
+ * thread are pushed to its own queue and popped from the back, idle threads
+ * steal from the front of the other queues.
+ */
+class JobSystem {
+ public:
+  static void Init(const JobSystemProperties& props);
+  static void Destroy();
+
+  static void Submit(const char* name, std::function<void()> fn,
+                     JobCounter& counter);
+  // Executes jobs on the calling thread until the counter reaches zero, then
+  // rethrows the first exception one of its jobs threw, no matter which thread
+  // ran it.
+  static void Wait(JobCounter& counter);
+
+  // Splits [0, count) into chunks of grainSize and runs fn for each index,
+  // returns after every index is processed.
+  static void ParallelFor(const char* name, uint32_t count, uint32_t grainSize,
+                          const std::function<void(uint32_t)>& fn);
+
+  // Worker threads + the main thread.
+  WIESEL_GETTER_FN static uint32_t GetThreadCount();
+  // 0 on the main thread, the thread that called Init, 1 and up on workers.
+  // Only these threads run queued jobs, so a job can use the index to pick
+  // per thread resources. Other threads report 0 too but never run jobs
+  // submitted elsewhere, only their own when there are no workers.
+  WIESEL_GETTER_FN static uint32_t GetThreadIndex();
+  WIESEL_GETTER_FN static bool IsExternalThread();
+  WIESEL_GETTER_FN static bool IsInitialized() { return s_Initialized; }
+
+  // Should be set before any job is submitted.
+  static void SetProfileHook(JobProfileHookFn hook);
+  WIESEL_GETTER_FN static std::vector<JobWorkerStats> GetWorkerStats();
+  static void ResetWorkerStats();
+
+ private:
+  struct Job {
+    const char* Name;
+    std::function<void()> Fn;
+    JobCounter* Counter;
+  };
+
+  struct ThreadData {
+    std::mutex QueueMutex;
+    std::deque<Job> Queue;
+    std::atomic<uint64_t> JobCount{0};
+    std::atomic<uint64_t> BusyNanos{0};
+  };
+
+  static void WorkerLoop(uint32_t threadIndex);
+  static bool TryRunJob(uint32_t threadIndex);
+  static bool PopJob(uint32_t threadIndex, Job& job);
+  static void RunJob(uint32_t threadIndex, Job& job);
+
+ private:
+  static bool s_Initialized;
+  static std::atomic<bool> s_Running;
+  static std::vector<Scope<ThreadData>> s_ThreadData;
+  static std::vector<std::thread> s_Workers;
+  static std::atomic<uint32_t> s_QueuedJobs;
+  static std::mutex s_SleepMutex;
+  static std::condition_variable s_SleepCondition;
+  static JobProfileHookFn s_ProfileHook;
+  static std::chrono::steady_clock::time_point s_StatsResetTime;
+};
+
+}  // namespace Wiesel
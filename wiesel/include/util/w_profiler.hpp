@@ -14,8 +14,6 @@
 #include "util/w_logger.hpp"
 #include "w_pch.hpp"
 
-// todo thread safety
-
 namespace Wiesel {
 struct ProfileData {
   std::string Name;
@@ -46,6 +44,8 @@ class Profiler {
  private:
   static bool s_Active;
   static std::vector<ProfileData> s_Data;
+  // jobs insert their data from worker threads
+  static std::mutex s_DataMutex;
   static std::string s_CurrentSection;
 };
 
@@ -20,6 +20,17 @@ void Init();
 void Cleanup();
 void InitResources(TBuiltInResource& resources);
 EShLanguage FindLanguage(ShaderType type);
+std::optional<ShaderType> FindShaderType(const std::filesystem::path& path);
+// Path is used to find included files, next to the file that includes them.
+// Sources have to enable GL_GOOGLE_include_directive to include files.
 bool ShaderToSPV(ShaderType type, const std::vector<char>& input,
-                 std::vector<uint32_t>& output);
+                 std::vector<uint32_t>& output, const std::string& path = "");
+// Compiles the source at path, results are cached by the hash of the source,
+// its includes and the compile options in memory and in the shader cache
+// directory so unchanged sources are never compiled twice. Thread safe.
+bool CompileShader(ShaderType type, const std::string& path,
+                   std::vector<uint32_t>& output);
+// Compiles every shader source in the directory on the job threads, shaders
+// created afterwards find their code in the cache.
+void PrecompileShaders(const std::string& directory);
 }  // namespace Wiesel::Spirv
\ No newline at end of file
@@ -20,11 +20,23 @@
 
 namespace Wiesel {
 
-#define WIESEL_SHADOW_CASCADE_COUNT 4
-#define WIESEL_SSAO_KERNEL_SIZE 24
-#define WIESEL_SSAO_RADIUS 0.5
+// The cascade count, resolution and depth format are picked at runtime from
+// the shadow settings. Keep in sync with lighting_shader.frag.
+#define WIESEL_SHADOW_MAX_CASCADE_COUNT 4
+// Point lights that can cast shadows at the same time, the rest are drawn
+// without. Keep in sync with lighting_shader.frag and light_volume_shader.frag.
+#define WIESEL_MAX_POINT_SHADOWS 32
+// The kernel size and radius are picked at runtime from the ssao quality.
+// Keep in sync with ssao_gen_shader.comp.
+#define WIESEL_SSAO_MAX_KERNEL_SIZE 64
 #define WIESEL_SSAO_NOISE_DIM 8
-#define WIESEL_SHADOWMAP_DIM 4096
+// Keep in sync with ssao_gen_shader.comp and ssao_blur_shader.comp.
+#define WIESEL_SSAO_WORKGROUP_SIZE 8
+// Keep in sync with light_cluster_shader.comp and lighting_shader.frag.
+#define WIESEL_CLUSTER_GRID_X 16
+#define WIESEL_CLUSTER_GRID_Y 9
+#define WIESEL_CLUSTER_GRID_Z 24
+#define WIESEL_MAX_LIGHTS_PER_CLUSTER 128
 
 std::string GetNameFromVulkanResult(VkResult errorCode);
 
@@ -179,35 +191,48 @@ struct alignas(16) CameraUniformData {
   float _pad1[2];
   glm::vec4 CascadeSplits;
   uint32_t EnableSSAO;
+  // Point lights are drawn as light volumes instead of the fullscreen pass.
+  uint32_t EnableLightVolumes;
+  // Positions are reconstructed from the linear depth in the g-buffer.
+  alignas(16) glm::mat4 InvViewMatrix;
 };
 
 struct alignas(16) ShadowMapMatricesUniformData {
-  alignas(16) glm::mat4 ViewProjectionMatrix[WIESEL_SHADOW_CASCADE_COUNT];
+  alignas(16) glm::mat4 ViewProjectionMatrix[WIESEL_SHADOW_MAX_CASCADE_COUNT];
   alignas(16) int32_t EnableShadows;
 };
 
-struct alignas(16) SSAOKernelUniformData {
-  alignas(16) glm::vec4 Samples[WIESEL_SSAO_KERNEL_SIZE];
+// Cube faces of a shadow casting point light in the shadow atlas, in +x, -x,
+// +y, -y, +z, -z order.
+struct alignas(16) PointShadowData {
+  alignas(16) glm::mat4 ViewProjection[6];
+  // Offset in xy and size in zw, in atlas uv.
+  alignas(16) glm::vec4 AtlasRects[6];
+};
+
+struct alignas(16) PointShadowsStorageData {
+  PointShadowData Shadows[WIESEL_MAX_POINT_SHADOWS];
 };
 
-struct SSAOSpecializationData {
-  uint32_t kernelSize = WIESEL_SSAO_KERNEL_SIZE;
-  float radius = WIESEL_SSAO_RADIUS;
+// Cascade count of lighting_shader.frag, the matrices are always sized for the
+// maximum.
+struct ShadowSpecializationData {
+  uint32_t CascadeCount = WIESEL_SHADOW_MAX_CASCADE_COUNT;
 
   std::vector<VkSpecializationMapEntry> GetSpecializationMapEntries() {
     std::vector<VkSpecializationMapEntry> entries;
     entries.push_back(VkSpecializationMapEntry{
         .constantID = 0,
-        .offset = (uint32_t)offsetof(SSAOSpecializationData, kernelSize),
-        .size = sizeof(SSAOSpecializationData::kernelSize)});
-    entries.push_back(VkSpecializationMapEntry{
-        .constantID = 1,
-        .offset = (uint32_t)offsetof(SSAOSpecializationData, radius),
-        .size = sizeof(SSAOSpecializationData::radius)});
+        .offset = (uint32_t)offsetof(ShadowSpecializationData, CascadeCount),
+        .size = sizeof(ShadowSpecializationData::CascadeCount)});
     return entries;
   }
 };
 
+struct alignas(16) SSAOKernelUniformData {
+  alignas(16) glm::vec4 Samples[WIESEL_SSAO_MAX_KERNEL_SIZE];
+};
+
 template <typename T>
 using Weak = std::weak_ptr<T>;
 
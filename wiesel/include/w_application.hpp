@@ -22,6 +22,7 @@
 #include "layer/w_layerimgui.hpp"
 #include "rendering/w_renderer.hpp"
 #include "scene/w_scene.hpp"
+#include "util/w_jobsystem.hpp"
 #include "util/w_profiler.hpp"
 #include "util/w_utils.hpp"
 
@@ -53,6 +54,10 @@ class Application {
   WIESEL_GETTER_FN Ref<AppWindow> GetWindow();
   WIESEL_GETTER_FN float_t GetFPS() const { return m_FPS; }
   WIESEL_GETTER_FN float_t GetDeltaTime() const { return m_DeltaTime; }
+  // Per thread job stats of the last second, index 0 is the main thread.
+  WIESEL_GETTER_FN const std::vector<JobWorkerStats>& GetJobWorkerStats() const {
+    return m_JobWorkerStats;
+  }
   WIESEL_GETTER_FN const WindowSize& GetWindowSize();
   WIESEL_GETTER_FN Ref<Scene> GetScene();
 
@@ -83,10 +88,12 @@ class Application {
   Ref<AppWindow> m_Window;
   float_t m_PreviousFrame = 0.0;
   float_t m_DeltaTime = 0.0;
+  bool m_FirstFrame = true;
 
   float_t m_FPSTimer = 0.0f;
   uint32_t m_FrameCount = 0;
   float_t m_FPS = 0.0f;
+  std::vector<JobWorkerStats> m_JobWorkerStats;
 
   Ref<Scene> m_Scene;  // move this to somewhere else
 
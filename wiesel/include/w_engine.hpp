@@ -12,13 +12,18 @@
 #pragma once
 
 #include "rendering/w_renderer.hpp"
+#include "util/w_jobsystem.hpp"
 #include "w_application.hpp"
 
 namespace Wiesel {
 
+struct EngineProperties {
+  JobSystemProperties JobSystem;
+};
+
 class Engine {
  public:
-  static void InitEngine();
+  static void InitEngine(const EngineProperties&& props = {});
   static void InitWindow(const WindowProperties&& props);
   static void InitRenderer(const RendererProperties&& props);
 
@@ -55,5 +60,8 @@ class Engine {
   static Ref<AppWindow> s_Window;
 };
 
+// Called before the engine is initialized, nothing else is set up yet.
+// Optional, applications that don't define it get the default properties.
+EngineProperties GetEngineProperties();
 Application* CreateApp();
 }  // namespace Wiesel
\ No newline at end of file
@@ -17,7 +17,7 @@ int main() {
   using namespace Wiesel;
 
   std::cout << "Initializing engine...\n";
-  Engine::InitEngine();
+  Engine::InitEngine(GetEngineProperties());
   Application& app = *CreateApp();
   LOG_INFO("Initializing app...");
   app.Init();
@@ -25,5 +25,6 @@ int main() {
   app.Run();
   LOG_INFO("Cleaning up...");
   delete &app;
+  Engine::CleanupEngine();
   LOG_INFO("Done!");
 }
@@ -17,6 +17,8 @@ namespace Wiesel {
 
 void IBehavior::OnUpdate(float_t deltaTime) {}
 
+void IBehavior::OnFixedUpdate(float_t timeStep) {}
+
 void IBehavior::OnEvent(Event& event) {}
 
 void IBehavior::SetEnabled(bool enabled) {
@@ -15,10 +15,12 @@
 
 namespace Wiesel {
 
-std::map<std::string, std::vector<KeyCode>> InputManager::m_KeyboardMapping;
-std::map<KeyCode, KeyData> InputManager::m_Keys;
+std::map<std::string, int32_t> InputManager::m_KeyIds;
+std::vector<std::vector<KeyCode>> InputManager::m_KeyboardMapping;
+std::array<KeyData, KeyMenu + 1> InputManager::m_Keys;
 std::map<MouseCode, KeyData> InputManager::m_MouseButtons;
-std::map<std::string, float> InputManager::m_Axis;
+std::map<std::string, int32_t> InputManager::m_AxisIds;
+std::vector<float> InputManager::m_Axes;
 int InputManager::m_MouseX = 0;
 int InputManager::m_MouseY = 0;
 float InputManager::m_MouseAxisSensX = 80.0f;
@@ -27,37 +29,86 @@ InputMode InputManager::m_InputMode = InputModeKeyboardAndMouse;
 float InputManager::m_MouseAxisLimitY = 75.0f;
 
 void InputManager::Init() {
-  m_KeyboardMapping["Up"] = {KeyArrowUp, KeyW};
-  m_KeyboardMapping["Down"] = {KeyArrowDown, KeyS};
-  m_KeyboardMapping["Left"] = {KeyArrowLeft, KeyA};
-  m_KeyboardMapping["Right"] = {KeyArrowRight, KeyD};
-  m_KeyboardMapping["Jump"] = {KeySpace};
-  m_KeyboardMapping["Enter"] = {KeyEnter};
-  m_KeyboardMapping["Left Shift"] = {KeyLeftShift};
-  m_KeyboardMapping["Right Shift"] = {KeyRightShift};
-  m_KeyboardMapping["Shift"] = {KeyLeftShift, KeyRightShift};
-  m_KeyboardMapping["Left Control"] = {KeyLeftControl};
-  m_KeyboardMapping["Right Control"] = {KeyRightControl};
-  m_KeyboardMapping["Control"] = {KeyLeftControl, KeyRightControl};
-  m_KeyboardMapping["Tab"] = {KeyTab};
-  m_KeyboardMapping["Return"] = {KeyBackspace};
+  AddMapping("Up", {KeyArrowUp, KeyW});
+  AddMapping("Down", {KeyArrowDown, KeyS});
+  AddMapping("Left", {KeyArrowLeft, KeyA});
+  AddMapping("Right", {KeyArrowRight, KeyD});
+  AddMapping("Jump", {KeySpace});
+  AddMapping("Enter", {KeyEnter});
+  AddMapping("Left Shift", {KeyLeftShift});
+  AddMapping("Right Shift", {KeyRightShift});
+  AddMapping("Shift", {KeyLeftShift, KeyRightShift});
+  AddMapping("Left Control", {KeyLeftControl});
+  AddMapping("Right Control", {KeyRightControl});
+  AddMapping("Control", {KeyLeftControl, KeyRightControl});
+  AddMapping("Tab", {KeyTab});
+  AddMapping("Return", {KeyBackspace});
 }
 
-bool InputManager::GetKey(const std::string& key) {
-  for (const auto& code : m_KeyboardMapping[key]) {
-    if (m_Keys[code].Pressed) {
+void InputManager::AddMapping(const std::string& name,
+                              std::vector<KeyCode> keys) {
+  m_KeyIds[name] = static_cast<int32_t>(m_KeyboardMapping.size());
+  m_KeyboardMapping.push_back(std::move(keys));
+}
+
+int32_t InputManager::GetKeyId(const std::string& key) {
+  auto it = m_KeyIds.find(key);
+  if (it == m_KeyIds.end()) {
+    return -1;
+  }
+  return it->second;
+}
+
+int32_t InputManager::GetAxisId(const std::string& axisName) {
+  auto it = m_AxisIds.find(axisName);
+  if (it != m_AxisIds.end()) {
+    return it->second;
+  }
+  int32_t id = static_cast<int32_t>(m_Axes.size());
+  m_AxisIds.insert(std::pair(axisName, id));
+  m_Axes.push_back(0.0f);
+  return id;
+}
+
+bool InputManager::GetKey(int32_t keyId) {
+  if (keyId < 0 || keyId >= static_cast<int32_t>(m_KeyboardMapping.size())) {
+    return false;
+  }
+  for (const auto& code : m_KeyboardMapping[keyId]) {
+    if (IsPressed(code)) {
       return true;
     }
   }
   return false;
 }
 
+bool InputManager::GetKey(const std::string& key) {
+  return GetKey(GetKeyId(key));
+}
+
 bool InputManager::IsPressed(KeyCode code) {
+  if (code < 0 || code > KeyMenu) {
+    return false;
+  }
   return m_Keys[code].Pressed;
 }
 
+void InputManager::SetPressed(KeyCode code, bool pressed) {
+  if (code < 0 || code > KeyMenu) {
+    return;
+  }
+  m_Keys[code].Pressed = pressed;
+}
+
+float InputManager::GetAxis(int32_t axisId) {
+  if (axisId < 0 || axisId >= static_cast<int32_t>(m_Axes.size())) {
+    return 0.0f;
+  }
+  return m_Axes[axisId];
+}
+
 float InputManager::GetAxis(const std::string& axisName) {
-  return m_Axis[axisName];
+  return GetAxis(GetAxisId(axisName));
 }
 
 }  // namespace Wiesel
\ No newline at end of file
@@ -0,0 +1,139 @@
+//
+//    Copyright 2023 Metehan Gezer
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "rendering/w_barrier.hpp"
+
+#include "rendering/w_texture.hpp"
+
+namespace Wiesel {
+
+void BarrierBatch::AddImageBarrier(VkImage image,
+                                   VkImageAspectFlags aspectFlags,
+                                   VkImageLayout oldLayout,
+                                   VkImageLayout newLayout,
+                                   VkPipelineStageFlags srcStages,
+                                   VkAccessFlags srcAccess,
+                                   VkPipelineStageFlags dstStages,
+                                   VkAccessFlags dstAccess, uint32_t baseLayer,
+                                   uint32_t layerCount) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstAccessMask = dstAccess;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = aspectFlags;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+  barrier.subresourceRange.baseArrayLayer = baseLayer;
+  barrier.subresourceRange.layerCount = layerCount;
+  m_ImageBarriers.push_back(barrier);
+  AddStages(srcStages, dstStages);
+}
+
+void BarrierBatch::AddImageBarrier(const AttachmentTexture& texture,
+                                   VkImageLayout oldLayout,
+                                   VkImageLayout newLayout,
+                                   VkPipelineStageFlags srcStages,
+                                   VkAccessFlags srcAccess,
+                                   VkPipelineStageFlags dstStages,
+                                   VkAccessFlags dstAccess,
+                                   uint32_t layerCount) {
+  VkImageAspectFlags aspectFlags = texture.m_AspectFlags;
+  // Layout transitions of a combined depth stencil image have to include both
+  // aspects.
+  if (texture.m_Format == VK_FORMAT_D32_SFLOAT_S8_UINT ||
+      texture.m_Format == VK_FORMAT_D24_UNORM_S8_UINT) {
+    aspectFlags |= VK_IMAGE_ASPECT_STENCIL_BIT;
+  }
+  AddImageBarrier(texture.m_Images[0], aspectFlags, oldLayout, newLayout,
+                  srcStages, srcAccess, dstStages, dstAccess, 0, layerCount);
+}
+
+void BarrierBatch::AddBufferBarrier(VkBuffer buffer,
+                                    VkPipelineStageFlags srcStages,
+                                    VkAccessFlags srcAccess,
+                                    VkPipelineStageFlags dstStages,
+                                    VkAccessFlags dstAccess,
+                                    VkDeviceSize offset, VkDeviceSize size) {
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstAccessMask = dstAccess;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = buffer;
+  barrier.offset = offset;
+  barrier.size = size;
+  m_BufferBarriers.push_back(barrier);
+  AddStages(srcStages, dstStages);
+}
+
+void BarrierBatch::AddMemoryBarrier(VkPipelineStageFlags srcStages,
+                                    VkAccessFlags srcAccess,
+                                    VkPipelineStageFlags dstStages,
+                                    VkAccessFlags dstAccess) {
+  m_MemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  m_MemoryBarrier.srcAccessMask |= srcAccess;
+  m_MemoryBarrier.dstAccessMask |= dstAccess;
+  m_HasMemoryBarrier = true;
+  AddStages(srcStages, dstStages);
+}
+
+void BarrierBatch::Record(VkCommandBuffer commandBuffer) const {
+  if (IsEmpty()) {
+    return;
+  }
+  vkCmdPipelineBarrier(
+      commandBuffer, m_SrcStages, m_DstStages, 0, m_HasMemoryBarrier ? 1 : 0,
+      m_HasMemoryBarrier ? &m_MemoryBarrier : nullptr,
+      static_cast<uint32_t>(m_BufferBarriers.size()), m_BufferBarriers.data(),
+      static_cast<uint32_t>(m_ImageBarriers.size()), m_ImageBarriers.data());
+}
+
+void BarrierBatch::Record(const CommandBuffer& commandBuffer) const {
+  Record(commandBuffer.m_Handle);
+}
+
+void BarrierBatch::Flush(VkCommandBuffer commandBuffer) {
+  Record(commandBuffer);
+  Clear();
+}
+
+void BarrierBatch::Flush(const CommandBuffer& commandBuffer) {
+  Flush(commandBuffer.m_Handle);
+}
+
+void BarrierBatch::Clear() {
+  m_SrcStages = 0;
+  m_DstStages = 0;
+  m_HasMemoryBarrier = false;
+  m_MemoryBarrier = {};
+  m_BufferBarriers.clear();
+  m_ImageBarriers.clear();
+}
+
+bool BarrierBatch::IsEmpty() const {
+  return !m_HasMemoryBarrier && m_BufferBarriers.empty() &&
+         m_ImageBarriers.empty();
+}
+
+void BarrierBatch::AddStages(VkPipelineStageFlags srcStages,
+                             VkPipelineStageFlags dstStages) {
+  // Nothing to wait for, the barrier only changes the layout.
+  m_SrcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+  m_DstStages |=
+      dstStages != 0 ? dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+}
+
+}  // namespace Wiesel
@@ -26,6 +26,7 @@ MemoryBuffer::~MemoryBuffer() {
       Engine::GetRenderer()->DestroyIndexBuffer(*this);
       break;
     case MemoryTypeUniformBuffer:
+    case MemoryTypeStorageBuffer:
       // this is handled by the object
       break;
   }
@@ -39,4 +40,11 @@ UniformBuffer::~UniformBuffer() {
   Engine::GetRenderer()->DestroyUniformBuffer(*this);
 }
 
+StorageBuffer::StorageBuffer()
+    : MemoryBuffer(MemoryTypeStorageBuffer), m_Data(nullptr) {}
+
+StorageBuffer::~StorageBuffer() {
+  Engine::GetRenderer()->DestroyStorageBuffer(*this);
+}
+
 }  // namespace Wiesel
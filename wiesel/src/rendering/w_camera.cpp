@@ -20,6 +20,8 @@ void CameraComponent::UpdateProjection() {
       -1;  // glm is originally designed for OpenGL, which Y coords where flipped
   InvProjection = glm::inverse(Projection);
   IsAnyChanged = true;
+  // Splits depend on the projection, cascades have to be refitted.
+  ForceLightReset = true;
 }
 
 void CameraComponent::UpdateView(const glm::mat4& worldTransform) {
@@ -30,16 +32,22 @@ void CameraComponent::UpdateView(const glm::mat4& worldTransform) {
 
 void CameraComponent::UpdateAll() {
   ExtractFrustumPlanes();
-  ForceLightReset = true;
 }
 
 void CameraComponent::ComputeCascades(const glm::vec3& lightDir) {
-  /*if (!ForceLightReset && PreviousLightDir == lightDir) {
-    return;
-  }*/
+  bool lightChanged = ForceLightReset || PreviousLightDir != lightDir;
 
   float cascadeSplitLambda = 0.95f;
-  float cascadeSplits[WIESEL_SHADOW_CASCADE_COUNT];
+  // Cascades are fitted to a slightly larger sphere than the slice needs, so
+  // small camera movements don't move the cascade and the cached static
+  // casters can be reused.
+  float cascadePadding = 1.2f;
+  float cascadeSplits[WIESEL_SHADOW_MAX_CASCADE_COUNT];
+  if (ShadowCascadeCount == 0) {
+    // Shadow maps are not created yet
+    DoesShadowPass = false;
+    return;
+  }
 
   float clipRange = FarPlane - NearPlane;
   float minZ = NearPlane;
@@ -49,8 +57,8 @@ void CameraComponent::ComputeCascades(const glm::vec3& lightDir) {
   float ratio = maxZ / minZ;
 
   // Calculate split depths
-  for (uint32_t i = 0; i < WIESEL_SHADOW_CASCADE_COUNT; ++i) {
-    float p = (i + 1.0f) / static_cast<float>(WIESEL_SHADOW_CASCADE_COUNT);
+  for (uint32_t i = 0; i < ShadowCascadeCount; ++i) {
+    float p = (i + 1.0f) / static_cast<float>(ShadowCascadeCount);
     float log = minZ * std::pow(ratio, p);
     float uniform = minZ + range * p;
     float d = cascadeSplitLambda * (log - uniform) + uniform;
@@ -59,7 +67,7 @@ void CameraComponent::ComputeCascades(const glm::vec3& lightDir) {
 
   // Calculate orthographic projection matrix for each cascade
   float lastSplitDist = 0.0;
-  for (uint32_t i = 0; i < WIESEL_SHADOW_CASCADE_COUNT; i++) {
+  for (uint32_t i = 0; i < ShadowCascadeCount; i++) {
     float splitDist = cascadeSplits[i];
 
     glm::vec3 frustumCorners[8] = {
@@ -90,18 +98,25 @@ void CameraComponent::ComputeCascades(const glm::vec3& lightDir) {
 
     float radius = 0.0f;
     for (uint32_t j = 0; j < 8; j++) {
-      glm::vec3 cornerToCenter = frustumCorners[j] - frustumCenter;
-      float projX = glm::dot(cornerToCenter, glm::normalize(glm::vec3(1,0,0)));
-      float projY = glm::dot(cornerToCenter, glm::normalize(glm::vec3(0,1,0)));
-      float projZ = glm::dot(cornerToCenter, glm::normalize(lightDir)); // directional depth
-      radius = glm::max(radius, glm::length(glm::vec3(projX, projY, projZ)));
+      radius = glm::max(radius, glm::length(frustumCorners[j] - frustumCenter));
     }
-    radius = std::ceil(radius * 16.0f) / 16.0f;
+
+    Cascade& cascade = ShadowMapCascades[i];
+    cascade.SplitDepth = (NearPlane + splitDist * clipRange) * -1.0f;
+    lastSplitDist = cascadeSplits[i];
+    if (!lightChanged &&
+        glm::distance(frustumCenter, cascade.Center) + radius <=
+            cascade.Radius) {
+      // Slice is still covered by the cached cascade
+      continue;
+    }
+
+    radius = std::ceil(radius * cascadePadding * 16.0f) / 16.0f;
 
     glm::vec3 maxExtents = glm::vec3(radius);
     glm::vec3 minExtents = -maxExtents;
 
-    float texelSize = (radius * 2.0f) / WIESEL_SHADOWMAP_DIM;
+    float texelSize = (radius * 2.0f) / ShadowMapResolution;
     glm::vec3 shadowCamPos = frustumCenter + lightDir * -minExtents.z;
     shadowCamPos /= texelSize;
     shadowCamPos = glm::floor(shadowCamPos);
@@ -115,10 +130,11 @@ void CameraComponent::ComputeCascades(const glm::vec3& lightDir) {
         minExtents.z - 10.0f, maxExtents.z + 10.0f
     );
     lightOrthoMatrix[1][1] *= -1;
-    // Store split distance and matrix in cascade
-    ShadowMapCascades[i].SplitDepth = (NearPlane + splitDist * clipRange) * -1.0f;
-    ShadowMapCascades[i].ViewProjMatrix = lightOrthoMatrix * lightViewMatrix;
-    lastSplitDist = cascadeSplits[i];
+    // Store matrix and the sphere it covers in cascade
+    cascade.ViewProjMatrix = lightOrthoMatrix * lightViewMatrix;
+    cascade.Center = frustumCenter;
+    cascade.Radius = radius;
+    cascade.IsStaticDirty = true;
   }
 
   PreviousLightDir = lightDir;
@@ -126,23 +142,51 @@ void CameraComponent::ComputeCascades(const glm::vec3& lightDir) {
   ForceLightReset = false;
 }
 
+void CameraComponent::InvalidateStaticShadows() {
+  for (Cascade& cascade : ShadowMapCascades) {
+    cascade.IsStaticDirty = true;
+  }
+}
+
 void CameraComponent::ExtractFrustumPlanes() {
-  glm::mat4 m = Projection * ViewMatrix;
-  // Each plane is in the form (a,b,c,d), representing ax + by + cz + d = 0
-  Planes.Left = glm::normalize(glm::vec4(m[0][3] + m[0][0], m[1][3] + m[1][0],
+  Planes = FrustumPlanes::FromMatrix(Projection * ViewMatrix);
+}
+
+// Divides by the length of the normal only, so the distance to the plane is
+// in world units.
+static glm::vec4 NormalizePlane(const glm::vec4& plane) {
+  return plane / glm::length(glm::vec3(plane));
+}
+
+FrustumPlanes FrustumPlanes::FromMatrix(const glm::mat4& viewProjection) {
+  const glm::mat4& m = viewProjection;
+  // Each plane is in the form (a,b,c,d), representing ax + by + cz + d = 0.
+  // Depth goes from 0 to 1, the near plane is the z row alone.
+  FrustumPlanes planes;
+  planes.Left = NormalizePlane(glm::vec4(m[0][3] + m[0][0], m[1][3] + m[1][0],
                                          m[2][3] + m[2][0], m[3][3] + m[3][0]));
-  Planes.Right =
-      glm::normalize(glm::vec4(m[0][3] - m[0][0], m[1][3] - m[1][0],
+  planes.Right =
+      NormalizePlane(glm::vec4(m[0][3] - m[0][0], m[1][3] - m[1][0],
                                m[2][3] - m[2][0], m[3][3] - m[3][0]));
-  Planes.Bottom =
-      glm::normalize(glm::vec4(m[0][3] + m[0][1], m[1][3] + m[1][1],
+  planes.Bottom =
+      NormalizePlane(glm::vec4(m[0][3] + m[0][1], m[1][3] + m[1][1],
                                m[2][3] + m[2][1], m[3][3] + m[3][1]));
-  Planes.Top = glm::normalize(glm::vec4(m[0][3] - m[0][1], m[1][3] - m[1][1],
+  planes.Top = NormalizePlane(glm::vec4(m[0][3] - m[0][1], m[1][3] - m[1][1],
                                         m[2][3] - m[2][1], m[3][3] - m[3][1]));
-  Planes.Near = glm::normalize(glm::vec4(m[0][3] + m[0][2], m[1][3] + m[1][2],
-                                         m[2][3] + m[2][2], m[3][3] + m[3][2]));
-  Planes.Far = glm::normalize(glm::vec4(m[0][3] - m[0][2], m[1][3] - m[1][2],
+  planes.Near = NormalizePlane(glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]));
+  planes.Far = NormalizePlane(glm::vec4(m[0][3] - m[0][2], m[1][3] - m[1][2],
                                         m[2][3] - m[2][2], m[3][3] - m[3][2]));
+  return planes;
+}
+
+bool FrustumPlanes::IntersectsSphere(const glm::vec3& center,
+                                     float radius) const {
+  for (const glm::vec4& plane : {Left, Right, Bottom, Top, Near, Far}) {
+    if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+      return false;
+    }
+  }
+  return true;
 }
 
 }  // namespace Wiesel
@@ -3,6 +3,8 @@
 //
 
 #include "rendering/w_command.hpp"
+#include "rendering/w_framebuffer.hpp"
+#include "rendering/w_renderpass.hpp"
 #include "w_engine.hpp"
 namespace Wiesel {
 
@@ -19,33 +21,43 @@ CommandPool::~CommandPool() {
   vkDestroyCommandPool(Engine::GetRenderer()->GetLogicalDevice(), m_Handle, nullptr);
 }
 
-Ref<CommandBuffer> CommandPool::CreateBuffer() {
-  if (!m_FreeBuffers.empty()) {
-    VkCommandBuffer buffer = m_FreeBuffers.front();
-    m_FreeBuffers.pop_front();
-    return CreateReference<CommandBuffer>(*this, buffer);
+Ref<CommandBuffer> CommandPool::CreateBuffer(VkCommandBufferLevel level) {
+  auto& freeBuffers = level == VK_COMMAND_BUFFER_LEVEL_SECONDARY
+                          ? m_FreeSecondaryBuffers
+                          : m_FreeBuffers;
+  if (!freeBuffers.empty()) {
+    VkCommandBuffer buffer = freeBuffers.front();
+    freeBuffers.pop_front();
+    return CreateReference<CommandBuffer>(*this, buffer, level);
   }
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   allocInfo.commandPool = m_Handle;
-  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.level = level;
   allocInfo.commandBufferCount = 1;
 
   VkCommandBuffer buffer;
   WIESEL_CHECK_VKRESULT(
       vkAllocateCommandBuffers(Engine::GetRenderer()->GetLogicalDevice(), &allocInfo, &buffer));
-  return CreateReference<CommandBuffer>(*this, buffer);
+  return CreateReference<CommandBuffer>(*this, buffer, level);
 }
 
-void CommandPool::ReturnBuffer(VkCommandBuffer buffer) {
-  m_FreeBuffers.push_back(buffer);
+void CommandPool::ReturnBuffer(VkCommandBuffer buffer,
+                               VkCommandBufferLevel level) {
+  if (level == VK_COMMAND_BUFFER_LEVEL_SECONDARY) {
+    m_FreeSecondaryBuffers.push_back(buffer);
+  } else {
+    m_FreeBuffers.push_back(buffer);
+  }
 }
 
-CommandBuffer::CommandBuffer(CommandPool& pool, VkCommandBuffer commandBuffer) : m_Pool(pool), m_Handle(commandBuffer) {
+CommandBuffer::CommandBuffer(CommandPool& pool, VkCommandBuffer commandBuffer,
+                             VkCommandBufferLevel level)
+    : m_Pool(pool), m_Handle(commandBuffer), m_Level(level) {
 }
 
 CommandBuffer::~CommandBuffer() {
-  m_Pool.ReturnBuffer(m_Handle);
+  m_Pool.ReturnBuffer(m_Handle, m_Level);
 }
 
 void CommandBuffer::Begin() {
@@ -57,6 +69,23 @@ void CommandBuffer::Begin() {
   WIESEL_CHECK_VKRESULT(vkBeginCommandBuffer(m_Handle, &beginInfo));
 }
 
+void CommandBuffer::Begin(const RenderPass& renderPass,
+                          const Framebuffer& framebuffer) {
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass = renderPass.GetVulkanHandle();
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer = framebuffer.m_Handle;
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+                    VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+  WIESEL_CHECK_VKRESULT(vkBeginCommandBuffer(m_Handle, &beginInfo));
+}
+
 void CommandBuffer::End() {
   WIESEL_CHECK_VKRESULT(vkEndCommandBuffer(m_Handle));
 }
@@ -10,6 +10,7 @@
 //
 
 #include "rendering/w_descriptor.hpp"
+#include "rendering/w_buffer.hpp"
 #include "rendering/w_texture.hpp"
 #include "rendering/w_image.hpp"
 #include "rendering/w_sampler.hpp"
@@ -37,13 +38,24 @@ void DescriptorSet::Bake() {
                             nullptr);
     m_Allocated = false;
   }
-  VkDescriptorPoolSize poolSizes[] = {
-      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1}};
+  // One descriptor per binding of the layout.
+  std::vector<VkDescriptorPoolSize> poolSizes;
+  for (const auto& binding : m_Layout->m_Bindings) {
+    auto it = std::find_if(poolSizes.begin(), poolSizes.end(),
+                           [&binding](const VkDescriptorPoolSize& size) {
+                             return size.type == binding.Type;
+                           });
+    if (it != poolSizes.end()) {
+      it->descriptorCount++;
+    } else {
+      poolSizes.push_back({binding.Type, 1});
+    }
+  }
 
   VkDescriptorPoolCreateInfo poolInfo{};
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  poolInfo.poolSizeCount = std::size(poolSizes);
-  poolInfo.pPoolSizes = poolSizes;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
   poolInfo.maxSets = 1;
 
   // Allocate pool
@@ -61,11 +73,12 @@ void DescriptorSet::Bake() {
                                                  &m_DescriptorSet));
 
   std::vector<VkWriteDescriptorSet> writes;
-  writes.reserve(m_CombinedImageSamplers.size() + m_UniformBufferData.size());
+  writes.reserve(m_CombinedImageSamplers.size() + m_StorageImages.size() +
+                 m_UniformBufferData.size() + m_StorageBufferData.size());
   std::vector<VkDescriptorBufferInfo> bufferInfos;
-  bufferInfos.reserve(m_UniformBufferData.size());
+  bufferInfos.reserve(m_UniformBufferData.size() + m_StorageBufferData.size());
   std::vector<VkDescriptorImageInfo> imageInfos;
-  imageInfos.reserve(m_CombinedImageSamplers.size());
+  imageInfos.reserve(m_CombinedImageSamplers.size() + m_StorageImages.size());
 
   for (const auto& item : m_CombinedImageSamplers) {
     VkDescriptorImageInfo imageInfo;
@@ -86,6 +99,25 @@ void DescriptorSet::Bake() {
     writes.emplace_back(set);
   }
 
+  for (const auto& item : m_StorageImages) {
+    VkDescriptorImageInfo imageInfo;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageInfo.imageView = item.ImageView->m_Handle;
+    imageInfo.sampler = VK_NULL_HANDLE;
+    imageInfos.emplace_back(imageInfo);
+
+    VkWriteDescriptorSet set{};
+    set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    set.dstSet = m_DescriptorSet;
+    set.dstBinding = item.DstBinding;
+    set.dstArrayElement = 0;
+    set.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    set.descriptorCount = 1;
+    set.pImageInfo = &imageInfos.back();
+    set.pNext = nullptr;
+    writes.emplace_back(set);
+  }
+
   for (const auto& item : m_UniformBufferData) {
     VkDescriptorBufferInfo bufferInfo;
     bufferInfo.buffer = item.Ubo->m_Buffer;
@@ -104,6 +136,25 @@ void DescriptorSet::Bake() {
     set.pNext = nullptr;
     writes.emplace_back(set);
   }
+
+  for (const auto& item : m_StorageBufferData) {
+    VkDescriptorBufferInfo bufferInfo;
+    bufferInfo.buffer = item.Ssbo->m_Buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = item.Ssbo->m_Size;
+    bufferInfos.emplace_back(bufferInfo);
+
+    VkWriteDescriptorSet set{};
+    set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    set.dstSet = m_DescriptorSet;
+    set.dstBinding = item.DstBinding;
+    set.dstArrayElement = 0;
+    set.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    set.descriptorCount = 1;
+    set.pBufferInfo = &bufferInfos.back();
+    set.pNext = nullptr;
+    writes.emplace_back(set);
+  }
   vkUpdateDescriptorSets(Engine::GetRenderer()->GetLogicalDevice(), static_cast<uint32_t>(writes.size()),
                          writes.data(), 0, nullptr);
 
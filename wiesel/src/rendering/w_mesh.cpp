@@ -49,6 +49,21 @@ void Mesh::Allocate() {
     Deallocate();
   }
 
+  if (!Vertices.empty()) {
+    glm::vec3 min = Vertices[0].Pos;
+    glm::vec3 max = Vertices[0].Pos;
+    for (const auto& vertex : Vertices) {
+      min = glm::min(min, vertex.Pos);
+      max = glm::max(max, vertex.Pos);
+    }
+    BoundsCenter = (min + max) * 0.5f;
+    BoundsRadius = 0.0f;
+    for (const auto& vertex : Vertices) {
+      BoundsRadius =
+          std::max(BoundsRadius, glm::distance(BoundsCenter, vertex.Pos));
+    }
+  }
+
   VertexBuffer = Engine::GetRenderer()->CreateVertexBuffer(Vertices);
   IndexBuffer = Engine::GetRenderer()->CreateIndexBuffer(Indices);
   UniformBuffer = Engine::GetRenderer()->CreateUniformBuffer(
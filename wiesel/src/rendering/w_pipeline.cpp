@@ -56,6 +56,7 @@ void Pipeline::SetVertexData(std::vector<VkVertexInputBindingDescription> inputB
 }
 
 void Pipeline::Bake() {
+  m_Generation++;
   if (m_IsAllocated) {
     vkDestroyPipeline(Engine::GetRenderer()->GetLogicalDevice(), m_Pipeline, nullptr);
     vkDestroyPipelineLayout(Engine::GetRenderer()->GetLogicalDevice(), m_Layout, nullptr);
@@ -89,7 +90,7 @@ void Pipeline::Bake() {
 
   std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
   std::vector<VkSpecializationInfo> specializationInfos;
-  specializationInfos.reserve(m_Shaders.size());
+  specializationInfos.resize(m_Shaders.size());
   uint32_t specializationIndex = 0;
   for (const auto& info : m_Shaders) {
     VkPipelineShaderStageCreateInfo stageInfo{};
@@ -102,7 +103,7 @@ void Pipeline::Bake() {
       specializationInfos[specializationIndex] = VkSpecializationInfo{
           .mapEntryCount = static_cast<uint32_t>(info.Specialization.MapEntries.size()),
           .pMapEntries = info.Specialization.MapEntries.data(),
-          .dataSize = sizeof(info.Specialization.DataSize),
+          .dataSize = info.Specialization.DataSize,
           .pData = info.Specialization.Data
       };
       stageInfo.pSpecializationInfo = &specializationInfos[specializationIndex];
@@ -111,6 +112,43 @@ void Pipeline::Bake() {
     shaderStages.push_back(stageInfo);
   }
 
+  Ref<Renderer> renderer = Engine::GetRenderer();
+  VkPipelineCreationFeedbackEXT feedback{};
+  std::vector<VkPipelineCreationFeedbackEXT> stageFeedbacks(shaderStages.size());
+  VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo{};
+  feedbackInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+  feedbackInfo.pPipelineCreationFeedback = &feedback;
+  feedbackInfo.pipelineStageCreationFeedbackCount = stageFeedbacks.size();
+  feedbackInfo.pPipelineStageCreationFeedbacks = stageFeedbacks.data();
+  const void* next =
+      renderer->HasPipelineCreationFeedback() ? &feedbackInfo : nullptr;
+  std::chrono::steady_clock::time_point start;
+  auto recordCreation = [&]() {
+    renderer->RecordPipelineCreation(
+        feedback.flags &
+            VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start));
+  };
+
+  if (IsCompute()) {
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = next;
+    pipelineInfo.stage = shaderStages[0];
+    pipelineInfo.layout = m_Layout;
+
+    start = std::chrono::steady_clock::now();
+    WIESEL_CHECK_VKRESULT(vkCreateComputePipelines(
+        renderer->GetLogicalDevice(), renderer->GetPipelineCache(), 1,
+        &pipelineInfo, nullptr, &m_Pipeline));
+    recordCreation();
+
+    m_IsAllocated = true;
+    return;
+  }
+
   std::vector<VkDynamicState> dynamicStates;
   dynamicStates.push_back(VK_DYNAMIC_STATE_VIEWPORT);
   dynamicStates.push_back(VK_DYNAMIC_STATE_SCISSOR);
@@ -200,7 +238,15 @@ void Pipeline::Bake() {
     colorBlendAttachment.colorWriteMask =
         VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
         VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    if (m_Properties.m_EnableAlphaBlending) {
+    if (m_Properties.m_EnableAdditiveBlending) {
+      colorBlendAttachment.blendEnable = VK_TRUE;
+      colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+      colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+      colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+      colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+      colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+      colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    } else if (m_Properties.m_EnableAlphaBlending) {
       colorBlendAttachment.blendEnable = VK_TRUE;
       colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
       colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
@@ -241,6 +287,7 @@ void Pipeline::Bake() {
 
   VkGraphicsPipelineCreateInfo pipelineInfo{};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineInfo.pNext = next;
   pipelineInfo.stageCount = shaderStages.size();
   pipelineInfo.pStages = shaderStages.data();
 
@@ -256,18 +303,63 @@ void Pipeline::Bake() {
   pipelineInfo.renderPass = m_RenderPass->GetVulkanHandle();
   pipelineInfo.subpass = 0;
 
-  WIESEL_CHECK_VKRESULT(
-      vkCreateGraphicsPipelines(Engine::GetRenderer()->GetLogicalDevice(), VK_NULL_HANDLE, 1,
-                                &pipelineInfo, nullptr, &m_Pipeline));
+  start = std::chrono::steady_clock::now();
+  WIESEL_CHECK_VKRESULT(vkCreateGraphicsPipelines(
+      renderer->GetLogicalDevice(), renderer->GetPipelineCache(), 1,
+      &pipelineInfo, nullptr, &m_Pipeline));
+  recordCreation();
 
   m_IsAllocated = true;
 }
 
+Ref<Pipeline> Pipeline::Clone() const {
+  auto clone = CreateReference<Pipeline>(m_Properties);
+  clone->m_Shaders = m_Shaders;
+  clone->m_DynamicStates = m_DynamicStates;
+  clone->m_RenderPass = m_RenderPass;
+  clone->m_DescriptorLayouts = m_DescriptorLayouts;
+  clone->m_HasVertexBinding = m_HasVertexBinding;
+  clone->m_VertexInputBindingDescriptions = m_VertexInputBindingDescriptions;
+  clone->m_VertexAttributeDescriptions = m_VertexAttributeDescriptions;
+  clone->m_PushConstants = m_PushConstants;
+  return clone;
+}
+
+void Pipeline::TakeHandles(Pipeline& other) {
+  std::swap(m_Layout, other.m_Layout);
+  std::swap(m_Pipeline, other.m_Pipeline);
+  std::swap(m_Shaders, other.m_Shaders);
+  std::swap(m_IsAllocated, other.m_IsAllocated);
+  m_Generation++;
+}
+
+bool Pipeline::UsesShader(const std::string& path) const {
+  std::filesystem::path normalized =
+      std::filesystem::path(path).lexically_normal();
+  for (const auto& info : m_Shaders) {
+    if (std::filesystem::path(info.Shader->m_Properties.Path)
+            .lexically_normal() == normalized) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Pipeline::IsCompute() const {
+  return m_Shaders.size() == 1 &&
+         m_Shaders[0].Shader->m_Properties.Type == ShaderTypeCompute;
+}
+
 void Pipeline::Bind(PipelineBindPoint bindPoint) {
-  vkCmdBindPipeline(Engine::GetRenderer()->GetCommandBuffer().m_Handle, ToVkPipelineBindPoint(bindPoint),
+  Bind(bindPoint, Engine::GetRenderer()->GetCommandBuffer());
+}
+
+void Pipeline::Bind(PipelineBindPoint bindPoint,
+                    const CommandBuffer& commandBuffer) {
+  vkCmdBindPipeline(commandBuffer.m_Handle, ToVkPipelineBindPoint(bindPoint),
                     m_Pipeline);
   for (const auto& item : m_PushConstants) {
-    vkCmdPushConstants(Engine::GetRenderer()->GetCommandBuffer().m_Handle, m_Layout,
+    vkCmdPushConstants(commandBuffer.m_Handle, m_Layout,
                        item.Flags, 0, item.Size, item.Ref.get());
   }
 }
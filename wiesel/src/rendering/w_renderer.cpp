@@ -12,14 +12,54 @@
 #include "rendering/w_renderer.hpp"
 #include <random>
 #include <rendering/w_sampler.hpp>
+#include "rendering/w_barrier.hpp"
 
 #include "util/imgui/imgui_spectrum.hpp"
+#include "util/w_jobsystem.hpp"
 #include "util/w_spirv.hpp"
 #include "util/w_vectors.hpp"
 #include "w_engine.hpp"
 
 namespace Wiesel {
 
+SSAOQualitySettings GetSSAOQualitySettings(SSAOQuality quality) {
+  switch (quality) {
+    case SSAOQuality::Low:
+      return {8, 0.35f};
+    case SSAOQuality::Medium:
+      return {16, 0.5f};
+    case SSAOQuality::High:
+      return {32, 0.5f};
+    case SSAOQuality::Ultra:
+      return {WIESEL_SSAO_MAX_KERNEL_SIZE, 0.6f};
+  }
+  throw std::runtime_error("Unknown ssao quality!");
+}
+
+const char* GetSSAOQualityName(SSAOQuality quality) {
+  switch (quality) {
+    case SSAOQuality::Low:
+      return "Low";
+    case SSAOQuality::Medium:
+      return "Medium";
+    case SSAOQuality::High:
+      return "High";
+    case SSAOQuality::Ultra:
+      return "Ultra";
+  }
+  return "Unknown";
+}
+
+const char* GetShadowDepthFormatName(ShadowDepthFormat format) {
+  switch (format) {
+    case ShadowDepthFormat::D16:
+      return "D16";
+    case ShadowDepthFormat::D32:
+      return "D32";
+  }
+  return "Unknown";
+}
+
 Renderer::Renderer(Ref<AppWindow> window) : m_Window(window) {
   Spirv::Init();
 #ifdef VULKAN_VALIDATION
@@ -34,6 +74,14 @@ Renderer::Renderer(Ref<AppWindow> window) : m_Window(window) {
   m_RecreatePipeline = false;
   m_EnableWireframe = false;
   m_EnableSSAO = true;
+  m_SSAOQuality = SSAOQuality::High;
+  m_ShadowSettings = {};
+  m_NextShadowSettings = {};
+  m_RecreateShadowResources = false;
+  m_ShadowResourcesVersion = 1;
+  m_EnableLightVolumes = false;
+  m_EnableParallelRecording = true;
+  m_EnableShaderHotReload = true;
   m_RecreateSwapChain = false;
   m_SwapChainCreated = false;
   m_Vsync = true;
@@ -55,18 +103,30 @@ void Renderer::Initialize(const RendererProperties&& properties) {
   CreateSurface();
   PickPhysicalDevice();
   CreateLogicalDevice();
+  CreatePipelineCache();
   CreateGlobalUniformBuffers();
   // ---
   CreateCommandPools();
   CreateDescriptorLayouts();
   CreateSwapChain();
   CreateGeometryRenderPass();
+  Spirv::PrecompileShaders("assets/shaders");
   CreateGeometryGraphicsPipelines();
   CreatePresentGraphicsPipelines();
   CreateCommandBuffers();
   CreatePermanentResources();
   CreateSyncObjects();
   m_Initialized = true;
+
+  PipelineCacheStats& stats = m_PipelineCacheStats;
+  stats.StartupCreationTime = stats.CreationTime;
+  LOG_INFO("Created {} pipelines in {:.2f} ms with a {} pipeline cache",
+           stats.PipelineCount, stats.CreationTime.count() / 1000.0,
+           stats.LoadedFromDisk ? "warm" : "cold");
+  if (stats.HasFeedback) {
+    LOG_INFO("Pipeline cache hits: {}/{}", stats.CacheHits,
+             stats.PipelineCount);
+  }
 }
 
 VkDevice Renderer::GetLogicalDevice() {
@@ -176,6 +236,31 @@ Ref<UniformBuffer> Renderer::CreateUniformBuffer(VkDeviceSize size) {
   return uniformBuffer;
 }
 
+Ref<StorageBuffer> Renderer::CreateStorageBuffer(VkDeviceSize size,
+                                                 bool hostVisible) {
+  Ref<StorageBuffer> storageBuffer = CreateReference<StorageBuffer>();
+  storageBuffer->m_Size = size;
+  if (!hostVisible) {
+    CreateBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, storageBuffer->m_Buffer,
+                 storageBuffer->m_BufferMemory);
+    return storageBuffer;
+  }
+
+  CreateBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               storageBuffer->m_Buffer, storageBuffer->m_BufferMemory);
+
+  WIESEL_CHECK_VKRESULT(vkMapMemory(m_LogicalDevice,
+                                    storageBuffer->m_BufferMemory, 0, size, 0,
+                                    &storageBuffer->m_Data));
+
+  memset(storageBuffer->m_Data, 0, size);
+
+  return storageBuffer;
+}
+
 void Renderer::DestroyIndexBuffer(MemoryBuffer& buffer) {
   vkDeviceWaitIdle(m_LogicalDevice);
   vkDestroyBuffer(m_LogicalDevice, buffer.m_Buffer, nullptr);
@@ -188,93 +273,101 @@ void Renderer::DestroyUniformBuffer(UniformBuffer& buffer) {
   vkFreeMemory(m_LogicalDevice, buffer.m_BufferMemory, nullptr);
 }
 
+void Renderer::DestroyStorageBuffer(StorageBuffer& buffer) {
+  vkDeviceWaitIdle(m_LogicalDevice);
+  vkDestroyBuffer(m_LogicalDevice, buffer.m_Buffer, nullptr);
+  vkFreeMemory(m_LogicalDevice, buffer.m_BufferMemory, nullptr);
+}
+
 void Renderer::SetupCameraComponent(CameraComponent& component) {
   component.AspectRatio = Engine::GetRenderer()->GetAspectRatio();
   VkExtent2D extent = Engine::GetRenderer()->GetExtent();
   component.ViewportSize.x = extent.width;
   component.ViewportSize.y = extent.height;
 
+  bool msaa = m_MsaaSamples > VK_SAMPLE_COUNT_1_BIT;
+  // Msaa images are only sampled when there is nothing to resolve them into,
+  // otherwise they never leave their render pass.
+  bool sampleMsaaImages = !msaa;
+  // The single sampled images that are sampled later, the msaa images
+  // themselves when msaa is disabled.
+  AttachmentTextureType sampledType =
+      msaa ? AttachmentTextureType::Resolve : AttachmentTextureType::Offscreen;
+
+  // Pairs of attachments that aren't alive at the same time in a frame share
+  // their memory: material params are last read by lighting, sprites are
+  // drawn after it, and the horizontally blurred ssao is only read by the
+  // vertical blur before lighting is written.
+  // The render graph checks these pairs against the lifetimes it computes
+  // whenever it is compiled, its dump lists the other candidates.
+  std::vector<Ref<AttachmentTexture>> materialAndSprite =
+      CreateAliasedAttachmentTextures(
+          {{extent.width, extent.height, sampledType, 1,
+            VK_FORMAT_R8G8B8A8_UNORM, VK_SAMPLE_COUNT_1_BIT, true},
+           {extent.width, extent.height, AttachmentTextureType::Offscreen, 1,
+            m_SwapChainImageFormat, VK_SAMPLE_COUNT_1_BIT, true}});
+  std::vector<Ref<AttachmentTexture>> lightingAndSSAO =
+      CreateAliasedAttachmentTextures(
+          {{extent.width, extent.height, sampledType, 1,
+            m_SwapChainImageFormat, VK_SAMPLE_COUNT_1_BIT, true},
+           {.Width = std::max(extent.width / 2, 1u),
+            .Height = std::max(extent.height / 2, 1u),
+            .Type = AttachmentTextureType::Offscreen,
+            .ImageFormat = VK_FORMAT_R32_SFLOAT,
+            .Sampled = true,
+            .Storage = true}});
+
+  // Ssao is computed at half resolution and written by compute shaders, the
+  // blur ping pongs between these two and leaves the result in the color
+  // image. R32 float is the single channel format every device can store to.
   component.SSAOColorImage = CreateAttachmentTexture(
-      {extent.width / 2, extent.height / 2, AttachmentTextureType::Offscreen, 1,
-       VK_FORMAT_R8_UNORM, VK_SAMPLE_COUNT_1_BIT, true});
-  component.SSAOBlurColorImage = CreateAttachmentTexture(
-      {extent.width, extent.height, AttachmentTextureType::Offscreen, 1,
-       VK_FORMAT_R8_UNORM, VK_SAMPLE_COUNT_1_BIT, true});
-  component.SSAOGenFramebuffer = m_SSAOGenRenderPass->CreateFramebuffer(
-      0, {component.SSAOColorImage->m_ImageViews[0]},
-      {extent.width / 2, extent.height / 2});
-  component.SSAOBlurFramebuffer = m_SSAOBlurRenderPass->CreateFramebuffer(
-      0, {component.SSAOBlurColorImage->m_ImageViews[0]},
-      {extent.width, extent.height});
-
-  component.GeometryViewPosImage = CreateAttachmentTexture(
-      {extent.width, extent.height, AttachmentTextureType::Offscreen, 1,
-       VK_FORMAT_R32G32B32A32_SFLOAT, m_MsaaSamples, true});
-  component.GeometryWorldPosImage = CreateAttachmentTexture(
-      {extent.width, extent.height, AttachmentTextureType::Offscreen, 1,
-       VK_FORMAT_R32G32B32A32_SFLOAT, m_MsaaSamples, true});
+      {.Width = std::max(extent.width / 2, 1u),
+       .Height = std::max(extent.height / 2, 1u),
+       .Type = AttachmentTextureType::Offscreen,
+       .ImageFormat = VK_FORMAT_R32_SFLOAT,
+       .Sampled = true,
+       .Storage = true});
+  component.SSAOBlurColorImage = lightingAndSSAO[1];
+
+  // Slim g-buffer, positions are reconstructed from the linear depth and the
+  // normals are octahedral encoded.
   component.GeometryDepthImage = CreateAttachmentTexture(
       {extent.width, extent.height, AttachmentTextureType::Offscreen, 1,
-       VK_FORMAT_R32_SFLOAT, m_MsaaSamples, true});
+       VK_FORMAT_R32_SFLOAT, m_MsaaSamples, sampleMsaaImages});
   component.GeometryNormalImage = CreateAttachmentTexture(
       {extent.width, extent.height, AttachmentTextureType::Offscreen, 1,
-       VK_FORMAT_R8G8B8A8_UNORM, m_MsaaSamples, true});
+       VK_FORMAT_R16G16_SFLOAT, m_MsaaSamples, sampleMsaaImages});
   component.GeometryAlbedoImage = CreateAttachmentTexture(
       {extent.width, extent.height, AttachmentTextureType::Offscreen, 1,
-       VK_FORMAT_R8G8B8A8_UNORM, m_MsaaSamples, true});
-  component.GeometryMaterialImage = CreateAttachmentTexture(
-      {extent.width, extent.height, AttachmentTextureType::Offscreen, 1,
-       VK_FORMAT_R16G16B16A16_SFLOAT, m_MsaaSamples, true});
+       VK_FORMAT_R8G8B8A8_UNORM, m_MsaaSamples, sampleMsaaImages});
+  component.GeometryMaterialImage =
+      msaa ? CreateAttachmentTexture({extent.width, extent.height,
+                                      AttachmentTextureType::Offscreen, 1,
+                                      VK_FORMAT_R8G8B8A8_UNORM, m_MsaaSamples,
+                                      false})
+           : materialAndSprite[0];
+  // Depth is written to its own color attachment for sampling.
   component.GeometryDepthStencil = CreateAttachmentTexture(
       {extent.width, extent.height, AttachmentTextureType::DepthStencil, 1,
-       FindDepthFormat(), m_MsaaSamples, true});
-
-  component.ShadowDepthStencil = CreateAttachmentTexture(
-      {WIESEL_SHADOWMAP_DIM, WIESEL_SHADOWMAP_DIM,
-       AttachmentTextureType::DepthStencil, 1, FindDepthFormat(),
-       VK_SAMPLE_COUNT_1_BIT, true, WIESEL_SHADOW_CASCADE_COUNT});
-  component.ShadowDepthViewArray =
-      CreateImageView(component.ShadowDepthStencil, VK_IMAGE_VIEW_TYPE_2D_ARRAY,
-                      0, WIESEL_SHADOW_CASCADE_COUNT);
-  for (int i = 0; i < WIESEL_SHADOW_CASCADE_COUNT; ++i) {
-    component.ShadowDepthViews[i] =
-        CreateImageView(component.ShadowDepthStencil, VK_IMAGE_VIEW_TYPE_2D, i);
-    std::array<ImageView*, 1> textures = {
-        component.ShadowDepthViews[i].get(),
-    };
-    component.ShadowFramebuffers[i] = m_ShadowRenderPass->CreateFramebuffer(
-        0, textures, {WIESEL_SHADOWMAP_DIM, WIESEL_SHADOWMAP_DIM});
-  }
+       FindDepthFormat(), m_MsaaSamples, false});
 
-  if (m_MsaaSamples > VK_SAMPLE_COUNT_1_BIT) {
-    component.GeometryViewPosResolveImage = CreateAttachmentTexture(
-        {extent.width, extent.height, AttachmentTextureType::Resolve, 1,
-         VK_FORMAT_R32G32B32A32_SFLOAT, VK_SAMPLE_COUNT_1_BIT, true});
-    component.GeometryWorldPosResolveImage = CreateAttachmentTexture(
-        {extent.width, extent.height, AttachmentTextureType::Resolve, 1,
-         VK_FORMAT_R32G32B32A32_SFLOAT, VK_SAMPLE_COUNT_1_BIT, true});
+  if (msaa) {
     component.GeometryDepthResolveImage = CreateAttachmentTexture(
         {extent.width, extent.height, AttachmentTextureType::Resolve, 1,
          VK_FORMAT_R32_SFLOAT, VK_SAMPLE_COUNT_1_BIT, true});
     component.GeometryNormalResolveImage = CreateAttachmentTexture(
         {extent.width, extent.height, AttachmentTextureType::Resolve, 1,
-         VK_FORMAT_R8G8B8A8_UNORM, VK_SAMPLE_COUNT_1_BIT, true});
+         VK_FORMAT_R16G16_SFLOAT, VK_SAMPLE_COUNT_1_BIT, true});
     component.GeometryAlbedoResolveImage = CreateAttachmentTexture(
         {extent.width, extent.height, AttachmentTextureType::Resolve, 1,
          VK_FORMAT_R8G8B8A8_UNORM, VK_SAMPLE_COUNT_1_BIT, true});
-    component.GeometryMaterialResolveImage = CreateAttachmentTexture(
-        {extent.width, extent.height, AttachmentTextureType::Resolve, 1,
-         VK_FORMAT_R16G16B16A16_SFLOAT, VK_SAMPLE_COUNT_1_BIT, true});
-    std::array<AttachmentTexture*, 13> textures = {
-        component.GeometryViewPosImage.get(),
-        component.GeometryWorldPosImage.get(),
+    component.GeometryMaterialResolveImage = materialAndSprite[0];
+    std::array<AttachmentTexture*, 9> textures = {
         component.GeometryDepthImage.get(),
         component.GeometryNormalImage.get(),
         component.GeometryAlbedoImage.get(),
         component.GeometryMaterialImage.get(),
         component.GeometryDepthStencil.get(),
-        component.GeometryViewPosResolveImage.get(),
-        component.GeometryWorldPosResolveImage.get(),
         component.GeometryDepthResolveImage.get(),
         component.GeometryNormalResolveImage.get(),
         component.GeometryAlbedoResolveImage.get(),
@@ -283,32 +376,29 @@ void Renderer::SetupCameraComponent(CameraComponent& component) {
     component.GeometryFramebuffer = m_GeometryRenderPass->CreateFramebuffer(
         0, textures, component.ViewportSize);
   } else {
-    component.GeometryViewPosResolveImage = component.GeometryViewPosImage;
-    component.GeometryWorldPosResolveImage = component.GeometryWorldPosImage;
     component.GeometryDepthResolveImage = component.GeometryDepthImage;
     component.GeometryNormalResolveImage = component.GeometryNormalImage;
     component.GeometryAlbedoResolveImage = component.GeometryAlbedoImage;
     component.GeometryMaterialResolveImage = component.GeometryMaterialImage;
-    std::array<AttachmentTexture*, 7> textures = {
-        component.GeometryViewPosImage.get(),
-        component.GeometryWorldPosImage.get(),
+    std::array<AttachmentTexture*, 5> textures = {
         component.GeometryDepthImage.get(),
         component.GeometryNormalImage.get(),
         component.GeometryAlbedoImage.get(),
-        component.GeometryDepthStencil.get(),
         component.GeometryMaterialImage.get(),
+        component.GeometryDepthStencil.get(),
     };
     component.GeometryFramebuffer = m_GeometryRenderPass->CreateFramebuffer(
         0, textures, component.ViewportSize);
   }
 
-  component.LightingColorImage = CreateAttachmentTexture(
-      {extent.width, extent.height, AttachmentTextureType::Offscreen, 1,
-       m_SwapChainImageFormat, m_MsaaSamples});
-  if (m_MsaaSamples > VK_SAMPLE_COUNT_1_BIT) {
-    component.LightingColorResolveImage = CreateAttachmentTexture(
-        {extent.width, extent.height, AttachmentTextureType::Resolve, 1,
-         m_SwapChainImageFormat, VK_SAMPLE_COUNT_1_BIT, true});
+  component.LightingColorImage =
+      msaa ? CreateAttachmentTexture({extent.width, extent.height,
+                                      AttachmentTextureType::Offscreen, 1,
+                                      m_SwapChainImageFormat, m_MsaaSamples,
+                                      false})
+           : lightingAndSSAO[0];
+  if (msaa) {
+    component.LightingColorResolveImage = lightingAndSSAO[0];
 
     std::array<AttachmentTexture*, 2> textures{
         component.LightingColorImage.get(),
@@ -323,9 +413,7 @@ void Renderer::SetupCameraComponent(CameraComponent& component) {
         0, textures, {extent.width, extent.height});
   }
 
-  component.SpriteColorImage = CreateAttachmentTexture(
-      {extent.width, extent.height, AttachmentTextureType::Offscreen, 1,
-       m_SwapChainImageFormat, VK_SAMPLE_COUNT_1_BIT, true});
+  component.SpriteColorImage = materialAndSprite[1];
 
   std::array<AttachmentTexture*, 1> textures{component.SpriteColorImage.get()};
   component.SpriteFramebuffer = m_SpriteRenderPass->CreateFramebuffer(
@@ -333,8 +421,8 @@ void Renderer::SetupCameraComponent(CameraComponent& component) {
 
   component.CompositeColorImage = CreateAttachmentTexture(
       {extent.width, extent.height, AttachmentTextureType::Offscreen, 1,
-       m_SwapChainImageFormat, m_MsaaSamples});
-  if (m_MsaaSamples > VK_SAMPLE_COUNT_1_BIT) {
+       m_SwapChainImageFormat, m_MsaaSamples, sampleMsaaImages});
+  if (msaa) {
     component.CompositeColorResolveImage = CreateAttachmentTexture(
         {extent.width, extent.height, AttachmentTextureType::Resolve, 1,
          m_SwapChainImageFormat, VK_SAMPLE_COUNT_1_BIT, true});
@@ -345,35 +433,56 @@ void Renderer::SetupCameraComponent(CameraComponent& component) {
     component.CompositeFramebuffer = m_LightingRenderPass->CreateFramebuffer(
         0, textures, {extent.width, extent.height});
   } else {
-    component.CompositeColorResolveImage = component.LightingColorImage;
+    component.CompositeColorResolveImage = component.CompositeColorImage;
     std::array<AttachmentTexture*, 1> textures{
         component.CompositeColorImage.get()};
     component.CompositeFramebuffer = m_LightingRenderPass->CreateFramebuffer(
         0, textures, {extent.width, extent.height});
   }
 
-  component.GlobalDescriptor = CreateGlobalDescriptors(component);
+  // The passes leave their sampled outputs in shader read only, start them in
+  // the same layout so sampling one that wasn't written yet is valid.
+  BarrierBatch barriers;
+  std::vector<AttachmentTexture*> sampledOutputs;
+  for (const auto& texture :
+       {component.GeometryDepthResolveImage,
+        component.GeometryNormalResolveImage,
+        component.GeometryAlbedoResolveImage,
+        component.GeometryMaterialResolveImage, component.SSAOColorImage,
+        component.SSAOBlurColorImage, component.LightingColorResolveImage,
+        component.SpriteColorImage, component.CompositeColorResolveImage}) {
+    // Resolve images are the msaa images themselves when msaa is disabled.
+    if (std::find(sampledOutputs.begin(), sampledOutputs.end(),
+                  texture.get()) != sampledOutputs.end()) {
+      continue;
+    }
+    sampledOutputs.push_back(texture.get());
+    barriers.AddImageBarrier(*texture, VK_IMAGE_LAYOUT_UNDEFINED,
+                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, 0,
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             VK_ACCESS_SHADER_READ_BIT);
+  }
+  VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+  barriers.Flush(commandBuffer);
+  EndSingleTimeCommands(commandBuffer);
+
+  // Also creates the global descriptor, it samples the shadow maps.
+  SetupShadowResources(component);
   component.ShadowDescriptor = CreateShadowGlobalDescriptors(component);
   component.GeometryOutputDescriptor = CreateReference<DescriptorSet>();
   component.GeometryOutputDescriptor->SetLayout(
       m_GeometryOutputDescriptorLayout);
   component.GeometryOutputDescriptor->AddCombinedImageSampler(
-      0, component.GeometryViewPosResolveImage->m_ImageViews[0],
-      m_DefaultNearestSampler);
-  component.GeometryOutputDescriptor->AddCombinedImageSampler(
-      1, component.GeometryWorldPosResolveImage->m_ImageViews[0],
+      0, component.GeometryDepthResolveImage->m_ImageViews[0],
       m_DefaultNearestSampler);
   component.GeometryOutputDescriptor->AddCombinedImageSampler(
-      2, component.GeometryDepthResolveImage->m_ImageViews[0],
-      m_DefaultNearestSampler);
-  component.GeometryOutputDescriptor->AddCombinedImageSampler(
-      3, component.GeometryNormalResolveImage->m_ImageViews[0],
+      1, component.GeometryNormalResolveImage->m_ImageViews[0],
       m_DefaultNearestSampler);
   component.GeometryOutputDescriptor->AddCombinedImageSampler(
-      4, component.GeometryAlbedoResolveImage->m_ImageViews[0],
+      2, component.GeometryAlbedoResolveImage->m_ImageViews[0],
       m_DefaultNearestSampler);
   component.GeometryOutputDescriptor->AddCombinedImageSampler(
-      5, component.GeometryMaterialResolveImage->m_ImageViews[0],
+      3, component.GeometryMaterialResolveImage->m_ImageViews[0],
       m_DefaultNearestSampler);
   component.GeometryOutputDescriptor->Bake();
 
@@ -383,12 +492,6 @@ void Renderer::SetupCameraComponent(CameraComponent& component) {
       0, component.SSAOColorImage->m_ImageViews[0], m_DefaultNearestSampler);
   component.SSAOOutputDescriptor->Bake();
 
-  component.SSAOBlurOutputDescriptor = CreateReference<DescriptorSet>();
-  component.SSAOBlurOutputDescriptor->SetLayout(m_SSAOOutputDescriptorLayout);
-  component.SSAOBlurOutputDescriptor->AddCombinedImageSampler(
-      0, component.SSAOBlurColorImage->m_ImageViews[0], m_DefaultLinearSampler);
-  component.SSAOBlurOutputDescriptor->Bake();
-
   component.LightingOutputDescriptor = CreateReference<DescriptorSet>();
   component.LightingOutputDescriptor->SetLayout(m_PresentDescriptorLayout);
   component.LightingOutputDescriptor->AddCombinedImageSampler(
@@ -413,23 +516,119 @@ void Renderer::SetupCameraComponent(CameraComponent& component) {
   component.SSAOGenDescriptor = CreateReference<DescriptorSet>();
   component.SSAOGenDescriptor->SetLayout(m_SSAOGenDescriptorLayout);
   component.SSAOGenDescriptor->AddCombinedImageSampler(
-      0, component.GeometryViewPosResolveImage->m_ImageViews[0],
+      0, component.GeometryDepthResolveImage->m_ImageViews[0],
       m_DefaultNearestSampler);
   component.SSAOGenDescriptor->AddCombinedImageSampler(
       1, component.GeometryNormalResolveImage->m_ImageViews[0],
       m_DefaultNearestSampler);
   component.SSAOGenDescriptor->AddCombinedImageSampler(
-      2, component.GeometryDepthResolveImage->m_ImageViews[0],
-      m_DefaultNearestSampler);
-  component.SSAOGenDescriptor->AddCombinedImageSampler(
-      3, m_SSAONoise->m_ImageViews[0], m_DefaultLinearSampler);
-  component.SSAOGenDescriptor->AddUniformBuffer(4, m_SSAOKernelUniformBuffer);
+      2, m_SSAONoise->m_ImageViews[0], m_DefaultLinearSampler);
+  component.SSAOGenDescriptor->AddUniformBuffer(3, m_SSAOKernelUniformBuffer);
+  component.SSAOGenDescriptor->AddStorageImage(
+      4, component.SSAOColorImage->m_ImageViews[0]);
   component.SSAOGenDescriptor->Bake();
 
+  component.SSAOBlurHorizontalDescriptor = CreateReference<DescriptorSet>();
+  component.SSAOBlurHorizontalDescriptor->SetLayout(m_SSAOBlurDescriptorLayout);
+  component.SSAOBlurHorizontalDescriptor->AddCombinedImageSampler(
+      0, component.SSAOColorImage->m_ImageViews[0], m_DefaultNearestSampler);
+  component.SSAOBlurHorizontalDescriptor->AddCombinedImageSampler(
+      1, component.GeometryDepthResolveImage->m_ImageViews[0],
+      m_DefaultNearestSampler);
+  component.SSAOBlurHorizontalDescriptor->AddStorageImage(
+      2, component.SSAOBlurColorImage->m_ImageViews[0]);
+  component.SSAOBlurHorizontalDescriptor->Bake();
+
+  component.SSAOBlurVerticalDescriptor = CreateReference<DescriptorSet>();
+  component.SSAOBlurVerticalDescriptor->SetLayout(m_SSAOBlurDescriptorLayout);
+  component.SSAOBlurVerticalDescriptor->AddCombinedImageSampler(
+      0, component.SSAOBlurColorImage->m_ImageViews[0],
+      m_DefaultNearestSampler);
+  component.SSAOBlurVerticalDescriptor->AddCombinedImageSampler(
+      1, component.GeometryDepthResolveImage->m_ImageViews[0],
+      m_DefaultNearestSampler);
+  component.SSAOBlurVerticalDescriptor->AddStorageImage(
+      2, component.SSAOColorImage->m_ImageViews[0]);
+  component.SSAOBlurVerticalDescriptor->Bake();
+
+  AttachmentMemoryReport report = GetAttachmentMemoryReport(component);
+  LOG_INFO(
+      "Camera attachments: {} using {} KiB, {} KiB lazily allocated, {} KiB "
+      "saved by aliasing",
+      report.AttachmentCount, report.Allocated / 1024,
+      report.LazilyAllocated / 1024, report.AliasingSaved / 1024);
+
   component.IsViewChanged = true;
   component.IsPosChanged = true;
 }
 
+void Renderer::SetupShadowResources(CameraComponent& component) {
+  uint32_t resolution = m_ShadowSettings.Resolution;
+  uint32_t cascadeCount = m_ShadowSettings.CascadeCount;
+  VkFormat format = GetShadowDepthFormat();
+
+  // The dynamic shadow map and the cached one of the static casters.
+  BarrierBatch barriers;
+  for (bool isStatic : {false, true}) {
+    Ref<AttachmentTexture>& texture = isStatic
+                                          ? component.ShadowStaticDepthStencil
+                                          : component.ShadowDepthStencil;
+    Ref<ImageView>& viewArray = isStatic ? component.ShadowStaticDepthViewArray
+                                         : component.ShadowDepthViewArray;
+    auto& views = isStatic ? component.ShadowStaticDepthViews
+                           : component.ShadowDepthViews;
+    auto& framebuffers = isStatic ? component.ShadowStaticFramebuffers
+                                  : component.ShadowFramebuffers;
+    texture = CreateAttachmentTexture(
+        {resolution, resolution, AttachmentTextureType::DepthStencil, 1, format,
+         VK_SAMPLE_COUNT_1_BIT, true, cascadeCount});
+    viewArray = CreateImageView(texture, VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0,
+                                cascadeCount);
+    for (uint32_t i = 0; i < WIESEL_SHADOW_MAX_CASCADE_COUNT; ++i) {
+      if (i >= cascadeCount) {
+        views[i] = nullptr;
+        framebuffers[i] = nullptr;
+        continue;
+      }
+      views[i] = CreateImageView(texture, VK_IMAGE_VIEW_TYPE_2D, i);
+      std::array<ImageView*, 1> textures = {views[i].get()};
+      framebuffers[i] = m_ShadowRenderPass->CreateFramebuffer(
+          0, textures, {resolution, resolution});
+    }
+    // Lighting samples the shadow maps even when no shadow pass ran
+    barriers.AddImageBarrier(*texture, VK_IMAGE_LAYOUT_UNDEFINED,
+                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, 0,
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             VK_ACCESS_SHADER_READ_BIT, cascadeCount);
+  }
+  VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+  barriers.Flush(commandBuffer);
+  EndSingleTimeCommands(commandBuffer);
+
+  component.ShadowCascadeCount = cascadeCount;
+  component.ShadowMapResolution = resolution;
+  component.ShadowResourcesVersion = m_ShadowResourcesVersion;
+  // Cascades are refitted to the new resolution, the cached cascades start
+  // out undefined.
+  component.ForceLightReset = true;
+  component.InvalidateStaticShadows();
+
+  component.GlobalDescriptor = CreateGlobalDescriptors(component);
+}
+
+bool Renderer::IsShadowResourcesOutdated(const CameraComponent& component) {
+  return component.ShadowResourcesVersion != m_ShadowResourcesVersion;
+}
+
+void Renderer::UpdatePointShadows(
+    const std::vector<PointShadowRequest>& requests) {
+  m_ShadowAtlas.Update(requests, m_ShadowSettings.AtlasUpdateBudget);
+  for (const auto& request : requests) {
+    m_PointLightsStorageData.PointLights[request.LightIndex].ShadowIndex =
+        m_ShadowAtlas.GetShadowIndex(request.LightId);
+  }
+}
+
 Ref<Texture> Renderer::CreateBlankTexture() {
   Ref<Texture> texture = CreateReference<Texture>(TextureTypeDiffuse, "");
 
@@ -751,6 +950,139 @@ Ref<Texture> Renderer::CreateCubemapTexture(
 
 Ref<AttachmentTexture> Renderer::CreateAttachmentTexture(
     const AttachmentTextureProps& props) {
+  Ref<AttachmentTexture> texture = CreateAttachmentImages(props);
+  // Attachments that are never sampled or copied only live inside a render
+  // pass, they can use memory that is only backed when the gpu needs it.
+  bool transient = !props.Sampled && !props.TransferDest && !props.Storage;
+  texture->m_DeviceMemories.resize(props.ImageCount);
+  for (uint32_t i = 0; i < props.ImageCount; i++) {
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(m_LogicalDevice, texture->m_Images[i],
+                                 &memRequirements);
+
+    std::optional<uint32_t> memoryType;
+    if (transient) {
+      memoryType = TryFindMemoryType(
+          memRequirements.memoryTypeBits,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+              VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+      texture->m_IsLazilyAllocated = memoryType.has_value();
+    }
+    if (!memoryType) {
+      memoryType = FindMemoryType(memRequirements.memoryTypeBits,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = *memoryType;
+    WIESEL_CHECK_VKRESULT(vkAllocateMemory(m_LogicalDevice, &allocInfo,
+                                           nullptr,
+                                           &texture->m_DeviceMemories[i]));
+    vkBindImageMemory(m_LogicalDevice, texture->m_Images[i],
+                      texture->m_DeviceMemories[i], 0);
+    texture->m_MemorySize += memRequirements.size;
+  }
+
+  CreateAttachmentViews(*texture, props);
+  texture->m_IsAllocated = true;
+  return texture;
+}
+
+std::vector<Ref<AttachmentTexture>> Renderer::CreateAliasedAttachmentTextures(
+    const std::vector<AttachmentTextureProps>& props) {
+  std::vector<Ref<AttachmentTexture>> textures;
+  Ref<AliasedMemory> memory = CreateReference<AliasedMemory>();
+  memory->m_Size = 0;
+  uint32_t memoryTypeBits = ~0u;
+  for (const auto& item : props) {
+    if (item.ImageCount != 1) {
+      throw std::runtime_error("Aliased attachments can only have one image!");
+    }
+    Ref<AttachmentTexture> texture = CreateAttachmentImages(item);
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(m_LogicalDevice, texture->m_Images[0],
+                                 &memRequirements);
+    // Every image is bound at offset zero, that satisfies any alignment.
+    memory->m_Size = std::max(memory->m_Size, memRequirements.size);
+    memoryTypeBits &= memRequirements.memoryTypeBits;
+    texture->m_MemorySize = memRequirements.size;
+    texture->m_AliasedMemory = memory;
+    textures.push_back(texture);
+  }
+
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = memory->m_Size;
+  allocInfo.memoryTypeIndex =
+      FindMemoryType(memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  WIESEL_CHECK_VKRESULT(vkAllocateMemory(m_LogicalDevice, &allocInfo, nullptr,
+                                         &memory->m_Handle));
+
+  for (uint32_t i = 0; i < textures.size(); i++) {
+    vkBindImageMemory(m_LogicalDevice, textures[i]->m_Images[0],
+                      memory->m_Handle, 0);
+    CreateAttachmentViews(*textures[i], props[i]);
+    textures[i]->m_IsAllocated = true;
+  }
+  return textures;
+}
+
+AttachmentMemoryReport Renderer::GetAttachmentMemoryReport(
+    const CameraComponent& camera) {
+  AttachmentMemoryReport report{};
+  std::vector<AttachmentTexture*> textures;
+  std::vector<AliasedMemory*> memories;
+  VkDeviceSize aliasedRequested = 0;
+  VkDeviceSize aliasedAllocated = 0;
+  for (const auto& texture :
+       {camera.GeometryNormalImage, camera.GeometryNormalResolveImage,
+        camera.GeometryDepthImage, camera.GeometryDepthResolveImage,
+        camera.GeometryAlbedoImage, camera.GeometryAlbedoResolveImage,
+        camera.GeometryMaterialImage, camera.GeometryMaterialResolveImage,
+        camera.GeometryDepthStencil, camera.SSAOColorImage,
+        camera.SSAOBlurColorImage, camera.LightingColorImage,
+        camera.LightingColorResolveImage, camera.SpriteColorImage,
+        camera.CompositeColorImage, camera.CompositeColorResolveImage,
+        camera.ShadowDepthStencil, camera.ShadowStaticDepthStencil}) {
+    // Resolve images are the msaa images themselves when msaa is disabled.
+    if (!texture || std::find(textures.begin(), textures.end(),
+                              texture.get()) != textures.end()) {
+      continue;
+    }
+    textures.push_back(texture.get());
+    report.AttachmentCount++;
+    report.Requested += texture->m_MemorySize;
+
+    if (texture->m_AliasedMemory) {
+      aliasedRequested += texture->m_MemorySize;
+      AliasedMemory* memory = texture->m_AliasedMemory.get();
+      if (std::find(memories.begin(), memories.end(), memory) ==
+          memories.end()) {
+        memories.push_back(memory);
+        aliasedAllocated += memory->m_Size;
+      }
+      continue;
+    }
+
+    report.Allocated += texture->m_MemorySize;
+    if (texture->m_IsLazilyAllocated) {
+      report.LazilyAllocated += texture->m_MemorySize;
+      for (VkDeviceMemory memory : texture->m_DeviceMemories) {
+        VkDeviceSize committed = 0;
+        vkGetDeviceMemoryCommitment(m_LogicalDevice, memory, &committed);
+        report.LazilyCommitted += committed;
+      }
+    }
+  }
+  report.Allocated += aliasedAllocated;
+  report.AliasingSaved = aliasedRequested - aliasedAllocated;
+  return report;
+}
+
+Ref<AttachmentTexture> Renderer::CreateAttachmentImages(
+    const AttachmentTextureProps& props) {
   if (props.Type == AttachmentTextureType::SwapChain) {
     throw new std::runtime_error(
         "AttachmentTextureType::SwapChain cannot be created!");
@@ -761,6 +1093,7 @@ Ref<AttachmentTexture> Renderer::CreateAttachmentTexture(
   texture->m_Width = props.Width;
   texture->m_Height = props.Height;
   texture->m_MsaaSamples = props.MsaaSamples;
+  texture->m_IsAllocated = false;
   int flags;
   if (props.Type == AttachmentTextureType::DepthStencil) {
     flags = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
@@ -776,6 +1109,9 @@ Ref<AttachmentTexture> Renderer::CreateAttachmentTexture(
   if (props.TransferDest) {
     flags |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
   }
+  if (props.Storage) {
+    flags |= VK_IMAGE_USAGE_STORAGE_BIT;
+  }
 
   int aspectFlags;
   if (props.Type == AttachmentTextureType::DepthStencil) {
@@ -786,27 +1122,31 @@ Ref<AttachmentTexture> Renderer::CreateAttachmentTexture(
   texture->m_AspectFlags = aspectFlags;
   texture->m_MipLevels = 1;
   texture->m_Images.resize(props.ImageCount);
-  texture->m_DeviceMemories.resize(props.ImageCount);
-  texture->m_ImageViews.resize(props.ImageCount);
 
   for (uint32_t i = 0; i < props.ImageCount; i++) {
-    CreateImage(props.Width, props.Height, 1, props.MsaaSamples,
-                props.ImageFormat, VK_IMAGE_TILING_OPTIMAL, flags,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture->m_Images[i],
-                texture->m_DeviceMemories[i], 0, props.LayerCount);
+    CreateImageHandle(props.Width, props.Height, 1, props.MsaaSamples,
+                      props.ImageFormat, VK_IMAGE_TILING_OPTIMAL, flags,
+                      texture->m_Images[i], 0, props.LayerCount);
+  }
+  return texture;
+}
 
+void Renderer::CreateAttachmentViews(AttachmentTexture& texture,
+                                     const AttachmentTextureProps& props) {
+  texture.m_ImageViews.resize(props.ImageCount);
+  for (uint32_t i = 0; i < props.ImageCount; i++) {
     if (props.LayerCount != 1)
-      texture->m_ImageViews[i] =
-          CreateImageView(texture->m_Images[i], props.ImageFormat, aspectFlags,
-                          1, VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0, props.LayerCount);
+      texture.m_ImageViews[i] = CreateImageView(
+          texture.m_Images[i], props.ImageFormat, texture.m_AspectFlags, 1,
+          VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0, props.LayerCount);
     else {
-      texture->m_ImageViews[i] =
-          CreateImageView(texture->m_Images[i], props.ImageFormat, aspectFlags,
-                          1, VK_IMAGE_VIEW_TYPE_2D, 0, 1);
+      texture.m_ImageViews[i] = CreateImageView(
+          texture.m_Images[i], props.ImageFormat, texture.m_AspectFlags, 1,
+          VK_IMAGE_VIEW_TYPE_2D, 0, 1);
     }
 
     if (props.Type == AttachmentTextureType::DepthStencil) {
-      TransitionImageLayout(texture->m_Images[i], props.ImageFormat,
+      TransitionImageLayout(texture.m_Images[i], props.ImageFormat,
                             VK_IMAGE_LAYOUT_UNDEFINED,
                             VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1,
                             0, props.LayerCount);
@@ -814,17 +1154,14 @@ Ref<AttachmentTexture> Renderer::CreateAttachmentTexture(
                props.Type == AttachmentTextureType::Resolve ||
                props.Type == AttachmentTextureType::Offscreen) {
       TransitionImageLayout(
-          texture->m_Images[i], props.ImageFormat, VK_IMAGE_LAYOUT_UNDEFINED,
+          texture.m_Images[i], props.ImageFormat, VK_IMAGE_LAYOUT_UNDEFINED,
           VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1, 0, props.LayerCount);
     } else if (props.Type == AttachmentTextureType::SwapChain) {
       TransitionImageLayout(
-          texture->m_Images[i], props.ImageFormat, VK_IMAGE_LAYOUT_UNDEFINED,
+          texture.m_Images[i], props.ImageFormat, VK_IMAGE_LAYOUT_UNDEFINED,
           VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 1, 0, props.LayerCount);
     }
   }
-
-  texture->m_IsAllocated = true;
-  return texture;
 }
 
 void Renderer::SetAttachmentTextureBuffer(Ref<AttachmentTexture> texture,
@@ -850,9 +1187,10 @@ void Renderer::SetAttachmentTextureBuffer(Ref<AttachmentTexture> texture,
                     static_cast<uint32_t>(texture->m_Width),
                     static_cast<uint32_t>(texture->m_Height));
 
+  // Only used for textures that are sampled, like the ssao noise.
   TransitionImageLayout(texture->m_Images[0], texture->m_Format,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
+                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
 
   vkDestroyBuffer(m_LogicalDevice, stagingBuffer, nullptr);
   vkFreeMemory(m_LogicalDevice, stagingBufferMemory, nullptr);
@@ -917,6 +1255,8 @@ void Renderer::DestroyAttachmentTexture(AttachmentTexture& texture) {
     for (VkDeviceMemory& memory : texture.m_DeviceMemories) {
       vkFreeMemory(m_LogicalDevice, memory, nullptr);
     }
+    // Freed by the last attachment that uses it.
+    texture.m_AliasedMemory = nullptr;
   }
   texture.m_IsAllocated = false;
 }
@@ -1235,7 +1575,8 @@ Ref<DescriptorSet> Renderer::CreateGlobalDescriptors(CameraComponent& camera) {
 
   VkDescriptorPoolSize poolSizes[] = {
       {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3},
-      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1}};
+      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3},
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3}};
 
   VkDescriptorPoolCreateInfo poolInfo{};
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -1257,11 +1598,11 @@ Ref<DescriptorSet> Renderer::CreateGlobalDescriptors(CameraComponent& camera) {
                                                  &object->m_DescriptorSet));
 
   std::vector<VkWriteDescriptorSet> writes;
-  writes.reserve(4);
+  writes.reserve(9);
   std::vector<VkDescriptorBufferInfo> bufferInfos;
-  bufferInfos.reserve(3);
+  bufferInfos.reserve(6);
   std::vector<VkDescriptorImageInfo> imageInfos;
-  imageInfos.reserve(1);
+  imageInfos.reserve(3);
 
   {
     VkDescriptorBufferInfo bufferInfo;
@@ -1323,14 +1664,19 @@ Ref<DescriptorSet> Renderer::CreateGlobalDescriptors(CameraComponent& camera) {
     writes.emplace_back(set);
   }
 
-  {
+  // Dynamic and cached static shadow cascades, and the point light shadow
+  // atlas
+  for (auto [binding, view] :
+       {std::pair{3u, camera.ShadowDepthViewArray},
+        std::pair{6u, camera.ShadowStaticDepthViewArray},
+        std::pair{8u, m_ShadowAtlasTexture->m_ImageViews[0]}}) {
     VkDescriptorImageInfo imageInfo;
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    if (camera.ShadowDepthViewArray == nullptr) {
+    if (view == nullptr) {
       imageInfo.imageView = m_BlankTexture->m_ImageView->m_Handle;
       imageInfo.sampler = m_BlankTexture->m_Sampler;
     } else {
-      imageInfo.imageView = camera.ShadowDepthViewArray->m_Handle;
+      imageInfo.imageView = view->m_Handle;
       imageInfo.sampler = m_DefaultLinearSampler->m_Sampler;
     }
     imageInfos.emplace_back(imageInfo);
@@ -1338,7 +1684,7 @@ Ref<DescriptorSet> Renderer::CreateGlobalDescriptors(CameraComponent& camera) {
     VkWriteDescriptorSet set{};
     set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     set.dstSet = object->m_DescriptorSet;
-    set.dstBinding = 3;
+    set.dstBinding = binding;
     set.dstArrayElement = 0;
     set.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     set.descriptorCount = 1;
@@ -1347,6 +1693,28 @@ Ref<DescriptorSet> Renderer::CreateGlobalDescriptors(CameraComponent& camera) {
     writes.emplace_back(set);
   }
 
+  for (auto [binding, buffer] :
+       {std::pair{4u, m_PointLightsStorageBuffer},
+        std::pair{5u, m_LightClustersStorageBuffer},
+        std::pair{7u, m_PointShadowsStorageBuffer}}) {
+    VkDescriptorBufferInfo bufferInfo;
+    bufferInfo.buffer = buffer->m_Buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = buffer->m_Size;
+    bufferInfos.emplace_back(bufferInfo);
+
+    VkWriteDescriptorSet set{};
+    set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    set.dstSet = object->m_DescriptorSet;
+    set.dstBinding = binding;
+    set.dstArrayElement = 0;
+    set.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    set.descriptorCount = 1;
+    set.pBufferInfo = &bufferInfos.back();
+    set.pNext = nullptr;
+    writes.emplace_back(set);
+  }
+
   vkUpdateDescriptorSets(m_LogicalDevice, static_cast<uint32_t>(writes.size()),
                          writes.data(), 0, nullptr);
 
@@ -1586,6 +1954,86 @@ bool* Renderer::IsSSAOEnabledPtr() {
   return &m_EnableSSAO;
 }
 
+void Renderer::SetSSAOQuality(SSAOQuality quality) {
+  if (m_SSAOQuality == quality) {
+    return;
+  }
+  // The kernel buffer isn't per frame, frames in flight may still read it.
+  vkDeviceWaitIdle(m_LogicalDevice);
+  m_SSAOQuality = quality;
+  GenerateSSAOKernel();
+}
+
+SSAOQuality Renderer::GetSSAOQuality() {
+  return m_SSAOQuality;
+}
+
+void Renderer::SetShadowSettings(const ShadowSettings& settings) {
+  if (settings.CascadeCount < 1 ||
+      settings.CascadeCount > WIESEL_SHADOW_MAX_CASCADE_COUNT) {
+    throw std::runtime_error("shadow cascade count is out of range!");
+  }
+  // Tiles are packed in power of two steps of 1/64th of the atlas.
+  if (settings.AtlasResolution < 1024 ||
+      (settings.AtlasResolution & (settings.AtlasResolution - 1)) != 0) {
+    throw std::runtime_error("shadow atlas resolution is not supported!");
+  }
+  m_NextShadowSettings = settings;
+  // Doesn't need anything to be rebuilt.
+  m_ShadowSettings.AtlasUpdateBudget = settings.AtlasUpdateBudget;
+  m_RecreateShadowResources = m_NextShadowSettings != m_ShadowSettings;
+}
+
+const ShadowSettings& Renderer::GetShadowSettings() {
+  return m_NextShadowSettings;
+}
+
+VkFormat Renderer::GetShadowDepthFormat() {
+  switch (m_ShadowSettings.DepthFormat) {
+    case ShadowDepthFormat::D16:
+      // Always supported as a sampled depth attachment
+      return VK_FORMAT_D16_UNORM;
+    case ShadowDepthFormat::D32: {
+      VkFormatProperties props;
+      vkGetPhysicalDeviceFormatProperties(m_PhysicalDevice,
+                                          VK_FORMAT_D32_SFLOAT, &props);
+      VkFormatFeatureFlags features =
+          VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT |
+          VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+      if ((props.optimalTilingFeatures & features) == features) {
+        return VK_FORMAT_D32_SFLOAT;
+      }
+      LOG_WARN("D32 shadow maps are not supported, falling back to D16!");
+      return VK_FORMAT_D16_UNORM;
+    }
+  }
+  return VK_FORMAT_D16_UNORM;
+}
+
+void Renderer::SetLightVolumesEnabled(bool value) {
+  m_EnableLightVolumes = value;
+}
+
+bool Renderer::IsLightVolumesEnabled() {
+  return m_EnableLightVolumes;
+}
+
+bool* Renderer::IsLightVolumesEnabledPtr() {
+  return &m_EnableLightVolumes;
+}
+
+void Renderer::SetParallelRecordingEnabled(bool value) {
+  m_EnableParallelRecording = value;
+}
+
+bool Renderer::IsParallelRecordingEnabled() {
+  return m_EnableParallelRecording;
+}
+
+bool* Renderer::IsParallelRecordingEnabledPtr() {
+  return &m_EnableParallelRecording;
+}
+
 void Renderer::SetRecreatePipeline(bool value) {
   m_RecreatePipeline = value;
 }
@@ -1594,6 +2042,18 @@ bool Renderer::IsRecreatePipeline() {
   return m_RecreatePipeline;
 }
 
+void Renderer::SetShaderHotReloadEnabled(bool value) {
+  m_EnableShaderHotReload = value;
+}
+
+bool Renderer::IsShaderHotReloadEnabled() {
+  return m_EnableShaderHotReload;
+}
+
+bool* Renderer::IsShaderHotReloadEnabledPtr() {
+  return &m_EnableShaderHotReload;
+}
+
 float Renderer::GetAspectRatio() const {
   return m_AspectRatio;
 }
@@ -1607,10 +2067,18 @@ void Renderer::Cleanup() {
     return;
   }
 
+  if (m_ShaderReload.Thread.joinable()) {
+    m_ShaderReload.Thread.join();
+  }
+  m_ShaderReload.Entries.clear();
+  m_ShaderWatcher = nullptr;
+
   vkDeviceWaitIdle(m_LogicalDevice);
   LOG_DEBUG("Destroying Renderer");
 
   m_Camera = nullptr;
+  m_ShadowAtlasFramebuffer = nullptr;
+  m_ShadowAtlasTexture = nullptr;
   m_QuadIndexBuffer = nullptr;
   m_QuadVertexBuffer = nullptr;
 
@@ -1630,9 +2098,13 @@ void Renderer::Cleanup() {
   vkDestroyFence(m_LogicalDevice, m_Fence, nullptr);
 
   LOG_DEBUG("Destroying command pool");
+  m_SecondaryCommandBuffers.clear();
+  m_RecordingCommandPools.clear();
   m_CommandBuffer = nullptr;
   m_CommandPool = nullptr;
 
+  SavePipelineCache();
+
   LOG_DEBUG("Destroying device");
   vkDestroyDevice(m_LogicalDevice, nullptr);
 
@@ -1763,9 +2235,15 @@ void Renderer::CreateLogicalDevice() {
       static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
   createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount =
-      static_cast<uint32_t>(m_DeviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = m_DeviceExtensions.data();
+  // Optional, only used to report pipeline cache hits.
+  std::vector<const char*> extensions = m_DeviceExtensions;
+  m_PipelineCacheStats.HasFeedback = IsDeviceExtensionSupported(
+      m_PhysicalDevice, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+  if (m_PipelineCacheStats.HasFeedback) {
+    extensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+  }
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+  createInfo.ppEnabledExtensionNames = extensions.data();
   createInfo.enabledLayerCount = 0;
 
   if (vkCreateDevice(m_PhysicalDevice, &createInfo, nullptr,
@@ -1779,6 +2257,93 @@ void Renderer::CreateLogicalDevice() {
                    &m_GraphicsQueue);
 }
 
+// Written in front of the driver's cache data. The driver validates its own
+// header too but some reject mismatching data by crashing.
+struct PipelineCacheFileHeader {
+  uint32_t Magic;
+  uint32_t DataSize;
+  uint32_t VendorID;
+  uint32_t DeviceID;
+  uint32_t DriverVersion;
+  uint8_t PipelineCacheUUID[VK_UUID_SIZE];
+};
+
+constexpr uint32_t kPipelineCacheMagic = 0x57504331;  // WPC1
+constexpr const char* kPipelineCachePath = "pipeline_cache.bin";
+
+static PipelineCacheFileHeader GetPipelineCacheFileHeader(
+    const VkPhysicalDeviceProperties& properties, uint32_t dataSize) {
+  PipelineCacheFileHeader header{};
+  header.Magic = kPipelineCacheMagic;
+  header.DataSize = dataSize;
+  header.VendorID = properties.vendorID;
+  header.DeviceID = properties.deviceID;
+  header.DriverVersion = properties.driverVersion;
+  std::memcpy(header.PipelineCacheUUID, properties.pipelineCacheUUID,
+              VK_UUID_SIZE);
+  return header;
+}
+
+void Renderer::CreatePipelineCache() {
+  std::vector<char> data;
+  if (std::filesystem::exists(kPipelineCachePath)) {
+    std::vector<char> file = ReadFile(kPipelineCachePath);
+    size_t dataSize =
+        file.size() - std::min(file.size(), sizeof(PipelineCacheFileHeader));
+    PipelineCacheFileHeader expected = GetPipelineCacheFileHeader(
+        m_PhysicalDeviceProperties, static_cast<uint32_t>(dataSize));
+    if (file.size() >= sizeof(PipelineCacheFileHeader) &&
+        std::memcmp(file.data(), &expected, sizeof(expected)) == 0) {
+      data.assign(file.begin() + sizeof(PipelineCacheFileHeader), file.end());
+    } else {
+      LOG_INFO("Pipeline cache was written by another device or driver");
+    }
+  }
+
+  VkPipelineCacheCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  createInfo.initialDataSize = data.size();
+  createInfo.pInitialData = data.empty() ? nullptr : data.data();
+  WIESEL_CHECK_VKRESULT(vkCreatePipelineCache(m_LogicalDevice, &createInfo,
+                                              nullptr, &m_PipelineCache));
+  m_PipelineCacheStats.LoadedFromDisk = !data.empty();
+  LOG_DEBUG("Loaded {} bytes of pipeline cache", data.size());
+}
+
+void Renderer::SavePipelineCache() {
+  size_t size = 0;
+  WIESEL_CHECK_VKRESULT(
+      vkGetPipelineCacheData(m_LogicalDevice, m_PipelineCache, &size, nullptr));
+  std::vector<char> file(sizeof(PipelineCacheFileHeader) + size);
+  WIESEL_CHECK_VKRESULT(vkGetPipelineCacheData(
+      m_LogicalDevice, m_PipelineCache, &size,
+      file.data() + sizeof(PipelineCacheFileHeader)));
+  file.resize(sizeof(PipelineCacheFileHeader) + size);
+  PipelineCacheFileHeader header = GetPipelineCacheFileHeader(
+      m_PhysicalDeviceProperties, static_cast<uint32_t>(size));
+  std::memcpy(file.data(), &header, sizeof(header));
+
+  std::ofstream out(kPipelineCachePath, std::ios::binary | std::ios::trunc);
+  if (out.is_open()) {
+    out.write(file.data(), static_cast<std::streamsize>(file.size()));
+    LOG_DEBUG("Saved {} bytes of pipeline cache", size);
+  } else {
+    LOG_WARN("Failed to write the pipeline cache to {}", kPipelineCachePath);
+  }
+  vkDestroyPipelineCache(m_LogicalDevice, m_PipelineCache, nullptr);
+  m_PipelineCache = VK_NULL_HANDLE;
+}
+
+void Renderer::RecordPipelineCreation(bool cacheHit,
+                                      std::chrono::microseconds time) {
+  std::lock_guard lock(m_PipelineCacheStatsMutex);
+  m_PipelineCacheStats.PipelineCount++;
+  if (cacheHit) {
+    m_PipelineCacheStats.CacheHits++;
+  }
+  m_PipelineCacheStats.CreationTime += time;
+}
+
 void Renderer::CreateDescriptorLayouts() {
   m_GeometryMeshDescriptorLayout = CreateReference<DescriptorSetLayout>();
   m_GeometryMeshDescriptorLayout->AddBinding(
@@ -1809,13 +2374,30 @@ void Renderer::CreateDescriptorLayouts() {
       VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
   m_GlobalDescriptorLayout->AddBinding(
-      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT |
+                                             VK_SHADER_STAGE_FRAGMENT_BIT |
+                                             VK_SHADER_STAGE_COMPUTE_BIT);
   m_GlobalDescriptorLayout->AddBinding(
       VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
   m_GlobalDescriptorLayout->AddBinding(
       VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
+  // Point lights and light clusters.
+  m_GlobalDescriptorLayout->AddBinding(
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT |
+                                             VK_SHADER_STAGE_FRAGMENT_BIT |
+                                             VK_SHADER_STAGE_COMPUTE_BIT);
+  m_GlobalDescriptorLayout->AddBinding(
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+      VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+  // Cached static shadow cascades.
+  m_GlobalDescriptorLayout->AddBinding(
+      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
+  // Point light shadows and the shadow atlas.
+  m_GlobalDescriptorLayout->AddBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                       VK_SHADER_STAGE_FRAGMENT_BIT);
+  m_GlobalDescriptorLayout->AddBinding(
+      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
   m_GlobalDescriptorLayout->Bake();
 
   m_PresentDescriptorLayout = CreateReference<DescriptorSetLayout>();
@@ -1830,20 +2412,24 @@ void Renderer::CreateDescriptorLayouts() {
 
   m_SSAOGenDescriptorLayout = CreateReference<DescriptorSetLayout>();
   m_SSAOGenDescriptorLayout->AddBinding(
-      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
+      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
   m_SSAOGenDescriptorLayout->AddBinding(
-      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
+      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
   m_SSAOGenDescriptorLayout->AddBinding(
-      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
-  m_SSAOGenDescriptorLayout->AddBinding(
-      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
+      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
   m_SSAOGenDescriptorLayout->AddBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                                        VK_SHADER_STAGE_FRAGMENT_BIT);
+                                        VK_SHADER_STAGE_COMPUTE_BIT);
+  m_SSAOGenDescriptorLayout->AddBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT);
   m_SSAOGenDescriptorLayout->Bake();
 
   m_SSAOBlurDescriptorLayout = CreateReference<DescriptorSetLayout>();
   m_SSAOBlurDescriptorLayout->AddBinding(
-      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
+      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_SSAOBlurDescriptorLayout->AddBinding(
+      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_SSAOBlurDescriptorLayout->AddBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                         VK_SHADER_STAGE_COMPUTE_BIT);
   m_SSAOBlurDescriptorLayout->Bake();
 
   m_SSAOOutputDescriptorLayout = CreateReference<DescriptorSetLayout>();
@@ -1860,10 +2446,6 @@ void Renderer::CreateDescriptorLayouts() {
       VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
   m_GeometryOutputDescriptorLayout->AddBinding(
       VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
-  m_GeometryOutputDescriptorLayout->AddBinding(
-      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
-  m_GeometryOutputDescriptorLayout->AddBinding(
-      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
   m_GeometryOutputDescriptorLayout->Bake();
 
   m_SpriteDrawDescriptorLayout = CreateReference<DescriptorSetLayout>();
@@ -1992,97 +2574,160 @@ void Renderer::CreateSwapChain() {
 
 void Renderer::CreateGeometryRenderPass() {
   LOG_DEBUG("Creating render pass");
+  // Outputs that are sampled later are left in shader read only by their
+  // pass. Without msaa the color attachments are sampled directly.
+  constexpr VkImageLayout kSampled = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  VkImageLayout colorFinalLayout = m_MsaaSamples == VK_SAMPLE_COUNT_1_BIT
+                                       ? kSampled
+                                       : VK_IMAGE_LAYOUT_UNDEFINED;
+  // Multisampled images are only needed until they are resolved.
+  bool msaaTransient = m_MsaaSamples > VK_SAMPLE_COUNT_1_BIT;
 
   m_GeometryRenderPass = CreateReference<RenderPass>(PassType::Geometry);
-  m_GeometryRenderPass->AttachOutput({.Type = AttachmentTextureType::Offscreen,
-                                      .Format = VK_FORMAT_R32G32B32A32_SFLOAT,
-                                      .MsaaSamples = m_MsaaSamples});
-  m_GeometryRenderPass->AttachOutput({.Type = AttachmentTextureType::Offscreen,
-                                      .Format = VK_FORMAT_R32G32B32A32_SFLOAT,
-                                      .MsaaSamples = m_MsaaSamples});
   m_GeometryRenderPass->AttachOutput({.Type = AttachmentTextureType::Offscreen,
                                       .Format = VK_FORMAT_R32_SFLOAT,
-                                      .MsaaSamples = m_MsaaSamples});
+                                      .MsaaSamples = m_MsaaSamples,
+                                      .FinalLayout = colorFinalLayout,
+                                      .Transient = msaaTransient});
   m_GeometryRenderPass->AttachOutput({.Type = AttachmentTextureType::Offscreen,
-                                      .Format = VK_FORMAT_R8G8B8A8_UNORM,
-                                      .MsaaSamples = m_MsaaSamples});
+                                      .Format = VK_FORMAT_R16G16_SFLOAT,
+                                      .MsaaSamples = m_MsaaSamples,
+                                      .FinalLayout = colorFinalLayout,
+                                      .Transient = msaaTransient});
   m_GeometryRenderPass->AttachOutput({.Type = AttachmentTextureType::Offscreen,
                                       .Format = VK_FORMAT_R8G8B8A8_UNORM,
-                                      .MsaaSamples = m_MsaaSamples});
+                                      .MsaaSamples = m_MsaaSamples,
+                                      .FinalLayout = colorFinalLayout,
+                                      .Transient = msaaTransient});
   m_GeometryRenderPass->AttachOutput({.Type = AttachmentTextureType::Offscreen,
-                                      .Format = VK_FORMAT_R16G16B16A16_SFLOAT,
-                                      .MsaaSamples = m_MsaaSamples});
+                                      .Format = VK_FORMAT_R8G8B8A8_UNORM,
+                                      .MsaaSamples = m_MsaaSamples,
+                                      .FinalLayout = colorFinalLayout,
+                                      .Transient = msaaTransient});
   m_GeometryRenderPass->AttachOutput(
       {.Type = AttachmentTextureType::DepthStencil,
        .Format = FindDepthFormat(),
-       .MsaaSamples = m_MsaaSamples});
+       .MsaaSamples = m_MsaaSamples,
+       .Transient = true});
   if (m_MsaaSamples > VK_SAMPLE_COUNT_1_BIT) {
-    m_GeometryRenderPass->AttachOutput({.Type = AttachmentTextureType::Resolve,
-                                        .Format = VK_FORMAT_R32G32B32A32_SFLOAT,
-                                        .MsaaSamples = VK_SAMPLE_COUNT_1_BIT});
-    m_GeometryRenderPass->AttachOutput({.Type = AttachmentTextureType::Resolve,
-                                        .Format = VK_FORMAT_R32G32B32A32_SFLOAT,
-                                        .MsaaSamples = VK_SAMPLE_COUNT_1_BIT});
     m_GeometryRenderPass->AttachOutput({.Type = AttachmentTextureType::Resolve,
                                         .Format = VK_FORMAT_R32_SFLOAT,
-                                        .MsaaSamples = VK_SAMPLE_COUNT_1_BIT});
+                                        .MsaaSamples = VK_SAMPLE_COUNT_1_BIT,
+                                        .FinalLayout = kSampled});
     m_GeometryRenderPass->AttachOutput({.Type = AttachmentTextureType::Resolve,
-                                        .Format = VK_FORMAT_R8G8B8A8_UNORM,
-                                        .MsaaSamples = VK_SAMPLE_COUNT_1_BIT});
+                                        .Format = VK_FORMAT_R16G16_SFLOAT,
+                                        .MsaaSamples = VK_SAMPLE_COUNT_1_BIT,
+                                        .FinalLayout = kSampled});
     m_GeometryRenderPass->AttachOutput({.Type = AttachmentTextureType::Resolve,
                                         .Format = VK_FORMAT_R8G8B8A8_UNORM,
-                                        .MsaaSamples = VK_SAMPLE_COUNT_1_BIT});
+                                        .MsaaSamples = VK_SAMPLE_COUNT_1_BIT,
+                                        .FinalLayout = kSampled});
     m_GeometryRenderPass->AttachOutput({.Type = AttachmentTextureType::Resolve,
-                                        .Format = VK_FORMAT_R16G16B16A16_SFLOAT,
-                                        .MsaaSamples = VK_SAMPLE_COUNT_1_BIT});
+                                        .Format = VK_FORMAT_R8G8B8A8_UNORM,
+                                        .MsaaSamples = VK_SAMPLE_COUNT_1_BIT,
+                                        .FinalLayout = kSampled});
   }
   m_GeometryRenderPass->Bake();
 
   m_LightingRenderPass = CreateReference<RenderPass>(PassType::Lighting);
   m_LightingRenderPass->AttachOutput({.Type = AttachmentTextureType::Offscreen,
                                       .Format = m_SwapChainImageFormat,
-                                      .MsaaSamples = m_MsaaSamples});
+                                      .MsaaSamples = m_MsaaSamples,
+                                      .FinalLayout = colorFinalLayout,
+                                      .Transient = msaaTransient});
   if (m_MsaaSamples > VK_SAMPLE_COUNT_1_BIT) {
     m_LightingRenderPass->AttachOutput({.Type = AttachmentTextureType::Resolve,
                                         .Format = m_SwapChainImageFormat,
-                                        .MsaaSamples = VK_SAMPLE_COUNT_1_BIT});
+                                        .MsaaSamples = VK_SAMPLE_COUNT_1_BIT,
+                                        .FinalLayout = kSampled});
   }
   m_LightingRenderPass->Bake();
 
   m_CompositeRenderPass = CreateReference<RenderPass>(PassType::PostProcess);
   m_CompositeRenderPass->AttachOutput({.Type = AttachmentTextureType::Offscreen,
                                        .Format = m_SwapChainImageFormat,
-                                       .MsaaSamples = m_MsaaSamples});
+                                       .MsaaSamples = m_MsaaSamples,
+                                       .FinalLayout = colorFinalLayout,
+                                      .Transient = msaaTransient});
   if (m_MsaaSamples > VK_SAMPLE_COUNT_1_BIT) {
     m_CompositeRenderPass->AttachOutput({.Type = AttachmentTextureType::Resolve,
                                          .Format = m_SwapChainImageFormat,
-                                         .MsaaSamples = VK_SAMPLE_COUNT_1_BIT});
+                                         .MsaaSamples = VK_SAMPLE_COUNT_1_BIT,
+                                         .FinalLayout = kSampled});
   }
   m_CompositeRenderPass->Bake();
 
   m_SpriteRenderPass = CreateReference<RenderPass>(PassType::PostProcess);
   m_SpriteRenderPass->AttachOutput({.Type = AttachmentTextureType::Offscreen,
                                     .Format = m_SwapChainImageFormat,
-                                    .MsaaSamples = VK_SAMPLE_COUNT_1_BIT});
+                                    .MsaaSamples = VK_SAMPLE_COUNT_1_BIT,
+                                    .FinalLayout = kSampled});
   m_SpriteRenderPass->Bake();
 
-  m_SSAOGenRenderPass = CreateReference<RenderPass>(PassType::PostProcess);
-  m_SSAOGenRenderPass->AttachOutput({.Type = AttachmentTextureType::Offscreen,
-                                     .Format = VK_FORMAT_R8_UNORM,
-                                     .MsaaSamples = VK_SAMPLE_COUNT_1_BIT});
-  m_SSAOGenRenderPass->Bake();
-
-  m_SSAOBlurRenderPass = CreateReference<RenderPass>(PassType::PostProcess);
-  m_SSAOBlurRenderPass->AttachOutput({.Type = AttachmentTextureType::Offscreen,
-                                      .Format = VK_FORMAT_R8_UNORM,
-                                      .MsaaSamples = VK_SAMPLE_COUNT_1_BIT});
-  m_SSAOBlurRenderPass->Bake();
+  CreateShadowRenderPass();
+}
 
+void Renderer::CreateShadowRenderPass() {
   m_ShadowRenderPass = CreateReference<RenderPass>(PassType::Shadow);
-  m_ShadowRenderPass->AttachOutput({.Type = AttachmentTextureType::DepthStencil,
-                                    .Format = FindDepthFormat(),
-                                    .MsaaSamples = VK_SAMPLE_COUNT_1_BIT});
+  m_ShadowRenderPass->AttachOutput(
+      {.Type = AttachmentTextureType::DepthStencil,
+       .Format = GetShadowDepthFormat(),
+       .MsaaSamples = VK_SAMPLE_COUNT_1_BIT,
+       .FinalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
   m_ShadowRenderPass->Bake();
+
+  // Only some tiles are redrawn each frame, the rest of the atlas is kept.
+  // Compatible with the shadow render pass so they share the pipeline.
+  m_ShadowAtlasRenderPass = CreateReference<RenderPass>(PassType::Shadow);
+  m_ShadowAtlasRenderPass->AttachOutput(
+      {.Type = AttachmentTextureType::DepthStencil,
+       .Format = GetShadowDepthFormat(),
+       .MsaaSamples = VK_SAMPLE_COUNT_1_BIT,
+       .FinalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+       .Load = true});
+  m_ShadowAtlasRenderPass->Bake();
+}
+
+void Renderer::CreateShadowAtlas() {
+  uint32_t resolution = m_ShadowSettings.AtlasResolution;
+  m_ShadowAtlasTexture = CreateAttachmentTexture(
+      {.Width = resolution,
+       .Height = resolution,
+       .Type = AttachmentTextureType::DepthStencil,
+       .ImageFormat = GetShadowDepthFormat(),
+       .Sampled = true,
+       .TransferDest = true});
+  std::array<AttachmentTexture*, 1> textures = {m_ShadowAtlasTexture.get()};
+  m_ShadowAtlasFramebuffer = m_ShadowAtlasRenderPass->CreateFramebuffer(
+      0, textures, {resolution, resolution});
+  // The atlas pass loads the previous contents, start out cleared to the far
+  // plane.
+  VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+  BarrierBatch barriers;
+  barriers.AddImageBarrier(*m_ShadowAtlasTexture, VK_IMAGE_LAYOUT_UNDEFINED,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, 0,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_TRANSFER_WRITE_BIT);
+  barriers.Flush(commandBuffer);
+  VkClearDepthStencilValue clearValue{1.0f, 0};
+  VkImageSubresourceRange range{VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+  if (HasStencilComponent(m_ShadowAtlasTexture->m_Format)) {
+    range.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+  }
+  vkCmdClearDepthStencilImage(commandBuffer, m_ShadowAtlasTexture->m_Images[0],
+                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                              &clearValue, 1, &range);
+  barriers.AddImageBarrier(*m_ShadowAtlasTexture,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_TRANSFER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT);
+  barriers.Flush(commandBuffer);
+  EndSingleTimeCommands(commandBuffer);
+
+  m_ShadowAtlas.Reset(resolution);
 }
 
 void Renderer::CreateGeometryGraphicsPipelines() {
@@ -2134,9 +2779,38 @@ void Renderer::CreateGeometryGraphicsPipelines() {
   m_LightingPipeline->AddInputLayout(m_GlobalDescriptorLayout);
   m_LightingPipeline->AddInputLayout(m_SkyboxDescriptorLayout);
   m_LightingPipeline->AddShader(fullscreenVertexShader);
-  m_LightingPipeline->AddShader(lightingFragmentShader);
+  m_ShadowSpecializationData.CascadeCount = m_ShadowSettings.CascadeCount;
+  m_LightingPipeline->AddShader(
+      lightingFragmentShader, &m_ShadowSpecializationData,
+      m_ShadowSpecializationData.GetSpecializationMapEntries());
   m_LightingPipeline->Bake();
 
+  auto lightVolumeVertexShader = CreateShader(
+      {ShaderTypeVertex, ShaderLangGLSL, "main", ShaderSourceSource,
+       "assets/shaders/light_volume_shader.vert"});
+  auto lightVolumeFragmentShader = CreateShader(
+      {ShaderTypeFragment, ShaderLangGLSL, "main", ShaderSourceSource,
+       "assets/shaders/light_volume_shader.frag"});
+  m_LightVolumePipeline = CreateReference<Pipeline>(
+      PipelineProperties{m_MsaaSamples, CullModeNone, false, false, false,
+                         false, true});
+  m_LightVolumePipeline->SetRenderPass(m_LightingRenderPass);
+  m_LightVolumePipeline->AddInputLayout(m_GeometryOutputDescriptorLayout);
+  m_LightVolumePipeline->AddInputLayout(m_SSAOOutputDescriptorLayout);
+  m_LightVolumePipeline->AddInputLayout(m_GlobalDescriptorLayout);
+  m_LightVolumePipeline->AddShader(lightVolumeVertexShader);
+  m_LightVolumePipeline->AddShader(lightVolumeFragmentShader);
+  m_LightVolumePipeline->Bake();
+
+  auto lightCullingShader =
+      CreateShader({ShaderTypeCompute, ShaderLangGLSL, "main",
+                    ShaderSourceSource, "assets/shaders/light_cluster_shader.comp"});
+  m_LightCullingPipeline = CreateReference<Pipeline>(PipelineProperties{
+      VK_SAMPLE_COUNT_1_BIT, CullModeNone, false, false, false, false});
+  m_LightCullingPipeline->AddInputLayout(m_GlobalDescriptorLayout);
+  m_LightCullingPipeline->AddShader(lightCullingShader);
+  m_LightCullingPipeline->Bake();
+
   auto shadowVertexShader =
       CreateShader({ShaderTypeVertex, ShaderLangGLSL, "main",
                     ShaderSourceSource, "assets/shaders/shadow_shader.vert"});
@@ -2156,29 +2830,29 @@ void Renderer::CreateGeometryGraphicsPipelines() {
   m_ShadowPipeline->AddShader(shadowFragmentShader);
   m_ShadowPipeline->Bake();
 
-  auto ssaoFragmentShader =
-      CreateShader({ShaderTypeFragment, ShaderLangGLSL, "main",
-                    ShaderSourceSource, "assets/shaders/ssao_gen_shader.frag"});
+  auto ssaoGenShader =
+      CreateShader({ShaderTypeCompute, ShaderLangGLSL, "main",
+                    ShaderSourceSource, "assets/shaders/ssao_gen_shader.comp"});
 
   m_SSAOGenPipeline = CreateReference<Pipeline>(PipelineProperties{
-      VK_SAMPLE_COUNT_1_BIT, CullModeFront, false, false, false, false});
-  m_SSAOGenPipeline->SetRenderPass(m_SSAOGenRenderPass);
+      VK_SAMPLE_COUNT_1_BIT, CullModeNone, false, false, false, false});
+  m_SSAOGenPipeline->AddPushConstant(m_SSAOGenPipelinePushConstant,
+                                     VK_SHADER_STAGE_COMPUTE_BIT);
   m_SSAOGenPipeline->AddInputLayout(m_SSAOGenDescriptorLayout);
   m_SSAOGenPipeline->AddInputLayout(m_GlobalDescriptorLayout);
-  m_SSAOGenPipeline->AddShader(fullscreenVertexShader);
-  m_SSAOGenPipeline->AddShader(ssaoFragmentShader);
+  m_SSAOGenPipeline->AddShader(ssaoGenShader);
   m_SSAOGenPipeline->Bake();
 
-  auto ssaoBlurFragmentShader = CreateShader(
-      {ShaderTypeFragment, ShaderLangGLSL, "main", ShaderSourceSource,
-       "assets/shaders/ssao_blur_shader.frag"});
+  auto ssaoBlurShader =
+      CreateShader({ShaderTypeCompute, ShaderLangGLSL, "main",
+                    ShaderSourceSource, "assets/shaders/ssao_blur_shader.comp"});
 
   m_SSAOBlurPipeline = CreateReference<Pipeline>(PipelineProperties{
-      VK_SAMPLE_COUNT_1_BIT, CullModeFront, false, false, false, false});
-  m_SSAOBlurPipeline->SetRenderPass(m_SSAOBlurRenderPass);
+      VK_SAMPLE_COUNT_1_BIT, CullModeNone, false, false, false, false});
+  m_SSAOBlurPipeline->AddPushConstant(m_SSAOBlurPipelinePushConstant,
+                                      VK_SHADER_STAGE_COMPUTE_BIT);
   m_SSAOBlurPipeline->AddInputLayout(m_SSAOBlurDescriptorLayout);
-  m_SSAOBlurPipeline->AddShader(fullscreenVertexShader);
-  m_SSAOBlurPipeline->AddShader(ssaoBlurFragmentShader);
+  m_SSAOBlurPipeline->AddShader(ssaoBlurShader);
   m_SSAOBlurPipeline->Bake();
 
   auto spriteVertexShader =
@@ -2456,6 +3130,9 @@ void Renderer::TransitionImageLayout(VkImage image, VkFormat format,
 
 void Renderer::CreateCommandPools() {
   m_CommandPool = CreateReference<CommandPool>();
+  for (uint32_t i = 0; i < JobSystem::GetThreadCount(); i++) {
+    m_RecordingCommandPools.push_back(CreateReference<CommandPool>());
+  }
 }
 
 void Renderer::CreateCommandBuffers() {
@@ -2464,6 +3141,10 @@ void Renderer::CreateCommandBuffers() {
 
 void Renderer::CreatePermanentResources() {
   m_ShadowPipelinePushConstant = CreateReference<ShadowPipelinePushConstant>();
+  m_SSAOGenPipelinePushConstant =
+      CreateReference<SSAOGenPipelinePushConstant>();
+  m_SSAOBlurPipelinePushConstant =
+      CreateReference<SSAOBlurPipelinePushConstant>();
 
   m_BlankTexture = CreateBlankTexture();
 
@@ -2486,22 +3167,10 @@ void Renderer::CreatePermanentResources() {
   // SSAO
   m_SSAOKernelUniformBuffer =
       CreateUniformBuffer(sizeof(SSAOKernelUniformData));
+  GenerateSSAOKernel();
   std::default_random_engine rndEngine((unsigned)time(nullptr));
   std::uniform_real_distribution<float> rndDist(0.0f, 1.0f);
 
-  // Sample kernel
-  for (uint32_t i = 0; i < WIESEL_SSAO_KERNEL_SIZE; ++i) {
-    glm::vec3 sample(rndDist(rndEngine) * 2.0 - 1.0,
-                     rndDist(rndEngine) * 2.0 - 1.0, rndDist(rndEngine));
-    sample = glm::normalize(sample);
-    sample *= rndDist(rndEngine);
-    float scale = float(i) / float(WIESEL_SSAO_KERNEL_SIZE);
-    scale = std::lerp(0.1f, 1.0f, scale * scale);
-    m_SSAOKernelUniformData.Samples[i] = glm::vec4(sample * scale, 0.0f);
-  }
-  memcpy(m_SSAOKernelUniformBuffer->m_Data, &m_SSAOKernelUniformData,
-         sizeof(m_SSAOKernelUniformData));
-
   // Random noise
   std::vector<glm::vec4> noiseValues(WIESEL_SSAO_NOISE_DIM *
                                      WIESEL_SSAO_NOISE_DIM);
@@ -2519,14 +3188,37 @@ void Renderer::CreatePermanentResources() {
                              .TransferDest = true});
   SetAttachmentTextureBuffer(m_SSAONoise, noiseValues.data(),
                              sizeof(glm::vec4));
+
+  CreateShadowAtlas();
 }
 
-void Renderer::CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels,
-                           VkSampleCountFlagBits numSamples, VkFormat format,
-                           VkImageTiling tiling, VkImageUsageFlags usage,
-                           VkMemoryPropertyFlags properties, VkImage& image,
-                           VkDeviceMemory& imageMemory,
-                           VkImageCreateFlags flags, uint32_t arrayLayers) {
+void Renderer::GenerateSSAOKernel() {
+  std::default_random_engine rndEngine((unsigned)time(nullptr));
+  std::uniform_real_distribution<float> rndDist(0.0f, 1.0f);
+
+  // Samples get closer to the center towards the start of the kernel, so the
+  // distribution depends on how many of them the quality uses.
+  uint32_t kernelSize = GetSSAOQualitySettings(m_SSAOQuality).KernelSize;
+  for (uint32_t i = 0; i < kernelSize; ++i) {
+    glm::vec3 sample(rndDist(rndEngine) * 2.0 - 1.0,
+                     rndDist(rndEngine) * 2.0 - 1.0, rndDist(rndEngine));
+    sample = glm::normalize(sample);
+    sample *= rndDist(rndEngine);
+    float scale = float(i) / float(kernelSize);
+    scale = std::lerp(0.1f, 1.0f, scale * scale);
+    m_SSAOKernelUniformData.Samples[i] = glm::vec4(sample * scale, 0.0f);
+  }
+  memcpy(m_SSAOKernelUniformBuffer->m_Data, &m_SSAOKernelUniformData,
+         sizeof(m_SSAOKernelUniformData));
+}
+
+void Renderer::CreateImageHandle(uint32_t width, uint32_t height,
+                                 uint32_t mipLevels,
+                                 VkSampleCountFlagBits numSamples,
+                                 VkFormat format, VkImageTiling tiling,
+                                 VkImageUsageFlags usage, VkImage& image,
+                                 VkImageCreateFlags flags,
+                                 uint32_t arrayLayers) {
   VkImageCreateInfo imageInfo{};
   imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -2552,6 +3244,16 @@ void Renderer::CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels,
   imageInfo.flags = flags;
   WIESEL_CHECK_VKRESULT(
       vkCreateImage(m_LogicalDevice, &imageInfo, nullptr, &image));
+}
+
+void Renderer::CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels,
+                           VkSampleCountFlagBits numSamples, VkFormat format,
+                           VkImageTiling tiling, VkImageUsageFlags usage,
+                           VkMemoryPropertyFlags properties, VkImage& image,
+                           VkDeviceMemory& imageMemory,
+                           VkImageCreateFlags flags, uint32_t arrayLayers) {
+  CreateImageHandle(width, height, mipLevels, numSamples, format, tiling, usage,
+                    image, flags, arrayLayers);
 
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(m_LogicalDevice, image, &memRequirements);
@@ -2785,11 +3487,23 @@ void Renderer::CreateGlobalUniformBuffers() {
   m_CameraUniformBuffer = CreateUniformBuffer(sizeof(CameraUniformData));
   m_ShadowCameraUniformBuffer =
       CreateUniformBuffer(sizeof(ShadowMapMatricesUniformData));
+  m_PointLightsStorageBuffer =
+      CreateStorageBuffer(sizeof(PointLightsStorageData), true);
+  m_PointShadowsStorageBuffer =
+      CreateStorageBuffer(sizeof(PointShadowsStorageData), true);
+  constexpr VkDeviceSize kClusterCount =
+      WIESEL_CLUSTER_GRID_X * WIESEL_CLUSTER_GRID_Y * WIESEL_CLUSTER_GRID_Z;
+  m_LightClustersStorageBuffer = CreateStorageBuffer(
+      sizeof(uint32_t) * kClusterCount * (1 + WIESEL_MAX_LIGHTS_PER_CLUSTER),
+      false);
 }
 
 void Renderer::CleanupGlobalUniformBuffers() {
   m_LightsUniformBuffer = nullptr;
   m_CameraUniformBuffer = nullptr;
+  m_PointLightsStorageBuffer = nullptr;
+  m_PointShadowsStorageBuffer = nullptr;
+  m_LightClustersStorageBuffer = nullptr;
 }
 
 void Renderer::RecreateSwapChain() {
@@ -2828,6 +3542,11 @@ void Renderer::SetViewport(VkExtent2D extent) {
 }
 
 void Renderer::SetViewport(glm::vec2 extent) {
+  SetViewport(extent, *m_CommandBuffer);
+}
+
+void Renderer::SetViewport(glm::vec2 extent,
+                           const CommandBuffer& commandBuffer) {
   VkViewport viewport{};
   viewport.x = 0.0f;
   viewport.y = 0.0f;
@@ -2835,17 +3554,39 @@ void Renderer::SetViewport(glm::vec2 extent) {
   viewport.height = extent.y;
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
-  vkCmdSetViewport(m_CommandBuffer->m_Handle, 0, 1, &viewport);
+  vkCmdSetViewport(commandBuffer.m_Handle, 0, 1, &viewport);
 
   VkRect2D scissor{};
   scissor.offset = {0, 0};
   scissor.extent.width = extent.x;
   scissor.extent.height = extent.y;
-  vkCmdSetScissor(m_CommandBuffer->m_Handle, 0, 1, &scissor);
+  vkCmdSetScissor(commandBuffer.m_Handle, 0, 1, &scissor);
+}
+
+void Renderer::SetViewport(glm::uvec2 offset, glm::uvec2 extent,
+                           const CommandBuffer& commandBuffer) {
+  VkViewport viewport{};
+  viewport.x = static_cast<float>(offset.x);
+  viewport.y = static_cast<float>(offset.y);
+  viewport.width = static_cast<float>(extent.x);
+  viewport.height = static_cast<float>(extent.y);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  vkCmdSetViewport(commandBuffer.m_Handle, 0, 1, &viewport);
+
+  VkRect2D scissor{};
+  scissor.offset = {static_cast<int32_t>(offset.x),
+                    static_cast<int32_t>(offset.y)};
+  scissor.extent.width = extent.x;
+  scissor.extent.height = extent.y;
+  vkCmdSetScissor(commandBuffer.m_Handle, 0, 1, &scissor);
 }
 
 void Renderer::BeginRender() {
   vkResetFences(m_LogicalDevice, 1, &m_Fence);
+  // The previous frame waited for its fence, its secondary buffers can go
+  // back to their pools.
+  m_SecondaryCommandBuffers.clear();
   m_CommandBuffer->Reset();
   m_CommandBuffer->Begin();
   if (m_PreviousMsaaSamples != m_MsaaSamples) {
@@ -2860,6 +3601,23 @@ void Renderer::BeginRender() {
     RecreateSwapChain();
     m_RecreateSwapChain = false;
     m_RecreatePipeline = false;
+    m_RecreationGeneration++;
+  }
+  if (m_RecreateShadowResources) {
+    vkDeviceWaitIdle(m_LogicalDevice);
+    LOG_INFO("Recreating shadow resources...");
+    m_ShadowSettings = m_NextShadowSettings;
+    CreateShadowRenderPass();
+    m_ShadowPipeline->SetRenderPass(m_ShadowRenderPass);
+    RecreatePipeline(m_ShadowPipeline);
+    m_ShadowSpecializationData.CascadeCount = m_ShadowSettings.CascadeCount;
+    RecreatePipeline(m_LightingPipeline);
+    CreateShadowAtlas();
+    // Cameras recreate their shadow maps and global descriptors before they
+    // are rendered
+    m_ShadowResourcesVersion++;
+    m_RecreateShadowResources = false;
+    m_RecreationGeneration++;
   }
   if (m_RecreatePipeline) {
     vkDeviceWaitIdle(m_LogicalDevice);
@@ -2868,7 +3626,146 @@ void Renderer::BeginRender() {
         m_EnableWireframe;  // Update wireframe mode
     RecreatePipeline(m_GeometryPipeline);
     m_RecreatePipeline = false;
+    m_RecreationGeneration++;
   }
+  UpdateShaderHotReload();
+}
+
+std::vector<Ref<Pipeline>> Renderer::GetPipelines() const {
+  return {m_GeometryPipeline,    m_SkyboxPipeline,       m_LightingPipeline,
+          m_LightVolumePipeline, m_LightCullingPipeline, m_ShadowPipeline,
+          m_SSAOGenPipeline,     m_SSAOBlurPipeline,     m_SpritePipeline,
+          m_CompositePipeline,   m_PresentPipeline};
+}
+
+void Renderer::UpdateShaderHotReload() {
+  if (m_ShaderReload.Thread.joinable()) {
+    if (!m_ShaderReload.Done.load(std::memory_order_acquire)) {
+      return;
+    }
+    m_ShaderReload.Thread.join();
+    ApplyShaderReload();
+  }
+  if (!m_EnableShaderHotReload) {
+    m_ShaderWatcher = nullptr;
+    m_ChangedShaders.clear();
+    return;
+  }
+  if (m_ShaderWatcher == nullptr) {
+    try {
+      m_ShaderWatcher = CreateScope<FileWatcher>("assets/shaders");
+    } catch (const std::exception& e) {
+      LOG_WARN("Disabling shader hot reload: {}", e.what());
+      m_EnableShaderHotReload = false;
+      return;
+    }
+  }
+  for (const auto& path : m_ShaderWatcher->Poll()) {
+    if (Spirv::FindShaderType(path)) {
+      m_ChangedShaders.insert(path);
+    }
+  }
+  if (!m_ChangedShaders.empty()) {
+    StartShaderReload();
+  }
+}
+
+void Renderer::StartShaderReload() {
+  std::vector<std::string> paths(m_ChangedShaders.begin(),
+                                 m_ChangedShaders.end());
+  m_ChangedShaders.clear();
+  m_ShaderReload.Entries.clear();
+  // The clones hold references to the render passes and descriptor set layouts
+  // of this moment, taken on the main thread which is the only one that
+  // recreates them, so the handles stay alive while the thread bakes.
+  m_ShaderReload.RecreationGeneration = m_RecreationGeneration;
+  m_ShaderReload.Paths = paths;
+  for (const auto& pipeline : GetPipelines()) {
+    for (const auto& path : paths) {
+      if (pipeline->UsesShader(path)) {
+        m_ShaderReload.Entries.push_back(
+            {pipeline, pipeline->m_Generation, pipeline->Clone()});
+        break;
+      }
+    }
+  }
+  if (m_ShaderReload.Entries.empty()) {
+    return;
+  }
+
+  LOG_INFO("Reloading {} shaders used by {} pipelines...", paths.size(),
+           m_ShaderReload.Entries.size());
+  m_ShaderReload.Done.store(false, std::memory_order_relaxed);
+  // Only the clones are touched here, the pipelines in use are left alone
+  // until ApplyShaderReload.
+  m_ShaderReload.Thread = std::thread([this, paths = std::move(paths)]() {
+    try {
+      std::vector<Ref<Shader>> shaders;
+      for (auto& entry : m_ShaderReload.Entries) {
+        for (auto& info : entry.Clone->m_Shaders) {
+          const ShaderProperties& properties = info.Shader->m_Properties;
+          auto changed = std::find_if(
+              paths.begin(), paths.end(), [&properties](const auto& path) {
+                return std::filesystem::path(path).lexically_normal() ==
+                       std::filesystem::path(properties.Path)
+                           .lexically_normal();
+              });
+          if (changed == paths.end()) {
+            continue;
+          }
+          // Pipelines that share a shader keep sharing it.
+          auto shader = std::find_if(
+              shaders.begin(), shaders.end(), [&properties](const auto& s) {
+                return s->m_Properties.Path == properties.Path &&
+                       s->m_Properties.Type == properties.Type;
+              });
+          if (shader == shaders.end()) {
+            shaders.push_back(CreateReference<Shader>(properties));
+            shader = shaders.end() - 1;
+          }
+          info.Shader = *shader;
+        }
+        entry.Clone->Bake();
+      }
+      m_ShaderReload.Succeeded = true;
+    } catch (const std::exception& e) {
+      LOG_ERROR("Shader reload failed: {}", e.what());
+      m_ShaderReload.Succeeded = false;
+    }
+    m_ShaderReload.Done.store(true, std::memory_order_release);
+  });
+}
+
+void Renderer::ApplyShaderReload() {
+  // Baked against render passes or layouts that were replaced since, bake
+  // again with the current ones.
+  if (m_ShaderReload.RecreationGeneration != m_RecreationGeneration) {
+    LOG_INFO("Pipelines were recreated during the shader reload, restarting");
+    m_ChangedShaders.insert(m_ShaderReload.Paths.begin(),
+                            m_ShaderReload.Paths.end());
+    m_ShaderReload.Entries.clear();
+    return;
+  }
+  // The previous frame's fence was waited for, none of the old handles are in
+  // use anymore.
+  if (m_ShaderReload.Succeeded) {
+    std::vector<Ref<Pipeline>> pipelines = GetPipelines();
+    for (auto& entry : m_ShaderReload.Entries) {
+      if (std::find(pipelines.begin(), pipelines.end(), entry.Target) ==
+          pipelines.end()) {
+        // Recreated with the swapchain, it already has the new shaders.
+        continue;
+      }
+      if (entry.Target->m_Generation != entry.Generation) {
+        entry.Target->m_Shaders = entry.Clone->m_Shaders;
+        entry.Target->Bake();
+        continue;
+      }
+      entry.Target->TakeHandles(*entry.Clone);
+    }
+    LOG_INFO("Reloaded {} pipelines", m_ShaderReload.Entries.size());
+  }
+  m_ShaderReload.Entries.clear();
 }
 
 bool Renderer::BeginPresent() {
@@ -2896,12 +3793,8 @@ bool Renderer::BeginPresent() {
                           m_CommandBuffer->m_Handle);
   }*/
 
-  TransitionImageLayout(m_Camera->CompositeColorResolveImage->m_Images[0],
-                        m_Camera->CompositeColorResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-
+  // The composite pass leaves its output in shader read only and the render
+  // graph makes the write visible, nothing to transition here.
   m_PresentPipeline->Bind(PipelineBindPointGraphics);
   m_PresentRenderPass->Begin(m_PresentFramebuffers[m_ImageIndex], m_ClearColor);
   SetViewport(m_Extent);
@@ -2910,13 +3803,6 @@ bool Renderer::BeginPresent() {
 
 void Renderer::EndPresent() {
   m_PresentRenderPass->End();
-  // This was done here to prevent some errors caused by doing it inside the pass
-  // I'm not sure if this is a correct solution, find out and move this to the present image if not required
-  TransitionImageLayout(m_Camera->CompositeColorResolveImage->m_Images[0],
-                        m_Camera->CompositeColorResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
   /*
   for (const auto& item : textures) {
     TransitionImageLayout(item->m_Images[0], item->m_Format,
@@ -2975,23 +3861,179 @@ void Renderer::BeginFrame() {
          sizeof(m_LightsUniformData));
   memcpy(m_CameraUniformBuffer->m_Data, &m_CameraUniformData,
          sizeof(m_CameraUniformData));
+  memcpy(m_PointLightsStorageBuffer->m_Data, &m_PointLightsStorageData,
+         m_PointLightsStorageData.GetUsedSize());
+  memcpy(m_PointShadowsStorageBuffer->m_Data, &m_ShadowAtlas.GetShadowData(),
+         sizeof(PointShadowsStorageData));
 }
 
-void Renderer::BeginShadowPass(uint32_t cascade) {
+void Renderer::BeginShadowPass(uint32_t cascade, bool staticCasters) {
   memcpy(m_ShadowCameraUniformBuffer->m_Data, &m_ShadowCameraUniformData,
          sizeof(m_ShadowCameraUniformData));
-  m_ShadowPipelinePushConstant->CascadeIndex = cascade;
+  m_ShadowPipelinePushConstant->ViewProjection =
+      m_Camera->ShadowMapCascades[cascade].ViewProjMatrix;
 
   m_ShadowPipeline->Bind(PipelineBindPointGraphics);
-  m_ShadowRenderPass->Begin(m_Camera->ShadowFramebuffers[cascade],
-                            {0, 0, 0, 1});
-  SetViewport(glm::vec2{WIESEL_SHADOWMAP_DIM, WIESEL_SHADOWMAP_DIM});
+  m_ShadowRenderPass->Begin(
+      staticCasters ? m_Camera->ShadowStaticFramebuffers[cascade]
+                    : m_Camera->ShadowFramebuffers[cascade],
+      {0, 0, 0, 1});
+  SetViewport(glm::vec2(m_Camera->ShadowMapResolution));
 }
 
 void Renderer::EndShadowPass() {
   m_ShadowRenderPass->End();
 }
 
+void Renderer::RecordShadowPasses(uint32_t drawCount, bool staticCasters,
+                                  const DrawRecordFn& shadowFn) {
+  if (!m_Camera->DoesShadowPass) {
+    return;
+  }
+  memcpy(m_ShadowCameraUniformBuffer->m_Data, &m_ShadowCameraUniformData,
+         sizeof(m_ShadowCameraUniformData));
+  RecordSecondaryPasses(true, staticCasters, drawCount, shadowFn);
+}
+
+void Renderer::RecordGeometryPass(uint32_t drawCount,
+                                  const DrawRecordFn& geometryFn) {
+  RecordSecondaryPasses(false, false, drawCount, geometryFn);
+}
+
+void Renderer::RecordSecondaryPasses(bool shadowPass, bool staticCasters,
+                                     uint32_t drawCount,
+                                     const DrawRecordFn& fn) {
+  // Jobs pick their command pool by thread index, which is only unique among
+  // the main thread and the workers.
+  if (JobSystem::IsExternalThread()) {
+    throw std::runtime_error("Draws can only be recorded from the main thread!");
+  }
+  // Split the draws so every thread gets some work, but don't go below a
+  // minimum chunk size, a secondary buffer has its own overhead.
+  constexpr uint32_t kMinDrawsPerChunk = 32;
+  uint32_t chunkCount = std::clamp(
+      (drawCount + kMinDrawsPerChunk - 1) / kMinDrawsPerChunk, 1u,
+      static_cast<uint32_t>(m_RecordingCommandPools.size()));
+  uint32_t chunkSize = (drawCount + chunkCount - 1) / chunkCount;
+  // Cascades to record, cached ones that are still valid are skipped
+  std::vector<uint32_t> cascades;
+  if (shadowPass) {
+    for (uint32_t i = 0; i < m_Camera->ShadowCascadeCount; i++) {
+      if (!staticCasters || m_Camera->ShadowMapCascades[i].IsStaticDirty) {
+        cascades.push_back(i);
+      }
+    }
+  }
+  const auto& shadowFramebuffers = staticCasters
+                                       ? m_Camera->ShadowStaticFramebuffers
+                                       : m_Camera->ShadowFramebuffers;
+  uint32_t passCount =
+      shadowPass ? static_cast<uint32_t>(cascades.size()) : 1;
+  RenderPass& renderPass =
+      shadowPass ? *m_ShadowRenderPass : *m_GeometryRenderPass;
+
+  size_t firstBuffer = m_SecondaryCommandBuffers.size();
+  m_SecondaryCommandBuffers.resize(firstBuffer + passCount * chunkCount);
+
+  JobCounter counter;
+  for (uint32_t pass = 0; pass < passCount; pass++) {
+    for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+      size_t slot = firstBuffer + pass * chunkCount + chunk;
+      JobSystem::Submit("Renderer::RecordPass", [&, pass, chunk, slot]() {
+        Ref<Framebuffer> framebuffer =
+            shadowPass ? shadowFramebuffers[cascades[pass]]
+                       : m_Camera->GeometryFramebuffer;
+
+        CommandPool& pool =
+            *m_RecordingCommandPools[JobSystem::GetThreadIndex()];
+        Ref<CommandBuffer> commandBuffer =
+            pool.CreateBuffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        commandBuffer->Begin(renderPass, *framebuffer);
+        if (shadowPass) {
+          m_ShadowPipeline->Bind(PipelineBindPointGraphics, *commandBuffer);
+          // The shared push constant holds whatever cascade was set last,
+          // every buffer pushes its own.
+          ShadowPipelinePushConstant pushConstant{
+              .ViewProjection =
+                  m_Camera->ShadowMapCascades[cascades[pass]].ViewProjMatrix};
+          vkCmdPushConstants(commandBuffer->m_Handle,
+                             m_ShadowPipeline->m_Layout,
+                             VK_SHADER_STAGE_VERTEX_BIT, 0,
+                             sizeof(pushConstant), &pushConstant);
+          SetViewport(glm::vec2(m_Camera->ShadowMapResolution),
+                      *commandBuffer);
+        } else {
+          m_GeometryPipeline->Bind(PipelineBindPointGraphics, *commandBuffer);
+          SetViewport(m_ViewportSize, *commandBuffer);
+        }
+        uint32_t begin = std::min(chunk * chunkSize, drawCount);
+        uint32_t end = std::min(begin + chunkSize, drawCount);
+        fn(*commandBuffer, begin, end);
+        commandBuffer->End();
+        m_SecondaryCommandBuffers[slot] = commandBuffer;
+      }, counter);
+    }
+  }
+  JobSystem::Wait(counter);
+
+  std::vector<VkCommandBuffer> handles(chunkCount);
+  for (uint32_t pass = 0; pass < passCount; pass++) {
+    for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+      handles[chunk] =
+          m_SecondaryCommandBuffers[firstBuffer + pass * chunkCount + chunk]
+              ->m_Handle;
+    }
+    if (shadowPass) {
+      renderPass.Begin(shadowFramebuffers[cascades[pass]], {0, 0, 0, 1},
+                       VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    } else {
+      renderPass.Begin(m_Camera->GeometryFramebuffer, {0, 0, 0, 0},
+                       VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    }
+    vkCmdExecuteCommands(m_CommandBuffer->m_Handle, chunkCount,
+                         handles.data());
+    renderPass.End();
+  }
+}
+
+void Renderer::RecordPointShadowPass(
+    const std::function<void(const PointShadowFaceUpdate&)>& drawFn) {
+  const auto& updates = m_ShadowAtlas.GetFaceUpdates();
+  if (updates.empty()) {
+    return;
+  }
+  m_ShadowPipeline->Bind(PipelineBindPointGraphics);
+  m_ShadowAtlasRenderPass->Begin(m_ShadowAtlasFramebuffer, {0, 0, 0, 1});
+  for (const auto& update : updates) {
+    SetViewport(update.Offset, glm::uvec2(update.Size), *m_CommandBuffer);
+    // The pass loads the atlas, only the tile being redrawn is cleared.
+    VkClearAttachment clearAttachment{
+        .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+        .clearValue = {.depthStencil = {1.0f, 0}}};
+    VkClearRect clearRect{
+        .rect = {{static_cast<int32_t>(update.Offset.x),
+                  static_cast<int32_t>(update.Offset.y)},
+                 {update.Size, update.Size}},
+        .baseArrayLayer = 0,
+        .layerCount = 1};
+    vkCmdClearAttachments(m_CommandBuffer->m_Handle, 1, &clearAttachment, 1,
+                          &clearRect);
+    ShadowPipelinePushConstant pushConstant{.ViewProjection =
+                                                update.ViewProjection};
+    vkCmdPushConstants(m_CommandBuffer->m_Handle, m_ShadowPipeline->m_Layout,
+                       VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstant),
+                       &pushConstant);
+    drawFn(update);
+  }
+  m_ShadowAtlasRenderPass->End();
+  // Other cameras rendered this frame sample the same atlas.
+  m_ShadowAtlas.ClearFaceUpdates();
+}
+
+bool Renderer::HasPointShadowUpdates() const {
+  return !m_ShadowAtlas.GetFaceUpdates().empty();
+}
+
 void Renderer::BeginGeometryPass() {
   m_GeometryPipeline->Bind(PipelineBindPointGraphics);
   m_GeometryRenderPass->Begin(m_Camera->GeometryFramebuffer, {0, 0, 0, 0});
@@ -3003,25 +4045,41 @@ void Renderer::EndGeometryPass() {
 }
 
 void Renderer::DrawModel(ModelComponent& model, const TransformComponent& transform, bool shadowPass) {
+  DrawModel(model, transform, shadowPass, *m_CommandBuffer);
+}
+
+void Renderer::DrawModel(ModelComponent& model,
+                         const TransformComponent& transform, bool shadowPass,
+                         const CommandBuffer& commandBuffer) {
   for (int i = 0; i < model.Data.Meshes.size(); i++) {
     const auto& mesh = model.Data.Meshes[i];
-    DrawMesh(mesh, transform, shadowPass);
+    DrawMesh(mesh, transform, shadowPass, commandBuffer);
   }
 }
 
 void Renderer::DrawMesh(Ref<Mesh> mesh, const TransformComponent& transform, bool shadowPass) {
+  DrawMesh(mesh, transform, shadowPass, *m_CommandBuffer);
+}
+
+void Renderer::DrawMesh(Ref<Mesh> mesh, const TransformComponent& transform,
+                        bool shadowPass, const CommandBuffer& commandBuffer) {
   if (!mesh->IsAllocated) {
     return;
   }
-  mesh->UpdateTransform(transform.TransformMatrix, transform.NormalMatrix);
+  // Every mesh is drawn once in the geometry pass, updating the uniform only
+  // there keeps shadow and geometry recordings from writing the same buffer
+  // at the same time. The GPU reads it after submit anyway.
+  if (!shadowPass) {
+    mesh->UpdateTransform(transform.TransformMatrix, transform.NormalMatrix);
+  }
 
   VkBuffer vertexBuffers[] = {mesh->VertexBuffer->m_Buffer};
   VkDeviceSize offsets[] = {0};
   static_assert(std::size(vertexBuffers) == std::size(offsets));
-  vkCmdBindVertexBuffers(m_CommandBuffer->m_Handle, 0, std::size(vertexBuffers),
+  vkCmdBindVertexBuffers(commandBuffer.m_Handle, 0, std::size(vertexBuffers),
                          vertexBuffers, offsets);
   // Todo get the index type from index buffer instead of hardcoding it.
-  vkCmdBindIndexBuffer(m_CommandBuffer->m_Handle, mesh->IndexBuffer->m_Buffer,
+  vkCmdBindIndexBuffer(commandBuffer.m_Handle, mesh->IndexBuffer->m_Buffer,
                        0, mesh->IndexBuffer->m_IndexType);
 
   VkPipelineLayout layout =
@@ -3033,11 +4091,11 @@ void Renderer::DrawMesh(Ref<Mesh> mesh, const TransformComponent& transform, boo
       shadowPass ? m_Camera->ShadowDescriptor->m_DescriptorSet
                  : m_Camera->GlobalDescriptor->m_DescriptorSet};
 
-  vkCmdBindDescriptorSets(m_CommandBuffer->m_Handle,
+  vkCmdBindDescriptorSets(commandBuffer.m_Handle,
                           VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 2, sets,
                           0, nullptr);
 
-  vkCmdDrawIndexed(m_CommandBuffer->m_Handle,
+  vkCmdDrawIndexed(commandBuffer.m_Handle,
                    static_cast<uint32_t>(mesh->Indices.size()), 1, 0, 0, 0);
 }
 
@@ -3067,164 +4125,63 @@ void Renderer::DrawSprite(SpriteComponent& sprite, const TransformComponent& tra
   vkCmdDraw(m_CommandBuffer->m_Handle, 6, 1, 0, 0);
 }
 
-void Renderer::BeginSSAOGenPass() {
-  TransitionImageLayout(m_Camera->GeometryViewPosResolveImage->m_Images[0],
-                        m_Camera->GeometryViewPosResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryWorldPosResolveImage->m_Images[0],
-                        m_Camera->GeometryWorldPosResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryDepthResolveImage->m_Images[0],
-                        m_Camera->GeometryDepthResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryNormalResolveImage->m_Images[0],
-                        m_Camera->GeometryNormalResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_SSAONoise->m_Images[0], m_SSAONoise->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  m_SSAOGenRenderPass->Begin(m_Camera->SSAOGenFramebuffer, {0, 0, 0, 0});
-  SetViewport(glm::vec2{m_ViewportSize.x / 2, m_ViewportSize.y / 2});
-}
-
-void Renderer::EndSSAOGenPass() {
-  m_SSAOGenRenderPass->End();
-  TransitionImageLayout(m_Camera->GeometryViewPosResolveImage->m_Images[0],
-                        m_Camera->GeometryViewPosResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryWorldPosResolveImage->m_Images[0],
-                        m_Camera->GeometryWorldPosResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryDepthResolveImage->m_Images[0],
-                        m_Camera->GeometryDepthResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryNormalResolveImage->m_Images[0],
-                        m_Camera->GeometryNormalResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_SSAONoise->m_Images[0], m_SSAONoise->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-}
-
-void Renderer::BeginSSAOBlurPass() {
-  TransitionImageLayout(m_Camera->SSAOColorImage->m_Images[0],
-                        m_Camera->SSAOColorImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  m_SSAOBlurRenderPass->Begin(m_Camera->SSAOBlurFramebuffer, {0, 0, 0, 0});
-  SetViewport(m_ViewportSize);
+void Renderer::DispatchSSAOGen() {
+  SSAOQualitySettings settings = GetSSAOQualitySettings(m_SSAOQuality);
+  m_SSAOGenPipelinePushConstant->KernelSize = settings.KernelSize;
+  m_SSAOGenPipelinePushConstant->Radius = settings.Radius;
+  m_SSAOGenPipeline->Bind(PipelineBindPointCompute);
+  VkDescriptorSet sets[] = {m_Camera->SSAOGenDescriptor->m_DescriptorSet,
+                            m_Camera->GlobalDescriptor->m_DescriptorSet};
+  vkCmdBindDescriptorSets(
+      m_CommandBuffer->m_Handle, VK_PIPELINE_BIND_POINT_COMPUTE,
+      m_SSAOGenPipeline->m_Layout, 0, std::size(sets), sets, 0, nullptr);
+  // Every ssao image has the same size, one invocation per texel.
+  const Ref<AttachmentTexture>& target = m_Camera->SSAOColorImage;
+  vkCmdDispatch(m_CommandBuffer->m_Handle,
+                (target->m_Width + WIESEL_SSAO_WORKGROUP_SIZE - 1) /
+                    WIESEL_SSAO_WORKGROUP_SIZE,
+                (target->m_Height + WIESEL_SSAO_WORKGROUP_SIZE - 1) /
+                    WIESEL_SSAO_WORKGROUP_SIZE,
+                1);
 }
 
-void Renderer::EndSSAOBlurPass() {
-  m_SSAOBlurRenderPass->End();
-  TransitionImageLayout(m_Camera->SSAOColorImage->m_Images[0],
-                        m_Camera->SSAOColorImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
+void Renderer::DispatchSSAOBlur(bool vertical) {
+  m_SSAOBlurPipelinePushConstant->Direction =
+      vertical ? glm::ivec2(0, 1) : glm::ivec2(1, 0);
+  m_SSAOBlurPipeline->Bind(PipelineBindPointCompute);
+  const Ref<DescriptorSet>& descriptor =
+      vertical ? m_Camera->SSAOBlurVerticalDescriptor
+               : m_Camera->SSAOBlurHorizontalDescriptor;
+  vkCmdBindDescriptorSets(m_CommandBuffer->m_Handle,
+                          VK_PIPELINE_BIND_POINT_COMPUTE,
+                          m_SSAOBlurPipeline->m_Layout, 0, 1,
+                          &descriptor->m_DescriptorSet, 0, nullptr);
+  const Ref<AttachmentTexture>& target = m_Camera->SSAOColorImage;
+  vkCmdDispatch(m_CommandBuffer->m_Handle,
+                (target->m_Width + WIESEL_SSAO_WORKGROUP_SIZE - 1) /
+                    WIESEL_SSAO_WORKGROUP_SIZE,
+                (target->m_Height + WIESEL_SSAO_WORKGROUP_SIZE - 1) /
+                    WIESEL_SSAO_WORKGROUP_SIZE,
+                1);
+}
+
+void Renderer::DispatchLightCulling() {
+  m_LightCullingPipeline->Bind(PipelineBindPointCompute);
+  vkCmdBindDescriptorSets(m_CommandBuffer->m_Handle,
+                          VK_PIPELINE_BIND_POINT_COMPUTE,
+                          m_LightCullingPipeline->m_Layout, 0, 1,
+                          &m_Camera->GlobalDescriptor->m_DescriptorSet, 0,
+                          nullptr);
+  // One workgroup per depth slice, one invocation per cluster.
+  vkCmdDispatch(m_CommandBuffer->m_Handle, 1, 1, WIESEL_CLUSTER_GRID_Z);
 }
 
 void Renderer::BeginLightingPass() {
-  TransitionImageLayout(m_Camera->GeometryViewPosResolveImage->m_Images[0],
-                        m_Camera->GeometryViewPosResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryWorldPosResolveImage->m_Images[0],
-                        m_Camera->GeometryWorldPosResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryNormalResolveImage->m_Images[0],
-                        m_Camera->GeometryNormalResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryAlbedoResolveImage->m_Images[0],
-                        m_Camera->GeometryAlbedoResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryMaterialResolveImage->m_Images[0],
-                        m_Camera->GeometryMaterialResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->SSAOBlurColorImage->m_Images[0],
-                        m_Camera->SSAOBlurColorImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  if (m_Camera->ShadowDepthStencil) {
-    TransitionImageLayout(m_Camera->ShadowDepthStencil->m_Images[0],
-                          m_Camera->ShadowDepthStencil->m_Format,
-                          VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                          m_CommandBuffer->m_Handle, 0,
-                          WIESEL_SHADOW_CASCADE_COUNT);
-  }
   m_LightingRenderPass->Begin(m_Camera->LightingFramebuffer, m_ClearColor);
 }
 
 void Renderer::EndLightingPass() {
   m_LightingRenderPass->End();
-  TransitionImageLayout(m_Camera->GeometryViewPosResolveImage->m_Images[0],
-                        m_Camera->GeometryViewPosResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryWorldPosResolveImage->m_Images[0],
-                        m_Camera->GeometryWorldPosResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryNormalResolveImage->m_Images[0],
-                        m_Camera->GeometryNormalResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryAlbedoResolveImage->m_Images[0],
-                        m_Camera->GeometryAlbedoResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->GeometryMaterialResolveImage->m_Images[0],
-                        m_Camera->GeometryMaterialResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->SSAOBlurColorImage->m_Images[0],
-                        m_Camera->SSAOBlurColorImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  if (m_Camera->ShadowDepthStencil) {
-    TransitionImageLayout(m_Camera->ShadowDepthStencil->m_Images[0],
-                          m_Camera->ShadowDepthStencil->m_Format,
-                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                          VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1,
-                          m_CommandBuffer->m_Handle, 0,
-                          WIESEL_SHADOW_CASCADE_COUNT);
-  }
 }
 
 void Renderer::BeginSpritePass() {
@@ -3236,31 +4193,11 @@ void Renderer::EndSpritePass() {
 }
 
 void Renderer::BeginCompositePass() {
-  TransitionImageLayout(m_Camera->LightingColorResolveImage->m_Images[0],
-                        m_Camera->LightingColorResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->SpriteColorImage->m_Images[0],
-                        m_Camera->SpriteColorImage->m_Format,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
   m_CompositeRenderPass->Begin(m_Camera->CompositeFramebuffer, m_ClearColor);
 }
 
 void Renderer::EndCompositePass() {
   m_CompositeRenderPass->End();
-  TransitionImageLayout(m_Camera->LightingColorResolveImage->m_Images[0],
-                        m_Camera->LightingColorResolveImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
-  TransitionImageLayout(m_Camera->SpriteColorImage->m_Images[0],
-                        m_Camera->SpriteColorImage->m_Format,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1,
-                        m_CommandBuffer->m_Handle, 0, 1);
 }
 
 void Renderer::DrawSkybox(Ref<Skybox> skybox) {
@@ -3298,6 +4235,24 @@ void Renderer::DrawFullscreen(
   vkCmdDraw(m_CommandBuffer->m_Handle, 3, 1, 0, 0);
 }
 
+void Renderer::DrawPointLightVolumes() {
+  if (m_PointLightsStorageData.PointLightCount == 0) {
+    return;
+  }
+  m_LightVolumePipeline->Bind(PipelineBindPointGraphics);
+  VkDescriptorSet sets[] = {
+      m_Camera->GeometryOutputDescriptor->m_DescriptorSet,
+      m_Camera->SSAOOutputDescriptor->m_DescriptorSet,
+      m_Camera->GlobalDescriptor->m_DescriptorSet};
+  vkCmdBindDescriptorSets(
+      m_CommandBuffer->m_Handle, VK_PIPELINE_BIND_POINT_GRAPHICS,
+      m_LightVolumePipeline->m_Layout, 0, std::size(sets), sets, 0, nullptr);
+
+  // One rectangle per light, the vertex shader fits it around the light.
+  vkCmdDraw(m_CommandBuffer->m_Handle, 6,
+            m_PointLightsStorageData.PointLightCount, 0, 0);
+}
+
 void Renderer::EndFrame() {}
 
 void Renderer::SetCameraData(Ref<CameraData> cameraData) {
@@ -3307,10 +4262,11 @@ void Renderer::SetCameraData(Ref<CameraData> cameraData) {
   m_CameraUniformData.ViewMatrix = cameraData->ViewMatrix;
   m_CameraUniformData.Projection = cameraData->Projection;
   m_CameraUniformData.InvProjection = cameraData->InvProjection;
+  m_CameraUniformData.InvViewMatrix = cameraData->InvViewMatrix;
   m_CameraUniformData.NearPlane = cameraData->NearPlane;
   m_CameraUniformData.FarPlane = cameraData->FarPlane;
   m_ShadowCameraUniformData.EnableShadows = cameraData->DoesShadowPass;
-  for (int i = 0; i < WIESEL_SHADOW_CASCADE_COUNT; ++i) {
+  for (int i = 0; i < WIESEL_SHADOW_MAX_CASCADE_COUNT; ++i) {
     m_ShadowCameraUniformData.ViewProjectionMatrix[i] =
         cameraData->ShadowMapCascades[i].ViewProjMatrix;
     m_CameraUniformData.CascadeSplits[i] =
@@ -3318,6 +4274,7 @@ void Renderer::SetCameraData(Ref<CameraData> cameraData) {
   }
   // Todo move this to another ubo for options maybe
   m_CameraUniformData.EnableSSAO = m_EnableSSAO;
+  m_CameraUniformData.EnableLightVolumes = m_EnableLightVolumes;
 }
 
 std::vector<const char*> Renderer::GetRequiredExtensions() {
@@ -3477,6 +4434,24 @@ bool Renderer::CheckDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+bool Renderer::IsDeviceExtensionSupported(VkPhysicalDevice device,
+                                          const char* extension) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
+                                       nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
+                                       availableExtensions.data());
+
+  for (const auto& available : availableExtensions) {
+    if (std::strcmp(available.extensionName, extension) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 QueueFamilyIndices Renderer::FindQueueFamilies(VkPhysicalDevice device) {
   QueueFamilyIndices indices;
   // Logic to find queue family indices to populate struct with
@@ -3540,6 +4515,16 @@ SwapChainSupportDetails Renderer::QuerySwapChainSupport(
 
 uint32_t Renderer::FindMemoryType(uint32_t typeFilter,
                                   VkMemoryPropertyFlags properties) {
+  std::optional<uint32_t> type = TryFindMemoryType(typeFilter, properties);
+  if (type) {
+    return *type;
+  }
+
+  throw std::runtime_error("failed to find suitable memory type!");
+}
+
+std::optional<uint32_t> Renderer::TryFindMemoryType(
+    uint32_t typeFilter, VkMemoryPropertyFlags properties) {
   VkPhysicalDeviceMemoryProperties memProperties;
   vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memProperties);
   for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
@@ -3548,8 +4533,7 @@ uint32_t Renderer::FindMemoryType(uint32_t typeFilter,
       return i;
     }
   }
-
-  throw std::runtime_error("failed to find suitable memory type!");
+  return std::nullopt;
 }
 
 #ifdef VULKAN_VALIDATION
@@ -0,0 +1,566 @@
+//
+//    Copyright 2023 Metehan Gezer
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "rendering/w_rendergraph.hpp"
+
+#include "w_engine.hpp"
+
+namespace Wiesel {
+
+namespace {
+
+struct UsageState {
+  VkImageLayout Layout;
+  VkPipelineStageFlags Stages;
+  VkAccessFlags Access;
+};
+
+UsageState GetUsageState(RenderGraphUsage usage) {
+  switch (usage) {
+    case RenderGraphUsage::ColorAttachment:
+      return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+              VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+              VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                  VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+    case RenderGraphUsage::DepthStencilAttachment:
+      return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+              VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                  VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+    case RenderGraphUsage::FragmentSampled:
+      return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+              VK_ACCESS_SHADER_READ_BIT};
+    case RenderGraphUsage::ComputeSampled:
+      return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT};
+    case RenderGraphUsage::ComputeStorageImage:
+      return {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+              VK_ACCESS_SHADER_WRITE_BIT};
+    case RenderGraphUsage::ComputeStorageWrite:
+      return {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+              VK_ACCESS_SHADER_WRITE_BIT};
+    case RenderGraphUsage::FragmentStorageRead:
+      return {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+              VK_ACCESS_SHADER_READ_BIT};
+  }
+  throw std::runtime_error("Unknown render graph usage!");
+}
+
+VkAccessFlags GetWriteAccess(VkAccessFlags access) {
+  return access & (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                   VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+const char* GetUsageName(RenderGraphUsage usage) {
+  switch (usage) {
+    case RenderGraphUsage::ColorAttachment:
+      return "ColorAttachment";
+    case RenderGraphUsage::DepthStencilAttachment:
+      return "DepthStencilAttachment";
+    case RenderGraphUsage::FragmentSampled:
+      return "FragmentSampled";
+    case RenderGraphUsage::ComputeSampled:
+      return "ComputeSampled";
+    case RenderGraphUsage::ComputeStorageImage:
+      return "ComputeStorageImage";
+    case RenderGraphUsage::ComputeStorageWrite:
+      return "ComputeStorageWrite";
+    case RenderGraphUsage::FragmentStorageRead:
+      return "FragmentStorageRead";
+  }
+  return "Unknown";
+}
+
+}  // namespace
+
+RenderGraphPassBuilder& RenderGraphPassBuilder::Read(
+    RenderGraphResourceId resource, RenderGraphUsage usage) {
+  m_Graph.m_Passes[m_Pass].Accesses.push_back(
+      {.Resource = resource, .Usage = usage, .Write = false});
+  return *this;
+}
+
+RenderGraphPassBuilder& RenderGraphPassBuilder::Write(
+    RenderGraphResourceId resource, RenderGraphUsage usage) {
+  m_Graph.m_Passes[m_Pass].Accesses.push_back(
+      {.Resource = resource, .Usage = usage, .Write = true});
+  return *this;
+}
+
+RenderGraphPassBuilder& RenderGraphPassBuilder::Write(
+    RenderGraphResourceId resource, RenderGraphUsage usage,
+    RenderGraphUsage finalUsage) {
+  m_Graph.m_Passes[m_Pass].Accesses.push_back({.Resource = resource,
+                                               .Usage = usage,
+                                               .Write = true,
+                                               .FinalUsage = finalUsage});
+  return *this;
+}
+
+RenderGraphPassBuilder& RenderGraphPassBuilder::SetEnabled(bool enabled) {
+  m_Graph.m_Passes[m_Pass].Enabled = enabled;
+  return *this;
+}
+
+RenderGraphResourceId RenderGraph::ImportTexture(
+    const std::string& name, Ref<AttachmentTexture> texture,
+    RenderGraphUsage restingUsage, uint32_t layerCount) {
+  for (RenderGraphResourceId i = 0; i < m_Resources.size(); i++) {
+    if (m_Resources[i].Texture && m_Resources[i].Texture == texture) {
+      return i;
+    }
+  }
+  m_Resources.push_back(Resource{.Name = name,
+                                 .Texture = texture,
+                                 .RestingUsage = restingUsage,
+                                 .LayerCount = layerCount});
+  m_Compiled = false;
+  return static_cast<RenderGraphResourceId>(m_Resources.size() - 1);
+}
+
+RenderGraphResourceId RenderGraph::ImportBuffer(const std::string& name,
+                                               Ref<StorageBuffer> buffer,
+                                               RenderGraphUsage restingUsage) {
+  for (RenderGraphResourceId i = 0; i < m_Resources.size(); i++) {
+    if (m_Resources[i].Buffer && m_Resources[i].Buffer == buffer) {
+      return i;
+    }
+  }
+  m_Resources.push_back(Resource{.Name = name,
+                                 .Buffer = buffer,
+                                 .RestingUsage = restingUsage,
+                                 .LayerCount = 1});
+  m_Compiled = false;
+  return static_cast<RenderGraphResourceId>(m_Resources.size() - 1);
+}
+
+void RenderGraph::MarkOutput(RenderGraphResourceId resource) {
+  m_Resources[resource].IsOutput = true;
+  m_Compiled = false;
+}
+
+void RenderGraph::CarryStateFrom(const RenderGraph& previous) {
+  for (Resource& resource : m_Resources) {
+    for (const Resource& other : previous.m_Resources) {
+      if ((resource.Texture && resource.Texture == other.Texture) ||
+          (resource.Buffer && resource.Buffer == other.Buffer)) {
+        resource.InitialState = other.FinalState;
+        break;
+      }
+    }
+  }
+  m_Compiled = false;
+}
+
+RenderGraphPassBuilder RenderGraph::AddPass(const std::string& name,
+                                            ExecuteFn fn) {
+  m_Passes.push_back(Pass{.Name = name, .Fn = std::move(fn)});
+  m_Compiled = false;
+  return RenderGraphPassBuilder(*this,
+                                static_cast<uint32_t>(m_Passes.size() - 1));
+}
+
+void RenderGraph::Compile() {
+  if (MatchesCompiled()) {
+    // Callbacks aren't part of the barriers, take the ones just declared.
+    for (size_t i = 0; i < m_Passes.size(); i++) {
+      m_CompiledPasses[i].Fn = std::move(m_Passes[i].Fn);
+    }
+    std::swap(m_Passes, m_CompiledPasses);
+    std::swap(m_Resources, m_CompiledResources);
+    m_Compiled = true;
+    return;
+  }
+
+  // Walk backwards from the outputs, a pass is kept only if something that
+  // is kept reads what it writes.
+  std::vector<bool> needed(m_Resources.size(), false);
+  for (RenderGraphResourceId i = 0; i < m_Resources.size(); i++) {
+    needed[i] = m_Resources[i].IsOutput;
+  }
+  for (int32_t i = static_cast<int32_t>(m_Passes.size()) - 1; i >= 0; i--) {
+    Pass& pass = m_Passes[i];
+    bool contributes = false;
+    for (const auto& access : pass.Accesses) {
+      if (access.Write && needed[access.Resource]) {
+        contributes = true;
+        break;
+      }
+    }
+    pass.Culled = !pass.Enabled || !contributes;
+    if (pass.Culled) {
+      continue;
+    }
+    for (const auto& access : pass.Accesses) {
+      if (!access.Write) {
+        needed[access.Resource] = true;
+      }
+    }
+  }
+
+  // Track the state of every resource through the kept passes. Stages is
+  // zero until the resource is touched, the previous frame is already
+  // finished when the graph starts. Resources carried over from a previous
+  // graph start where it left them. VisibleStages are the stages a barrier
+  // already made the last write visible to, reads in other stages still have
+  // to wait for it.
+  struct State {
+    VkImageLayout Layout;
+    VkPipelineStageFlags Stages;
+    VkAccessFlags Access;
+    bool Written;
+    VkPipelineStageFlags VisibleStages;
+  };
+  std::vector<State> states(m_Resources.size());
+  for (RenderGraphResourceId i = 0; i < m_Resources.size(); i++) {
+    Resource& resource = m_Resources[i];
+    resource.FirstPass = -1;
+    resource.LastPass = -1;
+    resource.IsTransient = false;
+    const RenderGraphResourceState& initial = resource.InitialState;
+    states[i] = {GetUsageState(resource.RestingUsage).Layout, initial.Stages,
+                 initial.Access, initial.Written, initial.VisibleStages};
+  }
+
+  for (int32_t i = 0; i < static_cast<int32_t>(m_Passes.size()); i++) {
+    Pass& pass = m_Passes[i];
+    pass.Barriers.Clear();
+    if (pass.Culled) {
+      continue;
+    }
+    for (const auto& access : pass.Accesses) {
+      Resource& resource = m_Resources[access.Resource];
+      State& state = states[access.Resource];
+      UsageState usage = GetUsageState(access.Usage);
+
+      if (resource.FirstPass < 0) {
+        resource.FirstPass = i;
+        // Buffers are never aliased.
+        resource.IsTransient =
+            access.Write && !resource.IsOutput && resource.Texture;
+      }
+      resource.LastPass = i;
+
+      // The memory is shared with other attachments, whatever touched them
+      // earlier in the frame has to be done before it is overwritten.
+      if (state.Stages == 0 && access.Write && resource.Texture &&
+          resource.Texture->m_AliasedMemory) {
+        for (RenderGraphResourceId j = 0; j < m_Resources.size(); j++) {
+          const State& other = states[j];
+          if (j == access.Resource || other.Stages == 0 ||
+              !m_Resources[j].Texture ||
+              m_Resources[j].Texture->m_AliasedMemory !=
+                  resource.Texture->m_AliasedMemory) {
+            continue;
+          }
+          pass.Barriers.AddMemoryBarrier(other.Stages,
+                                         other.Written ? other.Access : 0,
+                                         usage.Stages, usage.Access);
+        }
+        state.Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+      }
+
+      if (access.FinalUsage) {
+        // The render pass does the transitions, contents are discarded so
+        // only earlier accesses in this frame have to be waited for.
+        if (state.Stages != 0) {
+          pass.Barriers.AddMemoryBarrier(
+              state.Stages, state.Written ? state.Access : 0, usage.Stages,
+              usage.Access);
+        }
+        state = {GetUsageState(*access.FinalUsage).Layout, usage.Stages,
+                 GetWriteAccess(usage.Access), true, 0};
+        continue;
+      }
+
+      bool layoutChange = state.Layout != usage.Layout;
+      bool hazard = state.Stages != 0 &&
+                    (access.Write ||
+                     (state.Written &&
+                      (usage.Stages & ~state.VisibleStages) != 0));
+      if (!layoutChange && !hazard) {
+        if (access.Write) {
+          // First access of the frame, only buffers get here.
+          state = {usage.Layout, usage.Stages, GetWriteAccess(usage.Access),
+                   true, 0};
+          continue;
+        }
+        // Another read in the same layout, a later write has to wait for
+        // this one as well.
+        state.Stages |= usage.Stages;
+        continue;
+      }
+      VkAccessFlags srcAccess = state.Written ? state.Access : 0;
+      if (layoutChange) {
+        pass.Barriers.AddImageBarrier(*resource.Texture, state.Layout,
+                                      usage.Layout, state.Stages, srcAccess,
+                                      usage.Stages, usage.Access,
+                                      resource.LayerCount);
+      } else if (resource.Buffer) {
+        pass.Barriers.AddBufferBarrier(resource.Buffer->m_Buffer, state.Stages,
+                                       srcAccess, usage.Stages, usage.Access);
+      } else {
+        pass.Barriers.AddMemoryBarrier(state.Stages, srcAccess, usage.Stages,
+                                       usage.Access);
+      }
+      if (access.Write) {
+        state = {usage.Layout, usage.Stages, GetWriteAccess(usage.Access), true,
+                 0};
+        continue;
+      }
+      // Reads in other stages chain onto this barrier, so the last write and
+      // the layout transition stay what they wait for.
+      state.VisibleStages =
+          layoutChange ? usage.Stages : state.VisibleStages | usage.Stages;
+      state.Written = state.Written || layoutChange;
+      state.Layout = usage.Layout;
+      state.Stages |= usage.Stages;
+    }
+  }
+
+  ValidateAliasing();
+
+  // Whatever the final barriers wait for is chained onto them, the next graph
+  // only has to wait for the resting stages.
+  m_FinalBarriers.Clear();
+  for (RenderGraphResourceId i = 0; i < m_Resources.size(); i++) {
+    Resource& resource = m_Resources[i];
+    UsageState resting = GetUsageState(resource.RestingUsage);
+    const State& state = states[i];
+    if (state.Layout == resting.Layout) {
+      // Outputs are read after the graph, make the last write visible.
+      if (resource.IsOutput && state.Written) {
+        m_FinalBarriers.AddMemoryBarrier(state.Stages, state.Access,
+                                         resting.Stages, resting.Access);
+        resource.FinalState = {resting.Stages, 0, true, resting.Stages};
+        continue;
+      }
+      resource.FinalState = {state.Stages, state.Access, state.Written,
+                             state.VisibleStages};
+      continue;
+    }
+    m_FinalBarriers.AddImageBarrier(
+        *resource.Texture, state.Layout, resting.Layout, state.Stages,
+        state.Written ? state.Access : 0, resting.Stages, resting.Access,
+        resource.LayerCount);
+    resource.FinalState = {resting.Stages, 0, true, resting.Stages};
+  }
+  m_Compiled = true;
+}
+
+void RenderGraph::ValidateAliasing() const {
+  for (RenderGraphResourceId i = 0; i < m_Resources.size(); i++) {
+    const Resource& resource = m_Resources[i];
+    if (!resource.Texture || !resource.Texture->m_AliasedMemory ||
+        resource.FirstPass < 0) {
+      continue;
+    }
+    if (!resource.IsTransient) {
+      throw std::runtime_error("Aliased render graph resource " +
+                               resource.Name + " is read before written!");
+    }
+    for (RenderGraphResourceId j = i + 1; j < m_Resources.size(); j++) {
+      const Resource& other = m_Resources[j];
+      if (!other.Texture || other.FirstPass < 0 ||
+          other.Texture->m_AliasedMemory != resource.Texture->m_AliasedMemory) {
+        continue;
+      }
+      if (resource.FirstPass <= other.LastPass &&
+          other.FirstPass <= resource.LastPass) {
+        throw std::runtime_error("Aliased render graph resources " +
+                                 resource.Name + " and " + other.Name +
+                                 " are alive at the same time!");
+      }
+    }
+  }
+}
+
+bool RenderGraph::MatchesCompiled() const {
+  if (m_Passes.size() != m_CompiledPasses.size() ||
+      m_Resources.size() != m_CompiledResources.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < m_Passes.size(); i++) {
+    const Pass& pass = m_Passes[i];
+    const Pass& compiled = m_CompiledPasses[i];
+    if (pass.Enabled != compiled.Enabled ||
+        pass.Accesses != compiled.Accesses) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < m_Resources.size(); i++) {
+    const Resource& resource = m_Resources[i];
+    const Resource& compiled = m_CompiledResources[i];
+    if (resource.Texture != compiled.Texture ||
+        resource.Buffer != compiled.Buffer ||
+        resource.RestingUsage != compiled.RestingUsage ||
+        resource.LayerCount != compiled.LayerCount ||
+        resource.IsOutput != compiled.IsOutput ||
+        resource.InitialState != compiled.InitialState) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void RenderGraph::Execute(const CommandBuffer& commandBuffer) {
+  if (!m_Compiled) {
+    Compile();
+  }
+  for (const auto& pass : m_Passes) {
+    if (pass.Culled) {
+      continue;
+    }
+    pass.Barriers.Record(commandBuffer);
+    pass.Fn();
+  }
+  m_FinalBarriers.Record(commandBuffer);
+}
+
+void RenderGraph::Reset() {
+  if (m_Compiled) {
+    m_CompiledPasses = std::move(m_Passes);
+    m_CompiledResources = std::move(m_Resources);
+  } else {
+    m_CompiledPasses.clear();
+    m_CompiledResources.clear();
+    m_FinalBarriers.Clear();
+  }
+  m_Passes.clear();
+  m_Resources.clear();
+  m_Compiled = false;
+}
+
+std::vector<RenderGraphAliasSlot> RenderGraph::PlanAliasing() const {
+  std::vector<RenderGraphResourceId> candidates;
+  for (RenderGraphResourceId i = 0; i < m_Resources.size(); i++) {
+    if (m_Resources[i].IsTransient) {
+      candidates.push_back(i);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [this](RenderGraphResourceId a, RenderGraphResourceId b) {
+              return m_Resources[a].FirstPass < m_Resources[b].FirstPass;
+            });
+
+  VkDevice device = Engine::GetRenderer()->GetLogicalDevice();
+  std::vector<RenderGraphAliasSlot> slots;
+  for (RenderGraphResourceId id : candidates) {
+    const Resource& resource = m_Resources[id];
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, resource.Texture->m_Images[0],
+                                 &requirements);
+
+    RenderGraphAliasSlot* target = nullptr;
+    for (auto& slot : slots) {
+      if (slot.LastPass < resource.FirstPass &&
+          (slot.MemoryTypeBits & requirements.memoryTypeBits) != 0) {
+        target = &slot;
+        break;
+      }
+    }
+    if (!target) {
+      target = &slots.emplace_back();
+    }
+    target->Size = std::max(target->Size, requirements.size);
+    target->Alignment = std::max(target->Alignment, requirements.alignment);
+    target->MemoryTypeBits &= requirements.memoryTypeBits;
+    target->LastPass = resource.LastPass;
+    target->Resources.push_back(id);
+  }
+  return slots;
+}
+
+void RenderGraph::Dump(std::ostream& stream) const {
+  stream << "[rendergraph] " << m_Passes.size() << " passes, "
+         << m_Resources.size() << " resources"
+         << (m_Compiled ? "" : " (not compiled)") << "\n";
+  for (uint32_t i = 0; i < m_Passes.size(); i++) {
+    const Pass& pass = m_Passes[i];
+    stream << "[rendergraph] pass " << i << " " << pass.Name;
+    if (pass.Culled) {
+      stream << (pass.Enabled ? " (culled)" : " (disabled)");
+    }
+    stream << "\n";
+    for (const auto& access : pass.Accesses) {
+      stream << "[rendergraph]   " << (access.Write ? "write " : "read  ")
+             << m_Resources[access.Resource].Name << " as "
+             << GetUsageName(access.Usage) << "\n";
+    }
+    if (!pass.Barriers.IsEmpty()) {
+      stream << "[rendergraph]   barrier batch: "
+             << pass.Barriers.GetImageBarrierCount() << " images, "
+             << pass.Barriers.GetBufferBarrierCount() << " buffers"
+             << (pass.Barriers.HasMemoryBarrier() ? " + memory" : "") << "\n";
+    }
+  }
+  if (!m_FinalBarriers.IsEmpty()) {
+    stream << "[rendergraph] final barrier batch: "
+           << m_FinalBarriers.GetImageBarrierCount() << " images\n";
+  }
+  for (const auto& resource : m_Resources) {
+    stream << "[rendergraph] resource " << resource.Name << " ";
+    if (resource.Buffer) {
+      stream << resource.Buffer->m_Size / 1024 << "KiB buffer";
+    } else {
+      stream << resource.Texture->m_Width << "x" << resource.Texture->m_Height;
+    }
+    if (resource.LayerCount > 1) {
+      stream << "x" << resource.LayerCount;
+    }
+    if (resource.FirstPass < 0) {
+      stream << " unused\n";
+      continue;
+    }
+    stream << " passes " << resource.FirstPass << "-" << resource.LastPass
+           << (resource.IsOutput ? " output" : "")
+           << (resource.IsTransient ? " transient" : "")
+           << (resource.Texture && resource.Texture->m_AliasedMemory
+                   ? " aliased"
+                   : "")
+           << "\n";
+  }
+  if (!m_Compiled) {
+    return;
+  }
+  VkDeviceSize separate = 0;
+  VkDeviceSize aliased = 0;
+  std::vector<RenderGraphAliasSlot> slots = PlanAliasing();
+  VkDevice device = Engine::GetRenderer()->GetLogicalDevice();
+  for (uint32_t i = 0; i < slots.size(); i++) {
+    stream << "[rendergraph] alias slot " << i << ":";
+    for (RenderGraphResourceId id : slots[i].Resources) {
+      VkMemoryRequirements requirements;
+      vkGetImageMemoryRequirements(device, m_Resources[id].Texture->m_Images[0],
+                                   &requirements);
+      separate += requirements.size;
+      stream << " " << m_Resources[id].Name;
+    }
+    aliased += slots[i].Size;
+    stream << "\n";
+  }
+  stream << "[rendergraph] transient memory: " << separate / 1024 << "KiB, "
+         << aliased / 1024 << "KiB when aliased\n";
+}
+
+uint32_t RenderGraph::GetBarrierBatchCount() const {
+  uint32_t count = m_FinalBarriers.IsEmpty() ? 0 : 1;
+  for (const auto& pass : m_Passes) {
+    if (!pass.Culled && !pass.Barriers.IsEmpty()) {
+      count++;
+    }
+  }
+  return count;
+}
+
+}  // namespace Wiesel
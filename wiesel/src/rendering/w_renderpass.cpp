@@ -65,12 +65,14 @@ void RenderPass::Bake() {
       descriptions.push_back({
           .format = item.Format,
           .samples = item.MsaaSamples,
-          .loadOp = m_PassType == PassType::Lighting ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
-          .storeOp = m_PassType == PassType::Geometry || m_PassType == PassType::Shadow ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+          .loadOp = m_PassType == PassType::Lighting || item.Load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
+          .storeOp = !item.Transient && (m_PassType == PassType::Geometry || m_PassType == PassType::Shadow) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
           .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
           .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-          .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-          .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+          .initialLayout = item.Load ? item.FinalLayout : VK_IMAGE_LAYOUT_UNDEFINED,
+          .finalLayout = item.FinalLayout != VK_IMAGE_LAYOUT_UNDEFINED
+                             ? item.FinalLayout
+                             : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
       });
       depthAttachmentRefs.push_back({
           .attachment = index,
@@ -82,11 +84,15 @@ void RenderPass::Bake() {
           .format = item.Format,
           .samples = item.MsaaSamples,
           .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-          .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+          .storeOp = item.Transient ? VK_ATTACHMENT_STORE_OP_DONT_CARE
+                                    : VK_ATTACHMENT_STORE_OP_STORE,
           .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
           .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-          .initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-          .finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+          // Cleared on load, the previous contents don't matter.
+          .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+          .finalLayout = item.FinalLayout != VK_IMAGE_LAYOUT_UNDEFINED
+                             ? item.FinalLayout
+                             : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
       });
       colorAttachmentRefs.push_back({
           .attachment = index,
@@ -102,7 +108,9 @@ void RenderPass::Bake() {
           .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
           .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
           .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-          .finalLayout = m_PassType == PassType::Present ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+          .finalLayout = m_PassType == PassType::Present ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+                         : item.FinalLayout != VK_IMAGE_LAYOUT_UNDEFINED ? item.FinalLayout
+                                                                         : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
       });
       resolveAttachmentRefs.push_back({
           .attachment = index,
@@ -215,7 +223,8 @@ void RenderPass::Bake() {
   }
 }
 
-void RenderPass::Begin(Ref<Framebuffer> framebuffer, const Colorf& clearColor) {
+void RenderPass::Begin(Ref<Framebuffer> framebuffer, const Colorf& clearColor,
+                       VkSubpassContents contents) {
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   renderPassInfo.renderPass = m_RenderPass;
@@ -240,7 +249,7 @@ void RenderPass::Begin(Ref<Framebuffer> framebuffer, const Colorf& clearColor) {
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
   vkCmdBeginRenderPass(Engine::GetRenderer()->GetCommandBuffer().m_Handle, &renderPassInfo,
-                       VK_SUBPASS_CONTENTS_INLINE);
+                       contents);
 }
 
 void RenderPass::End() {
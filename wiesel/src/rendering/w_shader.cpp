@@ -22,6 +22,8 @@ VkShaderStageFlagBits GetShaderFlagBitsByType(ShaderType type) {
       return VK_SHADER_STAGE_VERTEX_BIT;
     case ShaderTypeFragment:
       return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case ShaderTypeCompute:
+      return VK_SHADER_STAGE_COMPUTE_BIT;
     default:
       // Invalid
       return VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM;
@@ -31,8 +33,7 @@ VkShaderStageFlagBits GetShaderFlagBitsByType(ShaderType type) {
 Shader::Shader(ShaderProperties properties) : m_Properties(properties) {
   std::vector<uint32_t> code{};
   if (m_Properties.Source == ShaderSourceSource) {
-    auto file = ReadFile(m_Properties.Path);
-    if (!Spirv::ShaderToSPV(m_Properties.Type, file, code)) {
+    if (!Spirv::CompileShader(m_Properties.Type, m_Properties.Path, code)) {
       throw std::runtime_error("Failed to compile shader!");
     }
   } else if (m_Properties.Source == ShaderSourcePrecompiled) {
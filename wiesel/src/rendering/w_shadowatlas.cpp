@@ -0,0 +1,245 @@
+//
+//    Copyright 2023 Metehan Gezer
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "rendering/w_shadowatlas.hpp"
+
+namespace Wiesel {
+
+constexpr float kPointShadowNearPlane = 0.05f;
+// Lights that don't attenuate would get an unusable depth range.
+constexpr float kMaxPointShadowDistance = 100.0f;
+
+// Position of the code'th tile along a Z-order curve.
+static glm::uvec2 DecodeMorton(uint32_t code) {
+  glm::uvec2 result{0};
+  for (uint32_t bit = 0; bit < 16; bit++) {
+    result.x |= ((code >> (2 * bit)) & 1u) << bit;
+    result.y |= ((code >> (2 * bit + 1)) & 1u) << bit;
+  }
+  return result;
+}
+
+static float GetFaceFarPlane(float radius) {
+  return std::clamp(radius, kPointShadowNearPlane * 2.0f,
+                    kMaxPointShadowDistance);
+}
+
+static glm::mat4 GetFaceViewProjection(const glm::vec3& position, float radius,
+                                       uint32_t face) {
+  static const glm::vec3 kDirections[6] = {
+      {1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
+      {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}};
+  static const glm::vec3 kUps[6] = {
+      {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f},
+      {0.0f, 0.0f, -1.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}};
+  float farPlane = GetFaceFarPlane(radius);
+  glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f,
+                                          kPointShadowNearPlane, farPlane);
+  projection[1][1] *= -1;
+  return projection *
+         glm::lookAt(position, position + kDirections[face], kUps[face]);
+}
+
+void ShadowAtlas::Reset(uint32_t resolution) {
+  m_Resolution = resolution;
+  m_MaxTileSize = resolution / 4;
+  m_MinTileSize = std::max(resolution / 64, 16u);
+  m_Entries.clear();
+  m_FaceUpdates.clear();
+  m_ShadowData = {};
+}
+
+void ShadowAtlas::Update(std::vector<PointShadowRequest> requests,
+                         uint32_t budget) {
+  m_Frame++;
+  m_FaceUpdates.clear();
+  if (m_Resolution == 0) {
+    return;
+  }
+  std::sort(requests.begin(), requests.end(),
+            [](const PointShadowRequest& a, const PointShadowRequest& b) {
+              return a.Importance > b.Importance;
+            });
+  if (requests.size() > WIESEL_MAX_POINT_SHADOWS) {
+    requests.resize(WIESEL_MAX_POINT_SHADOWS);
+  }
+
+  std::vector<Entry> entries;
+  entries.reserve(requests.size());
+  for (const auto& request : requests) {
+    auto it = std::find_if(m_Entries.begin(), m_Entries.end(),
+                           [&request](const Entry& entry) {
+                             return entry.LightId == request.LightId;
+                           });
+    Entry entry =
+        it != m_Entries.end() ? *it : Entry{.LightId = request.LightId};
+    uint32_t tileSize = GetTileSize(request.Importance);
+    // Grow right away but only shrink when it's well below the current size,
+    // so tiles don't flip between two sizes and get redrawn every frame.
+    if (tileSize > entry.TileSize || tileSize * 2 < entry.TileSize) {
+      entry.TileSize = tileSize;
+    }
+    if (entry.Position != request.Position || entry.Radius != request.Radius) {
+      for (Face& face : entry.Faces) {
+        face.IsStale = true;
+      }
+    }
+    entry.Position = request.Position;
+    entry.Radius = request.Radius;
+    entry.Importance = request.Importance;
+    entries.push_back(entry);
+  }
+  m_Entries = std::move(entries);
+
+  Pack();
+  ScheduleFaces(budget);
+  UpdateShadowData();
+}
+
+void ShadowAtlas::ClearFaceUpdates() {
+  m_FaceUpdates.clear();
+}
+
+int32_t ShadowAtlas::GetShadowIndex(uint32_t lightId) const {
+  for (size_t i = 0; i < m_Entries.size(); i++) {
+    const Entry& entry = m_Entries[i];
+    if (entry.LightId != lightId) {
+      continue;
+    }
+    for (const Face& face : entry.Faces) {
+      if (!face.IsValid) {
+        return -1;
+      }
+    }
+    return static_cast<int32_t>(i);
+  }
+  return -1;
+}
+
+uint32_t ShadowAtlas::GetTileSize(float importance) const {
+  float size = importance * static_cast<float>(m_MaxTileSize);
+  uint32_t tileSize = m_MinTileSize;
+  while (tileSize < m_MaxTileSize && static_cast<float>(tileSize) < size) {
+    tileSize *= 2;
+  }
+  return tileSize;
+}
+
+void ShadowAtlas::Pack() {
+  auto usedArea = [this]() {
+    uint64_t area = 0;
+    for (const Entry& entry : m_Entries) {
+      area += 6ull * entry.TileSize * entry.TileSize;
+    }
+    return area;
+  };
+  // The least important lights give up resolution first, then their shadow.
+  uint64_t atlasArea = static_cast<uint64_t>(m_Resolution) * m_Resolution;
+  for (auto it = m_Entries.rbegin();
+       it != m_Entries.rend() && usedArea() > atlasArea;) {
+    if (it->TileSize > m_MinTileSize) {
+      it->TileSize /= 2;
+    } else {
+      ++it;
+    }
+  }
+  while (usedArea() > atlasArea) {
+    m_Entries.pop_back();
+  }
+
+  // Tile sizes are power of two multiples of the smallest tile. Placing the
+  // biggest ones first along a Z-order curve keeps every tile aligned to its
+  // own size, so they never overlap. Ties are broken by the light so the
+  // layout only changes when the tiles do.
+  std::vector<Entry*> order;
+  order.reserve(m_Entries.size());
+  for (Entry& entry : m_Entries) {
+    order.push_back(&entry);
+  }
+  std::sort(order.begin(), order.end(), [](const Entry* a, const Entry* b) {
+    if (a->TileSize != b->TileSize) {
+      return a->TileSize > b->TileSize;
+    }
+    return a->LightId < b->LightId;
+  });
+  uint32_t cursor = 0;
+  for (Entry* entry : order) {
+    uint32_t units = entry->TileSize / m_MinTileSize;
+    for (Face& face : entry->Faces) {
+      glm::uvec2 offset = DecodeMorton(cursor) * m_MinTileSize;
+      if (face.Offset != offset || face.Size != entry->TileSize) {
+        face.IsValid = false;
+      }
+      face.Offset = offset;
+      face.Size = entry->TileSize;
+      cursor += units * units;
+    }
+  }
+}
+
+void ShadowAtlas::ScheduleFaces(uint32_t budget) {
+  struct Candidate {
+    uint32_t EntryIndex;
+    uint32_t FaceIndex;
+    // Faces that were never drawn keep their light unshadowed so they go
+    // first, then the faces of lights that moved, then the ones drawn the
+    // longest time ago so the shadows of moving casters catch up.
+    uint32_t Priority;
+    uint64_t LastDrawnFrame;
+  };
+  std::vector<Candidate> candidates;
+  candidates.reserve(m_Entries.size() * 6);
+  for (uint32_t i = 0; i < m_Entries.size(); i++) {
+    for (uint32_t f = 0; f < 6; f++) {
+      const Face& face = m_Entries[i].Faces[f];
+      uint32_t priority = !face.IsValid ? 0 : face.IsStale ? 1 : 2;
+      candidates.push_back({i, f, priority, face.LastDrawnFrame});
+    }
+  }
+  // Entries are ordered by importance, a stable sort keeps that order within
+  // a priority.
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate& a, const Candidate& b) {
+                     if (a.Priority != b.Priority) {
+                       return a.Priority < b.Priority;
+                     }
+                     return a.Priority == 2 &&
+                            a.LastDrawnFrame < b.LastDrawnFrame;
+                   });
+
+  size_t count = std::min<size_t>(budget, candidates.size());
+  for (size_t i = 0; i < count; i++) {
+    Entry& entry = m_Entries[candidates[i].EntryIndex];
+    Face& face = entry.Faces[candidates[i].FaceIndex];
+    face.ViewProjection = GetFaceViewProjection(entry.Position, entry.Radius,
+                                                candidates[i].FaceIndex);
+    face.IsValid = true;
+    face.IsStale = false;
+    face.LastDrawnFrame = m_Frame;
+    m_FaceUpdates.push_back({face.Offset, face.Size, face.ViewProjection,
+                             entry.Position, GetFaceFarPlane(entry.Radius)});
+  }
+}
+
+void ShadowAtlas::UpdateShadowData() {
+  float texelSize = 1.0f / static_cast<float>(m_Resolution);
+  for (size_t i = 0; i < m_Entries.size(); i++) {
+    PointShadowData& data = m_ShadowData.Shadows[i];
+    for (uint32_t f = 0; f < 6; f++) {
+      const Face& face = m_Entries[i].Faces[f];
+      // Faces keep the matrix they were drawn with until they are redrawn.
+      data.ViewProjection[f] = face.ViewProjection;
+      data.AtlasRects[f] =
+          glm::vec4(glm::vec2(face.Offset), glm::vec2(face.Size)) * texelSize;
+    }
+  }
+}
+
+}  // namespace Wiesel
@@ -32,6 +32,10 @@ AttachmentTexture::~AttachmentTexture() {
   Engine::GetRenderer()->DestroyAttachmentTexture(*this);
 }
 
+AliasedMemory::~AliasedMemory() {
+  vkFreeMemory(Engine::GetRenderer()->GetLogicalDevice(), m_Handle, nullptr);
+}
+
 ImageView::~ImageView() {
   vkDestroyImageView(Engine::GetRenderer()->GetLogicalDevice(), m_Handle, nullptr);
 }
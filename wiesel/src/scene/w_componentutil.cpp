@@ -72,6 +72,7 @@ void RenderComponentImGui(ModelComponent& component, Entity entity) {
           });
     }
     ImGui::Checkbox("Receive Shadows", &model.Data.ReceiveShadows);
+    ImGui::Checkbox("Static", &model.Data.IsStatic);
     ImGui::TreePop();
   }
   if (!visible) {
@@ -122,6 +123,8 @@ void RenderComponentImGui(LightPointComponent& component, Entity entity) {
                        &component.LightData.Exp, 0.1f);
       ImGui::TreePop();
     }
+    ImGui::Checkbox(PrefixLabel("Cast Shadows").c_str(),
+                    &component.CastShadows);
     ImGui::ColorPicker3(
         "Color", reinterpret_cast<float*>(&component.LightData.Base.Color));
     ImGui::TreePop();
@@ -146,6 +149,20 @@ void RenderComponentImGui(CameraComponent& component, Entity entity) {
       component.IsViewChanged = true;
     }
 
+    if (ImGui::TreeNode("VRAM")) {
+      AttachmentMemoryReport report =
+          Engine::GetRenderer()->GetAttachmentMemoryReport(component);
+      ImGui::Text("Attachments: %u", report.AttachmentCount);
+      ImGui::Text("Requested: %.1f MiB", report.Requested / 1048576.0);
+      ImGui::Text("Allocated: %.1f MiB", report.Allocated / 1048576.0);
+      ImGui::Text("Lazily allocated: %.1f MiB (%.1f MiB committed)",
+                  report.LazilyAllocated / 1048576.0,
+                  report.LazilyCommitted / 1048576.0);
+      ImGui::Text("Saved by aliasing: %.1f MiB",
+                  report.AliasingSaved / 1048576.0);
+      ImGui::TreePop();
+    }
+
     ImGui::TreePop();
   }
   if (!visible) {
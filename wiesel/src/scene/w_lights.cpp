@@ -20,8 +20,31 @@ glm::vec3 EulerToDirection(glm::vec3 euler) {
       glm::vec3(cos(pitch) * sin(yaw), sin(pitch), cos(pitch) * cos(yaw)));
 }
 
+// Solves constant + linear * d + exp * d^2 = 256 * intensity for d.
+float CalculateLightRadius(const LightPoint& light) {
+  const LightBase& base = light.Base;
+  float intensity = std::max({base.Color.r, base.Color.g, base.Color.b}) *
+                    base.Density *
+                    (base.Ambient + base.Diffuse + base.Specular);
+  float threshold = 256.0f * intensity;
+  if (light.Exp > 0.0f) {
+    float discriminant = light.Linear * light.Linear -
+                         4.0f * light.Exp * (light.Constant - threshold);
+    return (-light.Linear + std::sqrt(std::max(discriminant, 0.0f))) /
+           (2.0f * light.Exp);
+  }
+  if (light.Linear > 0.0f) {
+    return std::max((threshold - light.Constant) / light.Linear, 0.0f);
+  }
+  // Doesn't attenuate, reaches every cluster.
+  return std::numeric_limits<float>::max();
+}
+
 void UpdateLight(LightsUniformData& lights, const LightDirect& light,
                  const TransformComponent& transform) {
+  if (lights.DirectLightCount >= MAX_LIGHTS) {
+    return;
+  }
   // world position is the 4th column
   glm::vec3 worldPos = glm::vec3(transform.TransformMatrix[3]);
 
@@ -38,8 +61,11 @@ void UpdateLight(LightsUniformData& lights, const LightDirect& light,
   dst.Base.Density                 = light.Base.Density;
 }
 
-void UpdateLight(LightsUniformData& lights, const LightPoint& light,
+void UpdateLight(PointLightsStorageData& lights, const LightPoint& light,
                  const TransformComponent& transform) {
+  if (lights.PointLightCount >= MAX_POINT_LIGHTS) {
+    return;
+  }
   glm::vec3 worldPos = glm::vec3(transform.TransformMatrix[3]);
 
   LightPoint& dst = lights.PointLights[lights.PointLightCount++];
@@ -52,6 +78,8 @@ void UpdateLight(LightsUniformData& lights, const LightPoint& light,
   dst.Constant      = light.Constant;
   dst.Linear        = light.Linear;
   dst.Exp           = light.Exp;
+  dst.Radius        = CalculateLightRadius(light);
+  dst.ShadowIndex   = -1;
 }
 
 }  // namespace Wiesel
\ No newline at end of file
@@ -14,15 +14,19 @@
 #include "behavior/w_behavior.hpp"
 #include "rendering/w_renderer.hpp"
 #include "scene/w_entity.hpp"
+#include "script/w_scriptmanager.hpp"
 #include "w_engine.hpp"
 
 namespace Wiesel {
 
 Scene::Scene() {
   m_CurrentCamera = CreateReference<CameraData>();
+  BuildUpdateGraph();
 }
 
-Scene::~Scene() {}
+Scene::~Scene() {
+  ScriptManager::RemoveScene(this);
+}
 
 Entity Scene::CreateEntity(const std::string& name) {
   return CreateEntityWithUUID(UUID(), name);
@@ -40,6 +44,7 @@ Entity Scene::CreateEntityWithUUID(UUID uuid, const std::string& name) {
 }
 
 void Scene::DestroyEntity(Entity entity) {
+  ScriptManager::RemoveEntityWrappers(this, entity);
   m_Entities.erase(entity.GetUUID());
   m_Registry.destroy(entity);
   m_SceneHierarchy.erase(std::remove_if(m_SceneHierarchy.begin(), m_SceneHierarchy.end(), [&](auto& e) {
@@ -47,70 +52,217 @@ void Scene::DestroyEntity(Entity entity) {
   }));
 }
 
+void Scene::FixedUpdate(float_t timeStep) {
+  WIESEL_PROFILE_SCOPE("Scene::FixedUpdate");
+  for (const auto& entity : m_Registry.view<TransformComponent>()) {
+    auto& transform = m_Registry.get<TransformComponent>(entity);
+    transform.PreviousPosition = transform.Position;
+    transform.PreviousRotation = transform.Rotation;
+    transform.PreviousScale = transform.Scale;
+  }
+  for (const auto& entity : m_Registry.view<BehaviorsComponent>()) {
+    auto& component = m_Registry.get<BehaviorsComponent>(entity);
+    for (const auto& entry : component.m_Behaviors) {
+      if (entry.second->IsInternalBehavior() && entry.second->IsEnabled()) {
+        entry.second->OnFixedUpdate(timeStep);
+      }
+    }
+  }
+  ScriptManager::FixedUpdateScripts(this, timeStep);
+}
+
+void Scene::UpdateInterpolation() {
+  // Each entity only touches its own transform. The list is gathered again
+  // before the update graph, scripts may still add entities.
+  auto transforms = m_Registry.view<TransformComponent>();
+  m_UpdateTransformEntities.assign(transforms.begin(), transforms.end());
+  JobSystem::ParallelFor(
+      "Scene::UpdateInterpolation (chunk)",
+      static_cast<uint32_t>(m_UpdateTransformEntities.size()), 64,
+      [this](uint32_t index) {
+        entt::entity entity = m_UpdateTransformEntities[index];
+        auto& transform = m_Registry.get<TransformComponent>(entity);
+        bool moved = transform.Position != transform.PreviousPosition ||
+                     transform.Rotation != transform.PreviousRotation ||
+                     transform.Scale != transform.PreviousScale;
+        if (!moved && transform.IsInterpolated) {
+          // Settle on the final state.
+          transform.IsChanged = true;
+        }
+        transform.IsInterpolated = moved;
+      });
+}
+
+void Scene::RemoveScriptWrapper(entt::entity entity, std::type_index type) {
+  ScriptManager::RemoveComponentWrapper(this, entity, type);
+}
+
 void Scene::OnUpdate(float_t deltaTime) {
+  // Behaviors call into mono and may touch any component, they stay on the
+  // main thread and run before the rest of the update.
   if (!m_FirstUpdate) [[likely]] {
+    m_FixedTimeAccumulator += deltaTime;
+    uint32_t steps = 0;
+    while (m_FixedTimeAccumulator >= m_FixedTimeStep &&
+           steps < m_MaxFixedSteps) {
+      FixedUpdate(m_FixedTimeStep);
+      m_FixedTimeAccumulator -= m_FixedTimeStep;
+      steps++;
+    }
+    if (m_FixedTimeAccumulator >= m_FixedTimeStep) {
+      m_FixedTimeAccumulator =
+          std::fmod(m_FixedTimeAccumulator, m_FixedTimeStep);
+    }
+    m_FixedAlpha = m_FixedTimeAccumulator / m_FixedTimeStep;
+    if (steps > 0) {
+      UpdateInterpolation();
+    }
+
     for (const auto& entity : m_Registry.view<BehaviorsComponent>()) {
       auto& component = m_Registry.get<BehaviorsComponent>(entity);
       for (const auto& entry : component.m_Behaviors) {
-        entry.second->OnUpdate(deltaTime);
+        if (entry.second->IsInternalBehavior()) {
+          entry.second->OnUpdate(deltaTime);
+        }
       }
     }
+    if (m_PendingMouseMove) {
+      ScriptManager::DispatchEvent(this, *m_PendingMouseMove);
+      m_PendingMouseMove.reset();
+    }
+    ScriptManager::UpdateScripts(this, deltaTime);
   } else {
     m_FirstUpdate = false;
   }
 
-  for (const auto& entity : m_Registry.view<TransformComponent>()) {
-    auto& transform = m_Registry.get<TransformComponent>(entity);
-    if (transform.IsChanged) {
-      UpdateMatrices(entity);
-      transform.IsChanged = false;
-      // todo this is a bit hacky
-      // set the camera as changed if transform has changed
-      if (m_Registry.any_of<CameraComponent>(entity)) {
-        auto& camera = m_Registry.get<CameraComponent>(entity);
-        camera.IsPosChanged = true;
-      }
-    }
-  }
+  auto transforms = m_Registry.view<TransformComponent>();
+  m_UpdateTransformEntities.assign(transforms.begin(), transforms.end());
+  auto directLights = m_Registry.view<LightDirectComponent>();
+  m_UpdateDirectLightEntities.assign(directLights.begin(), directLights.end());
+  auto pointLights = m_Registry.view<LightPointComponent>();
+  m_UpdatePointLightEntities.assign(pointLights.begin(), pointLights.end());
+  auto cameras = m_Registry.view<CameraComponent, TransformComponent>();
+  m_UpdateCameraEntities.assign(cameras.begin(), cameras.end());
+  // Looked up with try_get from the jobs, which would create the pool there.
+  m_Registry.storage<TreeComponent>();
+  m_Registry.storage<CameraComponent>();
+  m_Registry.storage<ModelComponent>();
+
+  m_UpdateGraph.Execute();
+}
+
+void Scene::BuildUpdateGraph() {
+  // transforms -> direct lights -> cascades
+  //            -> point lights
+  //            -> cameras       -> cascades
+  auto transforms = m_UpdateGraph.AddTask(
+      "Scene::UpdateTransforms", WIESEL_BIND_FN(UpdateTransforms));
+  auto directLights = m_UpdateGraph.AddTask(
+      "Scene::UpdateDirectLights", WIESEL_BIND_FN(UpdateDirectLights));
+  auto pointLights = m_UpdateGraph.AddTask(
+      "Scene::UpdatePointLights", WIESEL_BIND_FN(UpdatePointLights));
+  auto cameras = m_UpdateGraph.AddTask("Scene::UpdateCameras",
+                                       WIESEL_BIND_FN(UpdateCameras));
+  auto cascades = m_UpdateGraph.AddTask("Scene::UpdateCascades",
+                                        WIESEL_BIND_FN(UpdateCascades));
+  m_UpdateGraph.AddDependency(transforms, directLights);
+  m_UpdateGraph.AddDependency(transforms, pointLights);
+  m_UpdateGraph.AddDependency(transforms, cameras);
+  m_UpdateGraph.AddDependency(directLights, cascades);
+  m_UpdateGraph.AddDependency(cameras, cascades);
+}
+
+void Scene::UpdateTransforms() {
+  // Each entity only writes its own matrices, parents are only read through
+  // their local transform, so the loop can be split between workers.
+  JobSystem::ParallelFor(
+      "Scene::UpdateTransforms (chunk)",
+      static_cast<uint32_t>(m_UpdateTransformEntities.size()), 64,
+      [this](uint32_t index) {
+        entt::entity entity = m_UpdateTransformEntities[index];
+        auto& transform = m_Registry.get<TransformComponent>(entity);
+        // Interpolated transforms move every frame, the alpha changes.
+        if (!transform.IsChanged && !transform.IsInterpolated) {
+          return;
+        }
+        UpdateMatrices(entity);
+        transform.IsChanged = false;
+        // todo this is a bit hacky
+        // set the camera as changed if transform has changed
+        if (auto* camera = m_Registry.try_get<CameraComponent>(entity)) {
+          camera->IsPosChanged = true;
+        }
+        if (auto* model = m_Registry.try_get<ModelComponent>(entity);
+            model && model->Data.IsStatic) {
+          m_StaticShadowsChanged = true;
+        }
+      });
+}
+
+void Scene::UpdateDirectLights() {
   auto& lights = Engine::GetRenderer()->m_LightsUniformData;
   lights.DirectLightCount = 0;
-  lights.PointLightCount = 0;
-  for (const auto& entity : m_Registry.view<LightDirectComponent>()) {
+  for (const auto& entity : m_UpdateDirectLightEntities) {
     auto& light = m_Registry.get<LightDirectComponent>(entity);
     auto& transform = m_Registry.get<TransformComponent>(entity);
     UpdateLight(lights, light.LightData, transform);
   }
-  for (const auto& entity : m_Registry.view<LightPointComponent>()) {
+}
+
+void Scene::UpdatePointLights() {
+  auto& lights = Engine::GetRenderer()->m_PointLightsStorageData;
+  lights.PointLightCount = 0;
+  for (const auto& entity : m_UpdatePointLightEntities) {
     auto& light = m_Registry.get<LightPointComponent>(entity);
     auto& transform = m_Registry.get<TransformComponent>(entity);
     UpdateLight(lights, light.LightData, transform);
   }
+}
 
-  for (const auto& entity :
-       m_Registry.view<CameraComponent, TransformComponent>()) {
-    auto& camera = m_Registry.get<CameraComponent>(entity);
-    auto& transform = m_Registry.get<TransformComponent>(entity);
-    if (!camera.IsEnabled) {
-      continue;
-    }
-    if (camera.IsViewChanged) {
-      camera.UpdateProjection();
-      camera.IsViewChanged = false;
-    }
-    if (camera.IsPosChanged) {
-      camera.UpdateView(transform.TransformMatrix);
-      camera.IsPosChanged = false;
-    }
-    if (camera.IsAnyChanged) {
-      camera.UpdateAll();
-      camera.IsAnyChanged = false;
-    }
-    if (lights.DirectLightCount > 0) {
-      camera.ComputeCascades(glm::normalize(lights.DirectLights[0].Direction));
-    } else {
-      camera.DoesShadowPass = false;
-    }
-  }
+void Scene::UpdateCameras() {
+  JobSystem::ParallelFor(
+      "Scene::UpdateCameras (chunk)",
+      static_cast<uint32_t>(m_UpdateCameraEntities.size()), 1,
+      [this](uint32_t index) {
+        entt::entity entity = m_UpdateCameraEntities[index];
+        auto& camera = m_Registry.get<CameraComponent>(entity);
+        auto& transform = m_Registry.get<TransformComponent>(entity);
+        if (!camera.IsEnabled) {
+          return;
+        }
+        if (camera.IsViewChanged) {
+          camera.UpdateProjection();
+          camera.IsViewChanged = false;
+        }
+        if (camera.IsPosChanged) {
+          camera.UpdateView(transform.TransformMatrix);
+          camera.IsPosChanged = false;
+        }
+        if (camera.IsAnyChanged) {
+          camera.UpdateAll();
+          camera.IsAnyChanged = false;
+        }
+      });
+}
+
+void Scene::UpdateCascades() {
+  auto& lights = Engine::GetRenderer()->m_LightsUniformData;
+  JobSystem::ParallelFor(
+      "Scene::UpdateCascades (chunk)",
+      static_cast<uint32_t>(m_UpdateCameraEntities.size()), 1,
+      [this, &lights](uint32_t index) {
+        auto& camera =
+            m_Registry.get<CameraComponent>(m_UpdateCameraEntities[index]);
+        if (!camera.IsEnabled) {
+          return;
+        }
+        if (lights.DirectLightCount > 0) {
+          camera.ComputeCascades(
+              glm::normalize(lights.DirectLights[0].Direction));
+        } else {
+          camera.DoesShadowPass = false;
+        }
+      });
 }
 
 void Scene::OnEvent(Event& event) {
@@ -121,6 +273,12 @@ void Scene::OnEvent(Event& event) {
     auto& component = m_Registry.get<BehaviorsComponent>(entity);
     component.OnEvent(event);
   }
+  // Scripts only see where the mouse ended up in a frame, not every step.
+  if (event.GetEventType() == EventType::MouseMoved) {
+    m_PendingMouseMove = static_cast<MouseMovedEvent&>(event);
+    return;
+  }
+  ScriptManager::DispatchEvent(this, event);
 }
 
 void Scene::LinkEntities(entt::entity parent, entt::entity child) {
@@ -184,12 +342,21 @@ bool Scene::OnWindowResizeEvent(WindowResizeEvent& event) {
 }
 
 glm::mat4 Scene::MakeLocal(const Wiesel::TransformComponent& t) {
-  glm::vec3 rotRad = glm::radians(t.Rotation);
-  glm::mat4 R      = glm::toMat4(glm::quat(rotRad));
-  glm::mat4 T      = glm::translate(glm::mat4(1.0f), t.Position);
+  glm::vec3 position = t.Position;
+  glm::quat rotation = glm::quat(glm::radians(t.Rotation));
+  glm::vec3 scale = t.Scale;
+  if (t.IsInterpolated) {
+    position = glm::mix(t.PreviousPosition, t.Position, m_FixedAlpha);
+    // Blending the angles would spin the long way round when one wraps.
+    rotation = glm::slerp(glm::quat(glm::radians(t.PreviousRotation)),
+                          rotation, m_FixedAlpha);
+    scale = glm::mix(t.PreviousScale, t.Scale, m_FixedAlpha);
+  }
+  glm::mat4 R      = glm::toMat4(rotation);
+  glm::mat4 T      = glm::translate(glm::mat4(1.0f), position);
   glm::mat4 Tp     = glm::translate(glm::mat4(1.0f), t.Pivot);
   glm::mat4 Tn     = glm::translate(glm::mat4(1.0f), -t.Pivot);
-  glm::mat4 S      = glm::scale(glm::mat4(1.0f), t.Scale);
+  glm::mat4 S      = glm::scale(glm::mat4(1.0f), scale);
 
   // move to Position, shift to Pivot, rotate+scale, shift back
   return T * Tp * R * S * Tn;
@@ -212,81 +379,386 @@ void Scene::UpdateMatrices(entt::entity entity) {
   tc.NormalMatrix    = glm::inverseTranspose(glm::mat3(tc.TransformMatrix));
 }
 
+void Scene::GatherRenderModels() {
+  // Resolve the components on the main thread, the recording jobs only read
+  // from this list.
+  m_RenderModels.clear();
+  size_t staticMeshCount = 0;
+  for (const auto& entity :
+       GetAllEntitiesWith<ModelComponent, TransformComponent>()) {
+    auto& model = m_Registry.get<ModelComponent>(entity);
+    m_RenderModels.emplace_back(&model,
+                                &m_Registry.get<TransformComponent>(entity));
+    if (model.Data.IsStatic) {
+      staticMeshCount += model.Data.Meshes.size();
+    }
+  }
+  // Catches static models being added, removed, loaded or toggled
+  if (staticMeshCount != m_StaticMeshCount) {
+    m_StaticMeshCount = staticMeshCount;
+    m_StaticShadowsChanged = true;
+  }
+}
+
+void Scene::UpdatePointShadows(Ref<Renderer> renderer) {
+  const CameraComponent* camera = nullptr;
+  glm::vec3 cameraPosition;
+  for (const auto& entity : GetAllEntitiesWith<CameraComponent>()) {
+    auto& component = m_Registry.get<CameraComponent>(entity);
+    if (component.IsEnabled) {
+      camera = &component;
+      cameraPosition = glm::vec3(
+          m_Registry.get<TransformComponent>(entity).TransformMatrix[3]);
+      break;
+    }
+  }
+  std::vector<PointShadowRequest> requests;
+  const auto& lights = renderer->m_PointLightsStorageData;
+  if (camera) {
+    float tanHalfFov = std::tan(glm::radians(camera->FieldOfView) * 0.5f);
+    glm::vec3 forward = -glm::vec3(camera->InvViewMatrix[2]);
+    // Lights were written to the buffer in the order of this list.
+    uint32_t lightCount = std::min(
+        static_cast<uint32_t>(m_UpdatePointLightEntities.size()),
+        lights.PointLightCount);
+    for (uint32_t i = 0; i < lightCount; i++) {
+      entt::entity entity = m_UpdatePointLightEntities[i];
+      if (!m_Registry.get<LightPointComponent>(entity).CastShadows) {
+        continue;
+      }
+      const LightPoint& light = lights.PointLights[i];
+      glm::vec3 toLight = light.Base.Position - cameraPosition;
+      // Can't light anything in front of the camera.
+      if (glm::dot(toLight, forward) < -light.Radius) {
+        continue;
+      }
+      // Share of the screen height the light's sphere covers.
+      float distance = glm::length(toLight);
+      float importance =
+          distance <= light.Radius
+              ? 1.0f
+              : std::min(light.Radius / (distance * tanHalfFov), 1.0f);
+      requests.push_back({static_cast<uint32_t>(entity), i,
+                          light.Base.Position, light.Radius, importance});
+    }
+  }
+  renderer->UpdatePointShadows(requests);
+}
+
+void Scene::RecordShadowPass(Ref<Renderer> renderer, bool staticCasters) {
+  WIESEL_PROFILE_SCOPE("Scene::RecordShadowPass");
+  if (renderer->IsParallelRecordingEnabled()) {
+    renderer->RecordShadowPasses(
+        static_cast<uint32_t>(m_RenderModels.size()), staticCasters,
+        [this, &renderer, staticCasters](const CommandBuffer& commandBuffer,
+                                         uint32_t begin, uint32_t end) {
+          for (uint32_t i = begin; i < end; i++) {
+            auto [model, transform] = m_RenderModels[i];
+            if (!model->Data.ReceiveShadows ||
+                model->Data.IsStatic != staticCasters) {
+              continue;
+            }
+            renderer->DrawModel(*model, *transform, true, commandBuffer);
+          }
+        });
+    return;
+  }
+  const CameraData& camera = *m_CurrentCamera;
+  for (uint32_t i = 0; i < camera.ShadowCascadeCount; ++i) {
+    if (staticCasters && !camera.ShadowMapCascades[i].IsStaticDirty) {
+      continue;
+    }
+    renderer->BeginShadowPass(i, staticCasters);
+    for (auto [model, transform] : m_RenderModels) {
+      if (!model->Data.ReceiveShadows ||
+          model->Data.IsStatic != staticCasters) {
+        continue;
+      }
+      renderer->DrawModel(*model, *transform, true);
+    }
+    renderer->EndShadowPass();
+  }
+}
+
+void Scene::RecordPointShadowPass(Ref<Renderer> renderer) {
+  WIESEL_PROFILE_SCOPE("Scene::RecordPointShadowPass");
+  renderer->RecordPointShadowPass(
+      [this, &renderer](const PointShadowFaceUpdate& update) {
+        // Only the meshes that reach into the face are drawn into its tile.
+        FrustumPlanes planes = FrustumPlanes::FromMatrix(update.ViewProjection);
+        for (auto [model, transform] : m_RenderModels) {
+          if (!model->Data.ReceiveShadows) {
+            continue;
+          }
+          const glm::mat4& matrix = transform->TransformMatrix;
+          float scale = std::max({glm::length(glm::vec3(matrix[0])),
+                                  glm::length(glm::vec3(matrix[1])),
+                                  glm::length(glm::vec3(matrix[2]))});
+          for (const auto& mesh : model->Data.Meshes) {
+            glm::vec3 center(matrix * glm::vec4(mesh->BoundsCenter, 1.0f));
+            float radius = mesh->BoundsRadius * scale;
+            if (glm::distance(center, update.LightPosition) >
+                    update.Range + radius ||
+                !planes.IntersectsSphere(center, radius)) {
+              continue;
+            }
+            renderer->DrawMesh(mesh, *transform, true);
+          }
+        }
+      });
+}
+
+void Scene::RecordGeometryPass(Ref<Renderer> renderer) {
+  WIESEL_PROFILE_SCOPE("Scene::RecordGeometryPass");
+  if (renderer->IsParallelRecordingEnabled()) {
+    renderer->RecordGeometryPass(
+        static_cast<uint32_t>(m_RenderModels.size()),
+        [this, &renderer](const CommandBuffer& commandBuffer, uint32_t begin,
+                          uint32_t end) {
+          for (uint32_t i = begin; i < end; i++) {
+            auto [model, transform] = m_RenderModels[i];
+            renderer->DrawModel(*model, *transform, false, commandBuffer);
+          }
+        });
+    return;
+  }
+  renderer->BeginGeometryPass();
+  for (auto [model, transform] : m_RenderModels) {
+    renderer->DrawModel(*model, *transform, false);
+  }
+  renderer->EndGeometryPass();
+}
+
+void Scene::BuildRenderGraph(Ref<Renderer> renderer, RenderGraph& graph) {
+  const CameraData& camera = *m_CurrentCamera;
+  graph.Reset();
+  // Every pass clears its outputs and leaves them ready to be sampled.
+  constexpr RenderGraphUsage kAttachment = RenderGraphUsage::ColorAttachment;
+  constexpr RenderGraphUsage kSampled = RenderGraphUsage::FragmentSampled;
+
+  auto depth =
+      graph.ImportTexture("GeometryDepth", camera.GeometryDepthResolveImage);
+  auto normal =
+      graph.ImportTexture("GeometryNormal", camera.GeometryNormalResolveImage);
+  auto albedo =
+      graph.ImportTexture("GeometryAlbedo", camera.GeometryAlbedoResolveImage);
+  auto material = graph.ImportTexture("GeometryMaterial",
+                                      camera.GeometryMaterialResolveImage);
+  auto ssaoNoise = graph.ImportTexture("SSAONoise", renderer->m_SSAONoise);
+  auto ssao = graph.ImportTexture("SSAO", camera.SSAOColorImage);
+  auto ssaoBlur = graph.ImportTexture("SSAOBlur", camera.SSAOBlurColorImage);
+  auto lighting =
+      graph.ImportTexture("Lighting", camera.LightingColorResolveImage);
+  auto sprite = graph.ImportTexture("Sprite", camera.SpriteColorImage);
+  auto composite =
+      graph.ImportTexture("Composite", camera.CompositeColorResolveImage);
+  graph.MarkOutput(composite);
+
+  // Static casters are cached in their own cascades and only redrawn for the
+  // dirty ones, dynamic casters are redrawn every frame. Lighting takes the
+  // closest of both.
+  std::optional<RenderGraphResourceId> shadowDepth;
+  std::optional<RenderGraphResourceId> shadowStaticDepth;
+  if (camera.ShadowDepthStencil) {
+    bool anyStaticDirty = false;
+    for (const Cascade& cascade : camera.ShadowMapCascades) {
+      anyStaticDirty |= cascade.IsStaticDirty;
+    }
+    shadowStaticDepth = graph.ImportTexture(
+        "ShadowStaticDepth", camera.ShadowStaticDepthStencil,
+        RenderGraphUsage::FragmentSampled, camera.ShadowCascadeCount);
+    graph
+        .AddPass("ShadowStatic",
+                 [this, renderer]() { RecordShadowPass(renderer, true); })
+        .Write(*shadowStaticDepth, RenderGraphUsage::DepthStencilAttachment,
+               kSampled)
+        .SetEnabled(camera.DoesShadowPass && anyStaticDirty);
+    shadowDepth = graph.ImportTexture(
+        "ShadowDepth", camera.ShadowDepthStencil,
+        RenderGraphUsage::FragmentSampled, camera.ShadowCascadeCount);
+    graph
+        .AddPass("Shadow",
+                 [this, renderer]() { RecordShadowPass(renderer, false); })
+        .Write(*shadowDepth, RenderGraphUsage::DepthStencilAttachment,
+               kSampled)
+        .SetEnabled(camera.DoesShadowPass);
+  }
+
+  // The atlas is shared by every camera, the tiles picked this frame are
+  // redrawn by the first one.
+  auto shadowAtlas =
+      graph.ImportTexture("ShadowAtlas", renderer->m_ShadowAtlasTexture);
+  graph
+      .AddPass("PointShadows",
+               [this, renderer]() { RecordPointShadowPass(renderer); })
+      .Write(shadowAtlas, RenderGraphUsage::DepthStencilAttachment, kSampled)
+      .SetEnabled(renderer->HasPointShadowUpdates());
+
+  graph
+      .AddPass("Geometry",
+               [this, renderer]() { RecordGeometryPass(renderer); })
+      .Write(depth, kAttachment, kSampled)
+      .Write(normal, kAttachment, kSampled)
+      .Write(albedo, kAttachment, kSampled)
+      .Write(material, kAttachment, kSampled);
+
+  // Ssao is computed and blurred at half resolution by compute shaders,
+  // lighting upsamples the result. Each blur transitions the image it reads
+  // and the one it stores to in a single barrier batch.
+  constexpr RenderGraphUsage kComputeSampled = RenderGraphUsage::ComputeSampled;
+  constexpr RenderGraphUsage kStorageImage =
+      RenderGraphUsage::ComputeStorageImage;
+  graph
+      .AddPass("SSAOGen", [renderer]() { renderer->DispatchSSAOGen(); })
+      .Read(depth, kComputeSampled)
+      .Read(normal, kComputeSampled)
+      .Read(ssaoNoise, kComputeSampled)
+      .Write(ssao, kStorageImage)
+      .SetEnabled(renderer->IsSSAOEnabled());
+  graph
+      .AddPass("SSAOBlurH",
+               [renderer]() { renderer->DispatchSSAOBlur(false); })
+      .Read(ssao, kComputeSampled)
+      .Read(depth, kComputeSampled)
+      .Write(ssaoBlur, kStorageImage)
+      .SetEnabled(renderer->IsSSAOEnabled());
+  // Lighting keeps sampling the last output when ssao is disabled, the shader
+  // ignores it.
+  graph
+      .AddPass("SSAOBlurV", [renderer]() { renderer->DispatchSSAOBlur(true); })
+      .Read(ssaoBlur, kComputeSampled)
+      .Read(depth, kComputeSampled)
+      .Write(ssao, kStorageImage)
+      .SetEnabled(renderer->IsSSAOEnabled());
+
+  auto lightClusters = graph.ImportBuffer(
+      "LightClusters", renderer->m_LightClustersStorageBuffer);
+  graph
+      .AddPass("LightCulling",
+               [renderer]() { renderer->DispatchLightCulling(); })
+      .Write(lightClusters, RenderGraphUsage::ComputeStorageWrite)
+      .SetEnabled(!renderer->IsLightVolumesEnabled());
+
+  auto lightingPass =
+      graph
+          .AddPass("Lighting",
+                   [this, renderer]() {
+                     renderer->BeginLightingPass();
+                     renderer->GetSkyboxPipeline()->Bind(
+                         PipelineBindPointGraphics);
+                     if (m_Skybox) {
+                       renderer->DrawSkybox(m_Skybox);
+                     }
+                     renderer->GetLightingPipeline()->Bind(
+                         PipelineBindPointGraphics);
+                     renderer->DrawFullscreen(
+                         renderer->GetLightingPipeline(),
+                         {renderer->GetCameraData()->GeometryOutputDescriptor,
+                          renderer->GetCameraData()->SSAOOutputDescriptor,
+                          renderer->GetCameraData()->GlobalDescriptor});
+                     if (renderer->IsLightVolumesEnabled()) {
+                       renderer->DrawPointLightVolumes();
+                     }
+                     renderer->EndLightingPass();
+                   })
+          .Read(depth)
+          .Read(normal)
+          .Read(albedo)
+          .Read(material)
+          .Read(ssao)
+          .Read(shadowAtlas)
+          .Read(lightClusters, RenderGraphUsage::FragmentStorageRead)
+          .Write(lighting, kAttachment, kSampled);
+  if (shadowDepth) {
+    lightingPass.Read(*shadowDepth);
+    lightingPass.Read(*shadowStaticDepth);
+  }
+
+  graph
+      .AddPass("Sprite",
+               [this, renderer]() {
+                 renderer->BeginSpritePass();
+                 renderer->GetSpritePipeline()->Bind(
+                     PipelineBindPointGraphics);
+                 for (const auto& entity :
+                      GetAllEntitiesWith<SpriteComponent,
+                                         TransformComponent>()) {
+                   auto& sprite = m_Registry.get<SpriteComponent>(entity);
+                   auto& transform =
+                       m_Registry.get<TransformComponent>(entity);
+                   renderer->DrawSprite(sprite, transform);
+                 }
+                 renderer->EndSpritePass();
+               })
+      .Write(sprite, kAttachment, kSampled);
+
+  graph
+      .AddPass("Composite",
+               [renderer]() {
+                 renderer->BeginCompositePass();
+                 renderer->GetCompositePipeline()->Bind(
+                     PipelineBindPointGraphics);
+                 renderer->DrawFullscreen(
+                     renderer->GetCompositePipeline(),
+                     {renderer->GetCameraData()->LightingOutputDescriptor});
+                 renderer->DrawFullscreen(
+                     renderer->GetCompositePipeline(),
+                     {renderer->GetCameraData()->SpriteOutputDescriptor});
+                 renderer->EndCompositePass();
+               })
+      .Read(lighting)
+      .Read(sprite)
+      .Write(composite, kAttachment, kSampled);
+}
+
 bool Scene::Render() {
   bool hasCamera = false;
   Ref<Renderer> renderer = Engine::GetRenderer();
-  // Render models
+  GatherRenderModels();
+  UpdatePointShadows(renderer);
+  bool staticShadowsChanged = m_StaticShadowsChanged.exchange(false);
+  // Graphs of cameras that aren't rendered anymore are dropped.
+  std::unordered_map<entt::entity, Scope<RenderGraph>> renderGraphs;
+  RenderGraph* previousGraph = nullptr;
   for (const auto& cameraEntity : GetAllEntitiesWith<CameraComponent>()) {
     auto& camera = m_Registry.get<CameraComponent>(cameraEntity);
     auto& cameraTransform = m_Registry.get<TransformComponent>(cameraEntity);
+    if (staticShadowsChanged) {
+      camera.InvalidateStaticShadows();
+    }
     if (!camera.IsEnabled) {
       continue;
     }
+    if (renderer->IsShadowResourcesOutdated(camera)) {
+      renderer->SetupShadowResources(camera);
+    }
     m_CurrentCamera->TransferFrom(camera, cameraTransform);
     renderer->SetCameraData(m_CurrentCamera);
     renderer->BeginFrame();
+    Scope<RenderGraph>& graph = renderGraphs[cameraEntity];
+    auto cached = m_RenderGraphs.find(cameraEntity);
+    graph = cached != m_RenderGraphs.end() ? std::move(cached->second)
+                                           : CreateScope<RenderGraph>();
+    BuildRenderGraph(renderer, *graph);
+    // The light clusters and the shadow atlas are shared, the previous
+    // camera recorded its accesses to them into the same command buffer.
+    if (previousGraph) {
+      graph->CarryStateFrom(*previousGraph);
+    }
+    graph->Compile();
+    graph->Execute(renderer->GetCommandBuffer());
+    previousGraph = graph.get();
+    renderer->EndFrame();
     if (camera.DoesShadowPass) {
-      for (int i = 0; i < WIESEL_SHADOW_CASCADE_COUNT; ++i) {
-        renderer->BeginShadowPass(i);
-        for (const auto& entity :
-             GetAllEntitiesWith<ModelComponent, TransformComponent>()) {
-          auto& model = m_Registry.get<ModelComponent>(entity);
-          auto& transform = m_Registry.get<TransformComponent>(entity);
-          if (!model.Data.ReceiveShadows) {
-            continue;
-          }
-          renderer->DrawModel(model, transform, true);
-        }
-        renderer->EndShadowPass();
+      // Cached cascades are up to date now
+      for (Cascade& cascade : camera.ShadowMapCascades) {
+        cascade.IsStaticDirty = false;
       }
     }
-
-    renderer->BeginGeometryPass();
-    for (const auto& entity :
-         GetAllEntitiesWith<ModelComponent, TransformComponent>()) {
-      auto& model = m_Registry.get<ModelComponent>(entity);
-      auto& transform = m_Registry.get<TransformComponent>(entity);
-      renderer->DrawModel(model, transform, false);
-    }
-    renderer->EndGeometryPass();
-    if (renderer->IsSSAOEnabled()) {
-      renderer->BeginSSAOGenPass();
-      renderer->GetSSAOGenPipeline()->Bind(PipelineBindPointGraphics);
-      renderer->DrawFullscreen(renderer->GetSSAOGenPipeline(), {renderer->GetCameraData()->SSAOGenDescriptor,
-                                                                renderer->GetCameraData()->GlobalDescriptor});
-      renderer->EndSSAOGenPass();
-      renderer->BeginSSAOBlurPass();
-      renderer->GetSSAOBlurPipeline()->Bind(PipelineBindPointGraphics);
-      renderer->DrawFullscreen(renderer->GetSSAOBlurPipeline(), {renderer->GetCameraData()->SSAOOutputDescriptor});
-      renderer->EndSSAOBlurPass();
-    }
-    renderer->BeginLightingPass();
-    renderer->GetSkyboxPipeline()->Bind(PipelineBindPointGraphics);
-    if (m_Skybox) {
-      renderer->DrawSkybox(m_Skybox);
-    }
-    renderer->GetLightingPipeline()->Bind(PipelineBindPointGraphics);
-    renderer->DrawFullscreen(renderer->GetLightingPipeline(), {renderer->GetCameraData()->GeometryOutputDescriptor,
-                                                               renderer->GetCameraData()->SSAOBlurOutputDescriptor,
-                                                              renderer->GetCameraData()->GlobalDescriptor});
-    renderer->EndLightingPass();
-    renderer->BeginSpritePass();
-    renderer->GetSpritePipeline()->Bind(PipelineBindPointGraphics);
-    for (const auto& entity :
-         GetAllEntitiesWith<SpriteComponent, TransformComponent>()) {
-      auto& sprite = m_Registry.get<SpriteComponent>(entity);
-      auto& transform = m_Registry.get<TransformComponent>(entity);
-      renderer->DrawSprite(sprite, transform);
-    }
-    renderer->EndSpritePass();
-    renderer->BeginCompositePass();
-    renderer->GetCompositePipeline()->Bind(PipelineBindPointGraphics);
-    renderer->DrawFullscreen(renderer->GetCompositePipeline(), {renderer->GetCameraData()->LightingOutputDescriptor});
-    renderer->DrawFullscreen(renderer->GetCompositePipeline(), {renderer->GetCameraData()->SpriteOutputDescriptor});
-    renderer->EndCompositePass();
-    renderer->EndFrame();
     hasCamera = true;
   }
+  m_RenderGraphs = std::move(renderGraphs);
+  m_LastRenderGraph = previousGraph;
   return hasCamera;
 }
 
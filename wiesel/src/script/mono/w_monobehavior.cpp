@@ -37,13 +37,17 @@ void MonoBehavior::OnUpdate(float_t deltaTime) {
   m_ScriptInstance->OnUpdate(deltaTime);
 }
 
+void MonoBehavior::SetEnabled(bool enabled) {
+  IBehavior::SetEnabled(enabled);
+  ScriptManager::MarkInstancesDirty();
+}
+
+// Input events reach scripts through ScriptManager::DispatchEvent, only the
+// scripts that handle them are called.
 void MonoBehavior::OnEvent(Event& event) {
   EventDispatcher dispatcher{event};
 
   dispatcher.Dispatch<ScriptsReloadedEvent>(WIESEL_BIND_FN(OnReloadScripts));
-  dispatcher.Dispatch<KeyPressedEvent>(WIESEL_BIND_FN(OnKeyPressed));
-  dispatcher.Dispatch<KeyReleasedEvent>(WIESEL_BIND_FN(OnKeyReleased));
-  dispatcher.Dispatch<MouseMovedEvent>(WIESEL_BIND_FN(OnMouseMoved));
 }
 
 void MonoBehavior::InstantiateScript() {
@@ -61,25 +65,4 @@ bool MonoBehavior::OnReloadScripts(ScriptsReloadedEvent& event) {
   m_ScriptInstance->m_AttachedVariables = copy;
   return false;
 }
-
-bool MonoBehavior::OnKeyPressed(KeyPressedEvent& event) {
-  if (m_Unset || !m_Enabled) {
-    return false;
-  }
-  return m_ScriptInstance->OnKeyPressed(event);
-}
-
-bool MonoBehavior::OnKeyReleased(KeyReleasedEvent& event) {
-  if (m_Unset || !m_Enabled) {
-    return false;
-  }
-  return m_ScriptInstance->OnKeyReleased(event);
-}
-
-bool MonoBehavior::OnMouseMoved(MouseMovedEvent& event) {
-  if (m_Unset || !m_Enabled) {
-    return false;
-  }
-  return m_ScriptInstance->OnMouseMoved(event);
-}
 }
\ No newline at end of file
@@ -12,6 +12,8 @@
 
 #include <direct.h>
 #include <mono/metadata/debug-helpers.h>
+#include <mono/metadata/loader.h>
+#include <mono/metadata/metadata.h>
 #include <mono/metadata/mono-config.h>
 #include <mono/metadata/mono-debug.h>
 #include <mono/metadata/object.h>
@@ -21,6 +23,7 @@
 #include "scene/w_scene.hpp"
 #include "script/mono/w_monobehavior.hpp"
 #include "util/w_logger.hpp"
+#include "util/w_profiler.hpp"
 #include "w_engine.hpp"
 
 namespace Wiesel {
@@ -36,18 +39,27 @@ void Internals_Log_Info(MonoString* str) {
   mono_free((void*)cstr);
 }
 
-float Internals_Input_GetAxis(MonoString* str) {
+// Scripts resolve names to ids once, the calls made every frame take ids.
+int32_t Internals_Input_GetAxisId(MonoString* str) {
   const char* cstr = mono_string_to_utf8(str);
-  float value = InputManager::GetAxis(cstr);
+  int32_t id = InputManager::GetAxisId(cstr);
   mono_free((void*)cstr);
-  return value;
+  return id;
 }
 
-bool Internals_Input_GetKey(MonoString* str) {
+float Internals_Input_GetAxis(int32_t axisId) {
+  return InputManager::GetAxis(axisId);
+}
+
+int32_t Internals_Input_GetKeyId(MonoString* str) {
   const char* cstr = mono_string_to_utf8(str);
-  bool value = InputManager::GetKey(cstr);
+  int32_t id = InputManager::GetKeyId(cstr);
   mono_free((void*)cstr);
-  return value;
+  return id;
+}
+
+bool Internals_Input_GetKey(int32_t keyId) {
+  return InputManager::GetKey(keyId);
 }
 
 void Internals_Input_SetCursorMode(uint16_t mode) {
@@ -59,218 +71,145 @@ uint16_t Internals_Input_GetCursorMode() {
   return cursorMode;
 }
 
-MonoObject* Internals_Behavior_GetComponent(Scene* scene, entt::entity entity,
-                                            MonoString* str) {
-  const char* cstr = mono_string_to_utf8(str);
-  MonoObject* component =
-      ScriptManager::GetComponentByName(scene, entity, cstr);
-  mono_free((void*)cstr);
-  return component;
-}
-
-bool Internals_Behavior_HasComponent(Scene* scene, entt::entity entity,
-                                     MonoString* str) {
+int32_t Internals_Behavior_GetComponentId(MonoString* str) {
   const char* cstr = mono_string_to_utf8(str);
-  bool hasComponent = ScriptManager::HasComponentByName(scene, entity, cstr);
+  int32_t id = ScriptManager::GetComponentId(cstr);
   mono_free((void*)cstr);
-  return hasComponent;
-}
-
-float Internals_TransformComponent_GetPositionX(Scene* scene,
-                                                entt::entity entity) {
-  return scene->GetComponent<TransformComponent>(entity).Position.x;
-}
-
-void Internals_TransformComponent_SetPositionX(Scene* scene,
-                                               entt::entity entity,
-                                               float value) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  if (c.Position.x == value) {
-    return;
-  }
-  c.Position.x = value;
-  c.IsChanged = true;
-}
-
-float Internals_TransformComponent_GetPositionY(Scene* scene,
-                                                entt::entity entity) {
-  return scene->GetComponent<TransformComponent>(entity).Position.y;
-}
-
-void Internals_TransformComponent_SetPositionY(Scene* scene,
-                                               entt::entity entity,
-                                               float value) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  if (c.Position.y == value) {
-    return;
-  }
-  c.Position.y = value;
-  c.IsChanged = true;
-}
-
-float Internals_TransformComponent_GetPositionZ(Scene* scene,
-                                                entt::entity entity) {
-  return scene->GetComponent<TransformComponent>(entity).Position.z;
-}
-
-void Internals_TransformComponent_SetPositionZ(Scene* scene,
-                                               entt::entity entity,
-                                               float value) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  if (c.Position.z == value) {
-    return;
-  }
-  c.Position.z = value;
-  c.IsChanged = true;
+  return id;
 }
 
-float Internals_TransformComponent_GetRotationX(Scene* scene,
-                                                entt::entity entity) {
-  return scene->GetComponent<TransformComponent>(entity).Rotation.x;
-}
-
-void Internals_TransformComponent_SetRotationX(Scene* scene,
-                                               entt::entity entity,
-                                               float value) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  if (c.Rotation.x == value) {
-    return;
-  }
-  c.Rotation.x = value;
-  c.IsChanged = true;
+MonoObject* Internals_Behavior_GetComponent(Scene* scene, entt::entity entity,
+                                            int32_t componentId) {
+  return ScriptManager::GetComponentById(scene, entity, componentId);
 }
 
-float Internals_TransformComponent_GetRotationY(Scene* scene,
-                                                entt::entity entity) {
-  return scene->GetComponent<TransformComponent>(entity).Rotation.y;
+bool Internals_Behavior_HasComponent(Scene* scene, entt::entity entity,
+                                     int32_t componentId) {
+  return ScriptManager::HasComponentById(scene, entity, componentId);
 }
 
-void Internals_TransformComponent_SetRotationY(Scene* scene,
-                                               entt::entity entity,
-                                               float value) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  if (c.Rotation.y == value) {
-    return;
-  }
-  c.Rotation.y = value;
-  c.IsChanged = true;
+// Offsets of the fields scripts access in place, read once by the static
+// constructor of the managed TransformComponent.
+void Internals_TransformComponent_GetLayout(int32_t* position,
+                                            int32_t* rotation, int32_t* scale,
+                                            int32_t* matrix,
+                                            int32_t* changed) {
+  static const TransformComponent layout{};
+  auto offset = [](const void* field) {
+    return static_cast<int32_t>(static_cast<const char*>(field) -
+                                reinterpret_cast<const char*>(&layout));
+  };
+  *position = offset(&layout.Position);
+  *rotation = offset(&layout.Rotation);
+  *scale = offset(&layout.Scale);
+  *matrix = offset(&layout.TransformMatrix);
+  *changed = offset(&layout.IsChanged);
 }
 
-float Internals_TransformComponent_GetRotationZ(Scene* scene,
-                                                entt::entity entity) {
-  return scene->GetComponent<TransformComponent>(entity).Rotation.z;
+// Transforms are deleted in place, so the pointer stays valid for as long as
+// the component exists. The wrapper is invalidated when it is removed.
+void* Internals_TransformComponent_GetPointer(Scene* scene,
+                                              entt::entity entity) {
+  return &scene->GetComponent<TransformComponent>(entity);
 }
 
-void Internals_TransformComponent_SetRotationZ(Scene* scene,
-                                               entt::entity entity,
-                                               float value) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  if (c.Rotation.z == value) {
-    return;
+bool ScriptData::HandlesEvent(EventType type) const {
+  switch (type) {
+    case EventType::KeyPressed:
+      return m_HandlesKeyPressed;
+    case EventType::KeyReleased:
+      return m_HandlesKeyReleased;
+    case EventType::MouseMoved:
+      return m_HandlesMouseMoved;
+    default:
+      return false;
   }
-  c.Rotation.z = value;
-  c.IsChanged = true;
-}
-
-float Internals_TransformComponent_GetScaleX(Scene* scene,
-                                             entt::entity entity) {
-  return scene->GetComponent<TransformComponent>(entity).Scale.x;
 }
 
-void Internals_TransformComponent_SetScaleX(Scene* scene, entt::entity entity,
-                                            float value) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  if (c.Scale.x == value) {
-    return;
+bool ScriptData::IsEmptyHandler(MonoMethod* method) {
+  MonoMethodHeader* header = mono_method_get_header(method);
+  if (!header) {
+    return false;
   }
-  c.Scale.x = value;
-  c.IsChanged = true;
-}
-
-float Internals_TransformComponent_GetScaleY(Scene* scene,
-                                             entt::entity entity) {
-  return scene->GetComponent<TransformComponent>(entity).Scale.y;
-}
-
-void Internals_TransformComponent_SetScaleY(Scene* scene, entt::entity entity,
-                                            float value) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  if (c.Scale.y == value) {
-    return;
+  uint32_t size;
+  uint32_t maxStack;
+  const unsigned char* code =
+      mono_method_header_get_code(header, &size, &maxStack);
+  // Runs the body with every value being either a known false or unknown,
+  // anything other than moving a constant around bails out. Covers both
+  // "return false;" and what debug builds make of it:
+  // nop; ldc.i4.0; stloc.0; br.s; ldloc.0; ret
+  constexpr int kUnknown = -1;
+  constexpr int kFalse = 0;
+  std::vector<int> stack;
+  int locals[256];
+  std::fill(std::begin(locals), std::end(locals), kUnknown);
+  bool empty = false;
+  uint32_t pc = 0;
+  // Guards against branches that loop back.
+  for (uint32_t steps = 0; pc < size && steps < size; steps++) {
+    unsigned char op = code[pc++];
+    if (op == 0x00) {  // nop
+      continue;
+    }
+    if (op == 0x16) {  // ldc.i4.0
+      stack.push_back(kFalse);
+    } else if (op >= 0x06 && op <= 0x09) {  // ldloc.0 - ldloc.3
+      stack.push_back(locals[op - 0x06]);
+    } else if (op == 0x11 && pc < size) {  // ldloc.s
+      stack.push_back(locals[code[pc++]]);
+    } else if (op >= 0x0A && op <= 0x0D && !stack.empty()) {  // stloc.0 - 3
+      locals[op - 0x0A] = stack.back();
+      stack.pop_back();
+    } else if (op == 0x13 && pc < size && !stack.empty()) {  // stloc.s
+      locals[code[pc++]] = stack.back();
+      stack.pop_back();
+    } else if (op == 0x2B && pc < size) {  // br.s
+      int8_t offset = static_cast<int8_t>(code[pc++]);
+      pc += offset;
+    } else if (op == 0x38 && pc + 4 <= size) {  // br
+      int32_t offset = code[pc] | code[pc + 1] << 8 | code[pc + 2] << 16 |
+                       code[pc + 3] << 24;
+      pc += 4 + offset;
+    } else if (op == 0x2A) {  // ret
+      empty = stack.empty() || (stack.size() == 1 && stack[0] == kFalse);
+      break;
+    } else {
+      break;
+    }
   }
-  c.Scale.y = value;
-  c.IsChanged = true;
-}
-
-float Internals_TransformComponent_GetScaleZ(Scene* scene,
-                                             entt::entity entity) {
-  return scene->GetComponent<TransformComponent>(entity).Scale.z;
+  mono_metadata_free_mh(header);
+  return empty;
 }
 
-void Internals_TransformComponent_SetScaleZ(Scene* scene, entt::entity entity,
-                                            float value) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  if (c.Scale.z == value) {
-    return;
+// Adds the time of a script callback to the stats of its class, and to the
+// engine profiler while a section is being recorded.
+class ScriptTimer {
+ public:
+  ScriptTimer(ScriptData* data, ScriptMethod method, uint32_t calls = 1)
+      : m_Data(data),
+        m_Method(method),
+        m_Calls(calls),
+        m_StartTime(std::chrono::steady_clock::now()) {}
+
+  ~ScriptTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - m_StartTime;
+    m_Data->GetStats(m_Method).AddSample(elapsed, m_Calls);
+    if (Profiler::IsActive()) {
+      Profiler::InsertData(
+          {fmt::format("{}::{}", mono_class_get_name(m_Data->GetClass()),
+                       GetScriptMethodName(m_Method)),
+           std::chrono::duration_cast<std::chrono::microseconds>(elapsed),
+           -1});
+    }
   }
-  c.Scale.z = value;
-  c.IsChanged = true;
-}
-
-MonoObject* CreateVector3fWithValues(float x, float y, float z) {
-  MonoObject* obj = mono_object_new(ScriptManager::GetAppDomain(),
-                                    ScriptManager::GetVector3fClass());
-  void* args[3];
-  args[0] = &x;
-  args[1] = &y;
-  args[2] = &z;
-  MonoMethod* method = mono_class_get_method_from_name(
-      ScriptManager::GetVector3fClass(), ".ctor", 3);
-  mono_runtime_invoke(method, obj, args, nullptr);
-  return obj;
-}
 
-MonoObject* Internals_TransformComponent_GetForward(Scene* scene,
-                                                    entt::entity entity) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  glm::vec3 val = c.GetForward();
-  return CreateVector3fWithValues(val.x, val.y, val.z);
-}
-
-MonoObject* Internals_TransformComponent_GetBackward(Scene* scene,
-                                                     entt::entity entity) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  glm::vec3 val = c.GetBackward();
-  return CreateVector3fWithValues(val.x, val.y, val.z);
-}
-
-MonoObject* Internals_TransformComponent_GetLeft(Scene* scene,
-                                                 entt::entity entity) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  glm::vec3 val = c.GetLeft();
-  return CreateVector3fWithValues(val.x, val.y, val.z);
-}
-
-MonoObject* Internals_TransformComponent_GetRight(Scene* scene,
-                                                  entt::entity entity) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  glm::vec3 val = c.GetRight();
-  return CreateVector3fWithValues(val.x, val.y, val.z);
-}
-
-MonoObject* Internals_TransformComponent_GetUp(Scene* scene,
-                                               entt::entity entity) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  glm::vec3 val = c.GetUp();
-  return CreateVector3fWithValues(val.x, val.y, val.z);
-}
-
-MonoObject* Internals_TransformComponent_GetDown(Scene* scene,
-                                                 entt::entity entity) {
-  auto& c = scene->GetComponent<TransformComponent>(entity);
-  glm::vec3 val = c.GetDown();
-  return CreateVector3fWithValues(val.x, val.y, val.z);
-}
+ private:
+  ScriptData* m_Data;
+  ScriptMethod m_Method;
+  uint32_t m_Calls;
+  std::chrono::steady_clock::time_point m_StartTime;
+};
 
 ScriptInstance::ScriptInstance(ScriptData* data, MonoBehavior* behavior) {
   m_Behavior = behavior;
@@ -281,25 +220,43 @@ ScriptInstance::ScriptInstance(ScriptData* data, MonoBehavior* behavior) {
   uint64_t behaviorPtr = (uint64_t)behavior;
   uint64_t scenePtr = (uint64_t)behavior->GetScene();
   uint64_t entityId = (uint64_t)behavior->GetEntityHandle();
-  MonoClass* baseClass = ScriptManager::GetMonoBehaviorClass();
-  MonoClassField* field =
-      mono_class_get_field_from_name(baseClass, "behaviorPtr");
-  mono_field_set_value(m_Instance, field, &behaviorPtr);
-  field = mono_class_get_field_from_name(baseClass, "scenePtr");
-  mono_field_set_value(m_Instance, field, &scenePtr);
-  field = mono_class_get_field_from_name(baseClass, "entityId");
-  mono_field_set_value(m_Instance, field, &entityId);
+  mono_field_set_value(m_Instance, ScriptManager::GetBehaviorPtrField(),
+                       &behaviorPtr);
+  mono_field_set_value(m_Instance, ScriptManager::GetScenePtrField(),
+                       &scenePtr);
+  mono_field_set_value(m_Instance, ScriptManager::GetEntityIdField(),
+                       &entityId);
   m_GCHandle = mono_gchandle_new(m_Instance, true);
+  ScriptManager::AddInstance(this);
 }
 
 ScriptInstance::~ScriptInstance() {
+  // Detached instances aren't registered anymore and hold no handle.
+  if (!m_ScriptData) {
+    return;
+  }
+  ScriptManager::RemoveInstance(this);
   mono_gchandle_free(m_GCHandle);
 }
 
+void ScriptInstance::Detach() {
+  mono_gchandle_free(m_GCHandle);
+  m_GCHandle = 0;
+  m_Instance = nullptr;
+  m_ScriptData = nullptr;
+}
+
 void ScriptInstance::OnStart() {
   UpdateAttachments();
-  mono_runtime_invoke(m_ScriptData->GetOnStartMethod(), m_Instance, nullptr,
-                      nullptr);
+  if (!m_ScriptData->GetOnStartThunk()) {
+    return;
+  }
+  MonoException* exception = nullptr;
+  {
+    ScriptTimer timer(m_ScriptData, ScriptMethod::OnStart);
+    m_ScriptData->GetOnStartThunk()(m_Instance, &exception);
+  }
+  HandleException(exception);
 }
 
 void ScriptInstance::OnUpdate(float_t deltaTime) {
@@ -307,60 +264,68 @@ void ScriptInstance::OnUpdate(float_t deltaTime) {
     OnStart();
     m_StartRan = true;
   }
-
-  mono_domain_set(ScriptManager::GetAppDomain(), true);
-  void* args[1];
-  args[0] = &deltaTime;
-  mono_runtime_invoke(m_ScriptData->GetOnUpdateMethod(), m_Instance, args,
-                      nullptr);
+  if (!m_ScriptData->GetOnUpdateThunk()) {
+    return;
+  }
+  MonoException* exception = nullptr;
+  {
+    ScriptTimer timer(m_ScriptData, ScriptMethod::OnUpdate);
+    m_ScriptData->GetOnUpdateThunk()(m_Instance, deltaTime, &exception);
+  }
+  HandleException(exception);
 }
 
 bool ScriptInstance::OnKeyPressed(KeyPressedEvent& event) {
-  if (!m_ScriptData->GetOnKeyPressedMethod()) {
+  if (!m_ScriptData->GetOnKeyPressedThunk()) {
     return false;
   }
-  mono_domain_set(ScriptManager::GetAppDomain(), true);
-  void* args[2];
-  int32_t keyCode = event.GetKeyCode();
-  bool repeat = event.IsRepeat();
-  args[0] = &keyCode;
-  args[1] = &repeat;
-  MonoObject* data = mono_runtime_invoke(m_ScriptData->GetOnKeyPressedMethod(),
-                                         m_Instance, args, nullptr);
-  bool value = *(bool*)mono_object_unbox(data);
-  return value;
+  MonoException* exception = nullptr;
+  MonoBoolean value;
+  {
+    ScriptTimer timer(m_ScriptData, ScriptMethod::OnKeyPressed);
+    value = m_ScriptData->GetOnKeyPressedThunk()(
+        m_Instance, static_cast<int32_t>(event.GetKeyCode()), event.IsRepeat(),
+        &exception);
+  }
+  return !HandleException(exception) && value;
 }
 
 bool ScriptInstance::OnKeyReleased(KeyReleasedEvent& event) {
-  if (!m_ScriptData->GetOnKeyReleasedMethod()) {
+  if (!m_ScriptData->GetOnKeyReleasedThunk()) {
     return false;
   }
-  mono_domain_set(ScriptManager::GetAppDomain(), true);
-  void* args[1];
-  int32_t keyCode = event.GetKeyCode();
-  args[0] = &keyCode;
-  MonoObject* data = mono_runtime_invoke(m_ScriptData->GetOnKeyReleasedMethod(),
-                                         m_Instance, args, nullptr);
-  bool value = *(bool*)mono_object_unbox(data);
-  return value;
+  MonoException* exception = nullptr;
+  MonoBoolean value;
+  {
+    ScriptTimer timer(m_ScriptData, ScriptMethod::OnKeyReleased);
+    value = m_ScriptData->GetOnKeyReleasedThunk()(
+        m_Instance, static_cast<int32_t>(event.GetKeyCode()), &exception);
+  }
+  return !HandleException(exception) && value;
 }
 
 bool ScriptInstance::OnMouseMoved(MouseMovedEvent& event) {
-  if (!m_ScriptData->GetOnMouseMovedMethod()) {
+  if (!m_ScriptData->GetOnMouseMovedThunk()) {
     return false;
   }
-  mono_domain_set(ScriptManager::GetAppDomain(), true);
-  void* args[3];
-  float x = event.GetX();
-  float y = event.GetY();
-  int32_t cursorMode = event.GetCursorMode();
-  args[0] = &x;
-  args[1] = &y;
-  args[2] = &cursorMode;
-  MonoObject* data = mono_runtime_invoke(m_ScriptData->GetOnMouseMovedMethod(),
-                                         m_Instance, args, nullptr);
-  bool value = *(bool*)mono_object_unbox(data);
-  return value;
+  MonoException* exception = nullptr;
+  MonoBoolean value;
+  {
+    ScriptTimer timer(m_ScriptData, ScriptMethod::OnMouseMoved);
+    value = m_ScriptData->GetOnMouseMovedThunk()(
+        m_Instance, event.GetX(), event.GetY(),
+        static_cast<int32_t>(event.GetCursorMode()), &exception);
+  }
+  return !HandleException(exception) && value;
+}
+
+bool ScriptInstance::HandleException(MonoException* exception) {
+  if (!exception) {
+    return false;
+  }
+  LOG_ERROR("Exception in script {}!", m_Behavior->GetName());
+  mono_print_unhandled_exception(reinterpret_cast<MonoObject*>(exception));
+  return true;
 }
 
 // explicitly instantiate needed types, this is required:
@@ -385,8 +350,7 @@ void ScriptInstance::UpdateAttachments() {
     if (!object) {
       continue;
     }
-    MonoClassField* field = mono_class_get_field_from_name(
-        m_ScriptData->GetClass(), item.first.c_str());
+    MonoClassField* field = m_ScriptData->GetClassField(item.first);
     if (!field) {
       continue;
     }
@@ -404,47 +368,109 @@ MonoClass* ScriptManager::m_MonoBehaviorClass = nullptr;
 MonoClass* ScriptManager::m_MonoTransformComponentClass = nullptr;
 MonoClass* ScriptManager::m_MonoVector3fClass = nullptr;
 MonoMethod* ScriptManager::m_SetHandleMethod = nullptr;
-
-std::map<std::string, ScriptManager::ComponentGetter>
-    ScriptManager::m_ComponentGetters;
-std::map<std::type_index, ScriptManager::ComponentGetter>
-    ScriptManager::m_ComponentGettersByType;
-std::map<std::string, ScriptManager::ComponentChecker>
-    ScriptManager::m_ComponentCheckers;
+MonoMethod* ScriptManager::m_TransformComponentConstructor = nullptr;
+MonoMethod* ScriptManager::m_TransformComponentInvalidate = nullptr;
+MonoClassField* ScriptManager::m_BehaviorPtrField = nullptr;
+MonoClassField* ScriptManager::m_ScenePtrField = nullptr;
+MonoClassField* ScriptManager::m_EntityIdField = nullptr;
+UpdateAllThunk ScriptManager::m_UpdateAllThunk = nullptr;
+UpdateAllThunk ScriptManager::m_FixedUpdateAllThunk = nullptr;
+std::map<ScriptManager::ScriptBatchKey, ScriptManager::ScriptBatch>
+    ScriptManager::m_ScriptBatches;
+uint64_t ScriptManager::m_InstancesVersion = 0;
+std::map<std::pair<Scene*, EventType>, std::vector<ScriptInstance*>>
+    ScriptManager::m_EventSubscribers;
+
+std::vector<ScriptManager::ComponentInfo> ScriptManager::m_Components;
+std::map<std::string, int32_t> ScriptManager::m_ComponentIds;
+std::map<std::type_index, int32_t> ScriptManager::m_ComponentIdsByType;
+std::map<ScriptManager::ComponentWrapperKey, uint32_t>
+    ScriptManager::m_ComponentWrappers;
 std::map<std::string, ScriptData*> ScriptManager::m_ScriptData;
 std::vector<std::string> ScriptManager::m_ScriptNames;
 bool ScriptManager::m_EnableDebugger;
+bool ScriptManager::m_EnableAot;
+Scope<ScriptManager::ScriptReload> ScriptManager::m_Reload;
+std::string ScriptManager::m_AppAssemblyPath;
+uint32_t ScriptManager::m_AppBuildNumber = 0;
+
+int32_t ScriptManager::GetComponentId(const std::string& name) {
+  auto it = m_ComponentIds.find(name);
+  if (it == m_ComponentIds.end()) {
+    return -1;
+  }
+  return it->second;
+}
 
-MonoObject* ScriptManager::GetComponentByName(Scene* scene, entt::entity entity,
-                                              const std::string& name) {
-  auto& fn = m_ComponentGetters[name];
-  if (fn == nullptr) {
+MonoObject* ScriptManager::GetComponentById(Scene* scene, entt::entity entity,
+                                            int32_t id) {
+  if (!HasComponentById(scene, entity, id)) {
     return nullptr;
   }
-  return fn(scene, entity);
+  const ComponentInfo& info = m_Components[id];
+  return GetComponentWrapper(scene, entity, info.Type, info.Getter);
 }
 
 template <class T>
 MonoObject* ScriptManager::GetComponent(Wiesel::Scene* scene, entt::entity entity) {
-  auto& fn = m_ComponentGettersByType[std::type_index(typeid(T))];
-  if (fn == nullptr) {
+  auto it = m_ComponentIdsByType.find(std::type_index(typeid(T)));
+  if (it == m_ComponentIdsByType.end()) {
     return nullptr;
   }
-  return fn(scene, entity);
+  return GetComponentById(scene, entity, it->second);
+}
+
+bool ScriptManager::HasComponentById(Scene* scene, entt::entity entity,
+                                     int32_t id) {
+  if (id < 0 || id >= static_cast<int32_t>(m_Components.size())) {
+    return false;
+  }
+  return m_Components[id].Checker(scene, entity);
+}
+
+static std::vector<std::string> FindSources(const std::string& directory) {
+  std::vector<std::string> sourceFiles;
+  for (const auto& entry :
+       std::filesystem::recursive_directory_iterator(directory)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".cs") {
+      sourceFiles.push_back(entry.path().string());
+    }
+  }
+  return sourceFiles;
 }
 
-bool ScriptManager::HasComponentByName(Scene* scene, entt::entity entity,
-                                       const std::string& name) {
-  auto& fn = m_ComponentCheckers[name];
-  if (fn == nullptr) {
+// Reloaded builds are numbered like App.1.dll, App.1.dll.hash...
+static bool IsReloadedAppBuild(const std::filesystem::path& path) {
+  std::string name = path.filename().string();
+  if (!name.starts_with("App.")) {
     return false;
   }
-  return fn(scene, entity);
+  size_t end = name.find('.', 4);
+  return end != std::string::npos && end > 4 &&
+         std::all_of(name.begin() + 4, name.begin() + end,
+                     [](char c) { return c >= '0' && c <= '9'; });
+}
+
+static void RemoveReloadedAppBuilds(const std::string& assemblyFile) {
+  std::error_code error;
+  for (const auto& entry : std::filesystem::directory_iterator("obj", error)) {
+    if (!IsReloadedAppBuild(entry.path())) {
+      continue;
+    }
+    // Either every build, or only the files of the given one.
+    if (assemblyFile.empty() ||
+        entry.path().filename().string().starts_with(
+            std::filesystem::path(assemblyFile).filename().string())) {
+      std::filesystem::remove(entry.path(), error);
+    }
+  }
 }
 
 void ScriptManager::Init(const ScriptManagerProperties&& props) {
   m_EnableDebugger = props.EnableDebugger;
+  m_EnableAot = props.EnableAot;
   LOG_INFO("Initializing mono...");
+  auto start = std::chrono::steady_clock::now();
 
   mono_set_dirs("mono/lib", "mono/etc");
   mono_config_parse("mono/etc/mono/config");
@@ -457,16 +483,39 @@ void ScriptManager::Init(const ScriptManagerProperties&& props) {
     mono_debug_init(MONO_DEBUG_FORMAT_MONO);
   }
 
+  if (props.EnableProfiler) {
+    ScriptProfiler::Init();
+  }
+  if (m_EnableAot) {
+    // Uses the precompiled images, anything they don't cover is still JIT
+    // compiled.
+    mono_jit_set_aot_mode(MONO_AOT_MODE_HYBRID);
+  }
   m_RootDomain = mono_jit_init("WieselJITRuntime");
 
   RegisterComponents();
   RegisterInternals();
+  // Left behind by a previous run that reloaded its scripts.
+  RemoveReloadedAppBuilds("");
+  m_AppAssemblyPath = kAppAssemblyPath;
+  bool changed = false;
+  CompileCore(changed);
   LoadCore();
-  LoadApp();
+  if (CompileApp(changed)) {
+    LoadApp();
+  }
+  auto elapsed = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start);
+  LOG_INFO("Scripts loaded in {:.2f} ms ({})", elapsed.count(),
+           m_EnableAot ? "AOT" : "JIT");
 }
 
 void ScriptManager::Destroy() {
   LOG_INFO("Cleaning up script manager...");
+  if (m_Reload) {
+    m_Reload->Thread.join();
+    m_Reload = nullptr;
+  }
   // mono_domain_set(m_RootDomain, true);
   //mono_domain_unload(m_EngineDomain);
   //mono_domain_free(m_EngineDomain, true);
@@ -474,10 +523,75 @@ void ScriptManager::Destroy() {
 }
 
 void ScriptManager::Reload() {
+  if (m_Reload) {
+    return;
+  }
   LOG_INFO("Reloading scripts...");
+  m_Reload = CreateScope<ScriptReload>();
+  // The loaded build stays mapped by mono until its domain is unloaded, a
+  // changed build goes next to it instead of over it.
+  std::string loadedPath = m_AppAssemblyPath;
+  std::string stagedPath = fmt::format("obj/App.{}.dll", ++m_AppBuildNumber);
+  m_Reload->Thread = std::thread([reload = m_Reload.get(), loadedPath,
+                                  stagedPath]() {
+    // Core lives in the root domain, which can't be unloaded.
+    if (!IsCoreUpToDate()) {
+      LOG_WARN("Core scripts changed, restart to apply them!");
+    }
+    std::vector<std::string> sourceFiles = FindSources("assets/scripts");
+    std::vector<std::string> linkLibs = FindAppLinkLibs();
+    std::string hash = HashAssembly(sourceFiles, linkLibs, false);
+    if (IsAssemblyUpToDate(loadedPath, hash)) {
+      LOG_INFO("{} is up to date", loadedPath);
+      reload->AssemblyPath = loadedPath;
+      reload->Succeeded = true;
+    } else {
+      reload->AssemblyPath = stagedPath;
+      reload->Succeeded = BuildAssembly(stagedPath, sourceFiles, "obj",
+                                        linkLibs, false, hash);
+    }
+    reload->Done = true;
+  });
+}
 
+void ScriptManager::UpdateReload() {
+  if (!m_Reload || !m_Reload->Done) {
+    return;
+  }
+  m_Reload->Thread.join();
+  bool succeeded = m_Reload->Succeeded;
+  std::string assemblyPath = m_Reload->AssemblyPath;
+  m_Reload = nullptr;
+  if (!succeeded) {
+    LOG_ERROR("Failed to compile scripts, keeping the old ones!");
+    RemoveReloadedAppBuilds(assemblyPath);
+    return;
+  }
+  SwapAssemblies(assemblyPath);
+}
+
+void ScriptManager::SwapAssemblies(const std::string& assemblyPath) {
+  // Old instances are deleted after the reload, they are not updated anymore.
+  // Their script data is freed below, detach them so their destructors don't
+  // look up batches with it.
+  for (auto& [key, batch] : m_ScriptBatches) {
+    for (ScriptInstance* instance : batch.Instances) {
+      instance->Detach();
+    }
+  }
+  m_InstancesVersion++;
+  ClearBatches();
+  ClearComponentWrappers();
+  m_UpdateAllThunk = nullptr;
+  m_FixedUpdateAllThunk = nullptr;
   mono_domain_set(m_RootDomain, true);
   mono_domain_unload(m_AppDomain);
+  // Nothing maps the previous build anymore.
+  if (assemblyPath != m_AppAssemblyPath &&
+      IsReloadedAppBuild(m_AppAssemblyPath)) {
+    RemoveReloadedAppBuilds(m_AppAssemblyPath);
+  }
+  m_AppAssemblyPath = assemblyPath;
 
   for (const auto& [first, second] : m_ScriptData) {
     delete second;
@@ -487,27 +601,150 @@ void ScriptManager::Reload() {
 
   RegisterComponents();
   RegisterInternals();
-  LoadCore();
   LoadApp();
 
   ScriptsReloadedEvent event{};
   Application::Get()->OnEvent(event);
 }
 
-void ScriptManager::LoadCore() {
-  LOG_INFO("Compiling core scripts...");
-  std::vector<std::string> sourceFiles;
-  for (const auto& entry : std::filesystem::recursive_directory_iterator(
-           "assets/internal_scripts")) {
-    if (entry.is_regular_file() && entry.path().extension() == ".cs") {
-      std::string name = entry.path().string();
-      LOG_INFO("Found internal script {}", name);
-      sourceFiles.push_back(name);
+// Mono looks for the native image next to the assembly.
+static std::string GetAotImagePath(const std::string& assemblyFile) {
+#if defined(WIESEL_PLATFORM_WINDOWS)
+  return assemblyFile + ".dll";
+#elif defined(WIESEL_PLATFORM_MACOS)
+  return assemblyFile + ".dylib";
+#else
+  return assemblyFile + ".so";
+#endif
+}
+
+// FNV-1a, mixed with every input of the compiler.
+static void HashBytes(uint64_t& hash, const char* data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    hash ^= static_cast<uint8_t>(data[i]);
+    hash *= 1099511628211ull;
+  }
+}
+
+static bool HashFile(uint64_t& hash, const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  std::vector<char> data((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+  HashBytes(hash, path.data(), path.size());
+  HashBytes(hash, data.data(), data.size());
+  return true;
+}
+
+std::string ScriptManager::HashAssembly(std::vector<std::string>& sourceFiles,
+                                        const std::vector<std::string>& linkLibs,
+                                        bool allowUnsafe) {
+  // Directory order isn't stable, the hash shouldn't depend on it.
+  std::sort(sourceFiles.begin(), sourceFiles.end());
+  uint64_t hash = 14695981039346656037ull;
+  uint8_t options = (m_EnableDebugger ? 1 : 0) | (allowUnsafe ? 2 : 0) |
+                    (m_EnableAot ? 4 : 0);
+  HashBytes(hash, reinterpret_cast<const char*>(&options), sizeof(options));
+  for (const auto& file : sourceFiles) {
+    HashFile(hash, file);
+  }
+  for (const auto& lib : linkLibs) {
+    HashFile(hash, lib);
+  }
+  return fmt::format("{:016x}", hash);
+}
+
+bool ScriptManager::IsAssemblyUpToDate(const std::string& outputFile,
+                                       const std::string& hash) {
+  if (!std::filesystem::exists(outputFile) ||
+      (m_EnableAot && !std::filesystem::exists(GetAotImagePath(outputFile)))) {
+    return false;
+  }
+  std::ifstream file(outputFile + ".hash");
+  std::string previous;
+  return file >> previous && previous == hash;
+}
+
+bool ScriptManager::BuildAssembly(const std::string& outputFile,
+                                  const std::vector<std::string>& sourceFiles,
+                                  const std::string& libDir,
+                                  const std::vector<std::string>& linkLibs,
+                                  bool allowUnsafe, const std::string& hash) {
+  LOG_INFO("Compiling {}...", outputFile);
+  std::string hashFile = outputFile + ".hash";
+  if (!CompileToDLL(outputFile, sourceFiles, libDir, linkLibs,
+                    m_EnableDebugger, allowUnsafe)) {
+    std::filesystem::remove(hashFile);
+    return false;
+  }
+  // An image of an older build would be rejected by the runtime anyway.
+  std::filesystem::remove(GetAotImagePath(outputFile));
+  if (m_EnableAot) {
+    LOG_INFO("AOT compiling {}...", outputFile);
+    if (!AotCompile(outputFile)) {
+      std::filesystem::remove(hashFile);
+      return false;
     }
   }
-  CompileToDLL("obj/Core.dll", sourceFiles, "", {}, m_EnableDebugger);
+  std::ofstream file(hashFile, std::ios::trunc);
+  file << hash;
+  return true;
+}
 
-  m_CoreAssembly = mono_domain_assembly_open(m_RootDomain, "obj/Core.dll");
+bool ScriptManager::CompileAssembly(const std::string& outputFile,
+                                    std::vector<std::string> sourceFiles,
+                                    const std::string& libDir,
+                                    const std::vector<std::string>& linkLibs,
+                                    bool allowUnsafe, bool& changed) {
+  std::string hash = HashAssembly(sourceFiles, linkLibs, allowUnsafe);
+  if (IsAssemblyUpToDate(outputFile, hash)) {
+    LOG_INFO("{} is up to date", outputFile);
+    return true;
+  }
+  changed = true;
+  return BuildAssembly(outputFile, sourceFiles, libDir, linkLibs, allowUnsafe,
+                       hash);
+}
+
+bool ScriptManager::CompileCore(bool& changed) {
+  // Core accesses native components through pointers.
+  return CompileAssembly(kCoreAssemblyPath,
+                         FindSources("assets/internal_scripts"), "", {}, true,
+                         changed);
+}
+
+bool ScriptManager::IsCoreUpToDate() {
+  std::vector<std::string> sourceFiles = FindSources("assets/internal_scripts");
+  return IsAssemblyUpToDate(kCoreAssemblyPath,
+                            HashAssembly(sourceFiles, {}, true));
+}
+
+std::vector<std::string> ScriptManager::FindAppLinkLibs() {
+  // todo load files from project file when project system is added
+  std::vector<std::string> linkLibs;
+  for (const auto& entry :
+       std::filesystem::recursive_directory_iterator("obj")) {
+    // Skips the builds of the app itself and the native images on Windows,
+    // they are named like Core.dll.dll.
+    if (entry.is_regular_file() && entry.path().extension() == ".dll" &&
+        entry.path().stem().extension() != ".dll" &&
+        !entry.path().filename().string().starts_with("App.")) {
+      linkLibs.push_back(entry.path().string());
+    }
+  }
+  std::sort(linkLibs.begin(), linkLibs.end());
+  return linkLibs;
+}
+
+bool ScriptManager::CompileApp(bool& changed) {
+  return CompileAssembly(kAppAssemblyPath, FindSources("assets/scripts"), "obj",
+                         FindAppLinkLibs(), false, changed);
+}
+
+void ScriptManager::LoadCore() {
+  m_CoreAssembly = mono_domain_assembly_open(m_RootDomain, kCoreAssemblyPath);
   assert(m_CoreAssembly);
 
   m_CoreAssemblyImage = mono_assembly_get_image(m_CoreAssembly);
@@ -515,44 +752,40 @@ void ScriptManager::LoadCore() {
       mono_class_from_name(m_CoreAssemblyImage, "WieselEngine", "MonoBehavior");
   m_SetHandleMethod =
       mono_class_get_method_from_name(m_MonoBehaviorClass, "SetHandle", 1);
+  m_BehaviorPtrField =
+      mono_class_get_field_from_name(m_MonoBehaviorClass, "behaviorPtr");
+  m_ScenePtrField =
+      mono_class_get_field_from_name(m_MonoBehaviorClass, "scenePtr");
+  m_EntityIdField =
+      mono_class_get_field_from_name(m_MonoBehaviorClass, "entityId");
 
   // Component classes
   m_MonoTransformComponentClass = mono_class_from_name(
       m_CoreAssemblyImage, "WieselEngine", "TransformComponent");
+  m_TransformComponentConstructor = mono_class_get_method_from_name(
+      m_MonoTransformComponentClass, ".ctor", 2);
+  m_TransformComponentInvalidate = mono_class_get_method_from_name(
+      m_MonoTransformComponentClass, "Invalidate", 0);
   m_MonoVector3fClass =
       mono_class_from_name(m_CoreAssemblyImage, "WieselEngine", "Vector3f");
 }
 
 void ScriptManager::LoadApp() {
-  // todo load files from project file when project system is added
-  std::vector<std::string> sourceFiles;
-  for (const auto& entry :
-       std::filesystem::recursive_directory_iterator("assets/scripts")) {
-    if (entry.is_regular_file() && entry.path().extension() == ".cs") {
-      std::string name = entry.path().string();
-      LOG_INFO("Found user script {}", name);
-      sourceFiles.push_back(name);
-    }
-  }
-  std::vector<std::string> linkLibs;
-  for (const auto& entry :
-       std::filesystem::recursive_directory_iterator("obj")) {
-    if (entry.is_regular_file() && entry.path().extension() == ".dll") {
-      std::string name = entry.path().string();
-      linkLibs.push_back(name);
-      LOG_INFO("Found DLL to link {}", name);
-    }
-  }
-  if (!CompileToDLL("obj/App.dll", sourceFiles, "obj", linkLibs, m_EnableDebugger)) {
-    return;
-  }
   m_AppDomain = mono_domain_create_appdomain(const_cast<char*>("WieselApp"), nullptr);
   mono_domain_set(m_AppDomain, true);
-  //mono_domain_assembly_open(m_AppDomain, "obj/Core.dll");
-  m_AppAssembly = mono_domain_assembly_open(m_AppDomain, "obj/App.dll");
+  m_AppAssembly =
+      mono_domain_assembly_open(m_AppDomain, m_AppAssemblyPath.c_str());
   assert(m_AppAssembly);
 
   m_AppAssemblyImage = mono_assembly_get_image(m_AppAssembly);
+  m_UpdateAllThunk =
+      reinterpret_cast<UpdateAllThunk>(mono_method_get_unmanaged_thunk(
+          mono_class_get_method_from_name(m_MonoBehaviorClass, "UpdateAll",
+                                          3)));
+  m_FixedUpdateAllThunk =
+      reinterpret_cast<UpdateAllThunk>(mono_method_get_unmanaged_thunk(
+          mono_class_get_method_from_name(m_MonoBehaviorClass,
+                                          "FixedUpdateAll", 3)));
 
   const MonoTableInfo* tableInfo =
       mono_image_get_table_info(m_AppAssemblyImage, MONO_TABLE_TYPEDEF);
@@ -598,6 +831,8 @@ void ScriptManager::LoadApp() {
         mono_class_get_method_from_name(klass, "OnStart", 0);
     MonoMethod* onUpdateMethod =
         mono_class_get_method_from_name(klass, "OnUpdate", 1);
+    MonoMethod* onFixedUpdateMethod =
+        mono_class_get_method_from_name(klass, "OnFixedUpdate", 1);
     MonoMethod* onKeyPressedMethod = mono_class_get_method_from_name(
         klass, "OnKeyPressed", 2);  // KeyCode, bool isRepeat
     MonoMethod* onKeyReleasedMethod =
@@ -606,7 +841,8 @@ void ScriptManager::LoadApp() {
         klass, "OnMouseMoved", 3);  // x, y, cursorMode
     m_ScriptData.insert(std::pair(
         className,
-        new ScriptData(klass, onStartMethod, onUpdateMethod, m_SetHandleMethod,
+        new ScriptData(klass, onStartMethod, onUpdateMethod,
+                       onFixedUpdateMethod, m_SetHandleMethod,
                        onKeyPressedMethod, onKeyReleasedMethod,
                        onMouseMovedMethod, fields)));
     m_ScriptNames.push_back(className);
@@ -615,41 +851,23 @@ void ScriptManager::LoadApp() {
 
 void ScriptManager::RegisterInternals() {
   WIESEL_ADD_INTERNAL_CALL(Log_Info);
+  WIESEL_ADD_INTERNAL_CALL(Input_GetAxisId);
   WIESEL_ADD_INTERNAL_CALL(Input_GetAxis);
+  WIESEL_ADD_INTERNAL_CALL(Input_GetKeyId);
   WIESEL_ADD_INTERNAL_CALL(Input_GetKey);
   WIESEL_ADD_INTERNAL_CALL(Input_SetCursorMode);
   WIESEL_ADD_INTERNAL_CALL(Input_GetCursorMode);
+  WIESEL_ADD_INTERNAL_CALL(Behavior_GetComponentId);
   WIESEL_ADD_INTERNAL_CALL(Behavior_GetComponent);
   WIESEL_ADD_INTERNAL_CALL(Behavior_HasComponent);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetPositionX);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetPositionY);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetPositionZ);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_SetPositionX);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_SetPositionY);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_SetPositionZ);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetRotationX);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetRotationY);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetRotationZ);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_SetRotationX);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_SetRotationY);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_SetRotationZ);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetScaleX);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetScaleY);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetScaleZ);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_SetScaleX);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_SetScaleY);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_SetScaleZ);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetForward);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetBackward);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetLeft);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetRight);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetUp);
-  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetDown);
+  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetLayout);
+  WIESEL_ADD_INTERNAL_CALL(TransformComponent_GetPointer);
 }
 
 void ScriptManager::RegisterComponents() {
-  m_ComponentGetters.clear();
-  m_ComponentCheckers.clear();
+  m_Components.clear();
+  m_ComponentIds.clear();
+  m_ComponentIdsByType.clear();
 
   RegisterComponent<TransformComponent>(
       "TransformComponent",
@@ -662,10 +880,8 @@ void ScriptManager::RegisterComponents() {
         uint64_t entityId = (uint64_t)entity;
         args[0] = &scenePtr;
         args[1] = &entityId;
-
-        MonoMethod* method = mono_class_get_method_from_name(
-            m_MonoTransformComponentClass, ".ctor", 2);
-        mono_runtime_invoke(method, obj, args, nullptr);
+        mono_runtime_invoke(m_TransformComponentConstructor, obj, args,
+                            nullptr);
         return obj;
       },
       [](Scene* scene, entt::entity entity) -> bool {
@@ -681,11 +897,300 @@ ScriptInstance* ScriptManager::CreateScriptInstance(MonoBehavior* behavior) {
   return new ScriptInstance(data, behavior);
 }
 
+void ScriptManager::UpdateScripts(Scene* scene, float deltaTime) {
+  WIESEL_PROFILE_SCOPE("ScriptManager::UpdateScripts");
+  RunBatches(scene, deltaTime, m_UpdateAllThunk, ScriptMethod::OnUpdate,
+             &ScriptData::GetOnUpdateMethod);
+}
+
+void ScriptManager::FixedUpdateScripts(Scene* scene, float timeStep) {
+  WIESEL_PROFILE_SCOPE("ScriptManager::FixedUpdateScripts");
+  RunBatches(scene, timeStep, m_FixedUpdateAllThunk,
+             ScriptMethod::OnFixedUpdate, &ScriptData::GetOnFixedUpdateMethod);
+}
+
+void ScriptManager::RunBatches(Scene* scene, float deltaTime,
+                               UpdateAllThunk thunk, ScriptMethod method,
+                               MonoMethod* (ScriptData::*getMethod)() const) {
+  if (!thunk) {
+    return;
+  }
+  // Scripts can create or destroy scripted entities while they update, which
+  // adds and removes batches, so only the keys are walked.
+  std::vector<ScriptBatchKey> keys;
+  for (auto& [key, batch] : m_ScriptBatches) {
+    if (key.first == scene) {
+      keys.push_back(key);
+    }
+  }
+  for (const ScriptBatchKey& key : keys) {
+    auto it = m_ScriptBatches.find(key);
+    if (it == m_ScriptBatches.end()) {
+      continue;
+    }
+    ScriptBatch* batch = &it->second;
+    if (batch->Dirty) {
+      batch = RebuildBatch(key);
+      if (!batch) {
+        continue;
+      }
+    }
+    if (batch->Count == 0 || !(key.second->*getMethod)()) {
+      continue;
+    }
+    // The batch may be gone once the thunk returns, the array itself is kept
+    // alive by the managed loop.
+    MonoArray* array = reinterpret_cast<MonoArray*>(
+        mono_gchandle_get_target(batch->ArrayHandle));
+    int32_t count = batch->Count;
+    // The managed loop catches the exceptions of each script, this only sees
+    // the ones thrown by the loop itself.
+    MonoException* exception = nullptr;
+    {
+      ScriptTimer timer(key.second, method, count);
+      thunk(array, count, deltaTime, &exception);
+    }
+    if (exception) {
+      mono_print_unhandled_exception(reinterpret_cast<MonoObject*>(exception));
+    }
+  }
+}
+
+void ScriptManager::DispatchEvent(Scene* scene, Event& event) {
+  auto it = m_EventSubscribers.find({scene, event.GetEventType()});
+  if (it == m_EventSubscribers.end()) {
+    return;
+  }
+  // Handlers can create or destroy scripts, which changes the subscribers, so
+  // a copy is walked and checked against the live list once anything changed.
+  std::vector<ScriptInstance*> subscribers = it->second;
+  uint64_t version = m_InstancesVersion;
+  EventDispatcher dispatcher{event};
+  for (ScriptInstance* instance : subscribers) {
+    if (version != m_InstancesVersion) {
+      it = m_EventSubscribers.find({scene, event.GetEventType()});
+      if (it == m_EventSubscribers.end()) {
+        return;
+      }
+      if (std::ranges::find(it->second, instance) == it->second.end()) {
+        continue;
+      }
+    }
+    if (!instance->GetBehavior()->IsEnabled()) {
+      continue;
+    }
+    dispatcher.Dispatch<KeyPressedEvent>(
+        [instance](KeyPressedEvent& e) { return instance->OnKeyPressed(e); });
+    dispatcher.Dispatch<KeyReleasedEvent>(
+        [instance](KeyReleasedEvent& e) { return instance->OnKeyReleased(e); });
+    dispatcher.Dispatch<MouseMovedEvent>(
+        [instance](MouseMovedEvent& e) { return instance->OnMouseMoved(e); });
+  }
+}
+
+void ScriptManager::AddInstance(ScriptInstance* instance) {
+  Scene* scene = instance->GetBehavior()->GetScene();
+  ScriptData* data = instance->GetScriptData();
+  m_InstancesVersion++;
+  ScriptBatch& batch = m_ScriptBatches[{scene, data}];
+  batch.Instances.push_back(instance);
+  batch.Dirty = true;
+  for (EventType type : {EventType::KeyPressed, EventType::KeyReleased,
+                         EventType::MouseMoved}) {
+    if (data->HandlesEvent(type)) {
+      m_EventSubscribers[{scene, type}].push_back(instance);
+    }
+  }
+}
+
+void ScriptManager::RemoveInstance(ScriptInstance* instance) {
+  m_InstancesVersion++;
+  Scene* scene = instance->GetBehavior()->GetScene();
+  for (EventType type : {EventType::KeyPressed, EventType::KeyReleased,
+                         EventType::MouseMoved}) {
+    auto subscribers = m_EventSubscribers.find({scene, type});
+    if (subscribers == m_EventSubscribers.end()) {
+      continue;
+    }
+    std::erase(subscribers->second, instance);
+    if (subscribers->second.empty()) {
+      m_EventSubscribers.erase(subscribers);
+    }
+  }
+  auto it = m_ScriptBatches.find(
+      {instance->GetBehavior()->GetScene(), instance->GetScriptData()});
+  if (it == m_ScriptBatches.end()) {
+    return;
+  }
+  ScriptBatch& batch = it->second;
+  std::erase(batch.Instances, instance);
+  batch.Dirty = true;
+  if (batch.Instances.empty()) {
+    if (batch.ArrayHandle) {
+      mono_gchandle_free(batch.ArrayHandle);
+    }
+    m_ScriptBatches.erase(it);
+  }
+}
+
+void ScriptManager::MarkInstancesDirty() {
+  for (auto& [key, batch] : m_ScriptBatches) {
+    batch.Dirty = true;
+  }
+}
+
+void ScriptManager::RemoveScene(Scene* scene) {
+  std::erase_if(m_ScriptBatches, [scene](auto& entry) {
+    if (entry.first.first != scene) {
+      return false;
+    }
+    if (entry.second.ArrayHandle) {
+      mono_gchandle_free(entry.second.ArrayHandle);
+    }
+    return true;
+  });
+  std::erase_if(m_EventSubscribers, [scene](auto& entry) {
+    return entry.first.first == scene;
+  });
+  std::erase_if(m_ComponentWrappers, [scene](auto& entry) {
+    if (std::get<0>(entry.first) != scene) {
+      return false;
+    }
+    FreeComponentWrapper(entry.second);
+    return true;
+  });
+}
+
+void ScriptManager::RemoveComponentWrapper(Scene* scene, entt::entity entity,
+                                           std::type_index type) {
+  auto it = m_ComponentWrappers.find({scene, entity, type});
+  if (it == m_ComponentWrappers.end()) {
+    return;
+  }
+  FreeComponentWrapper(it->second);
+  m_ComponentWrappers.erase(it);
+}
+
+void ScriptManager::RemoveEntityWrappers(Scene* scene, entt::entity entity) {
+  std::erase_if(m_ComponentWrappers, [scene, entity](auto& entry) {
+    if (std::get<0>(entry.first) != scene ||
+        std::get<1>(entry.first) != entity) {
+      return false;
+    }
+    FreeComponentWrapper(entry.second);
+    return true;
+  });
+}
+
+MonoObject* ScriptManager::GetComponentWrapper(Scene* scene,
+                                               entt::entity entity,
+                                               std::type_index type,
+                                               const ComponentGetter& getter) {
+  ComponentWrapperKey key{scene, entity, type};
+  auto it = m_ComponentWrappers.find(key);
+  if (it != m_ComponentWrappers.end()) {
+    return mono_gchandle_get_target(it->second);
+  }
+  MonoObject* object = getter(scene, entity);
+  if (!object) {
+    return nullptr;
+  }
+  m_ComponentWrappers.insert(std::pair(key, mono_gchandle_new(object, true)));
+  return object;
+}
+
+void ScriptManager::FreeComponentWrapper(uint32_t handle) {
+  // Scripts can still hold the wrapper, transforms point into the component
+  // storage and must stop using it.
+  MonoObject* object = mono_gchandle_get_target(handle);
+  if (object &&
+      mono_object_get_class(object) == m_MonoTransformComponentClass) {
+    mono_runtime_invoke(m_TransformComponentInvalidate, object, nullptr,
+                        nullptr);
+  }
+  mono_gchandle_free(handle);
+}
+
+void ScriptManager::ClearComponentWrappers() {
+  for (auto& [key, handle] : m_ComponentWrappers) {
+    FreeComponentWrapper(handle);
+  }
+  m_ComponentWrappers.clear();
+}
+
+ScriptManager::ScriptBatch* ScriptManager::RebuildBatch(
+    const ScriptBatchKey& key) {
+  // Scripts start right before their first update, like before batching.
+  // OnStart can add or remove scripts, so it runs over a copy and skips the
+  // instances destroyed by an earlier call.
+  std::vector<ScriptInstance*> instances = m_ScriptBatches[key].Instances;
+  uint64_t version = m_InstancesVersion;
+  for (ScriptInstance* instance : instances) {
+    if (version != m_InstancesVersion) {
+      auto it = m_ScriptBatches.find(key);
+      if (it == m_ScriptBatches.end()) {
+        return nullptr;
+      }
+      if (std::ranges::find(it->second.Instances, instance) ==
+          it->second.Instances.end()) {
+        continue;
+      }
+    }
+    if (instance->m_StartRan || !instance->GetBehavior()->IsEnabled()) {
+      continue;
+    }
+    instance->m_StartRan = true;
+    instance->OnStart();
+  }
+
+  auto it = m_ScriptBatches.find(key);
+  if (it == m_ScriptBatches.end()) {
+    return nullptr;
+  }
+  ScriptBatch& batch = it->second;
+  std::vector<MonoObject*> objects;
+  objects.reserve(batch.Instances.size());
+  for (ScriptInstance* instance : batch.Instances) {
+    // Added by an OnStart above, these start on the next rebuild.
+    if (!instance->m_StartRan || !instance->GetBehavior()->IsEnabled()) {
+      continue;
+    }
+    objects.push_back(instance->GetInstance());
+  }
+
+  if (batch.ArrayHandle) {
+    mono_gchandle_free(batch.ArrayHandle);
+  }
+  MonoArray* array =
+      mono_array_new(m_AppDomain, m_MonoBehaviorClass, objects.size());
+  for (size_t i = 0; i < objects.size(); i++) {
+    mono_array_setref(array, i, objects[i]);
+  }
+  batch.ArrayHandle =
+      mono_gchandle_new(reinterpret_cast<MonoObject*>(array), false);
+  batch.Count = static_cast<int32_t>(objects.size());
+  batch.Dirty = std::ranges::any_of(batch.Instances, [](auto* instance) {
+    return !instance->m_StartRan && instance->GetBehavior()->IsEnabled();
+  });
+  return &batch;
+}
+
+void ScriptManager::ClearBatches() {
+  for (auto& [key, batch] : m_ScriptBatches) {
+    if (batch.ArrayHandle) {
+      mono_gchandle_free(batch.ArrayHandle);
+    }
+  }
+  m_ScriptBatches.clear();
+  m_EventSubscribers.clear();
+}
+
 template <class T>
 void ScriptManager::RegisterComponent(std::string name, ComponentGetter getter,
                                       ComponentChecker checker) {
-  m_ComponentGetters.insert(std::pair(name, getter));
-  m_ComponentGettersByType.insert(std::pair(std::type_index(typeid(T)), getter));
-  m_ComponentCheckers.insert(std::pair(name, checker));
+  int32_t id = static_cast<int32_t>(m_Components.size());
+  m_Components.push_back({std::type_index(typeid(T)), getter, checker});
+  m_ComponentIds.insert(std::pair(name, id));
+  m_ComponentIdsByType.insert(std::pair(std::type_index(typeid(T)), id));
 }
 }  // namespace Wiesel
\ No newline at end of file
@@ -0,0 +1,117 @@
+//
+//    Copyright 2023 Metehan Gezer
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "script/w_scriptprofiler.hpp"
+
+#include <mono/metadata/object.h>
+#include <mono/metadata/profiler.h>
+
+#include "util/w_logger.hpp"
+
+// The profiler API leaves this struct to the embedder. The callbacks run on
+// whatever thread allocates or collects.
+struct _MonoProfiler {
+  std::atomic<uint64_t> Allocations = 0;
+  std::atomic<uint64_t> AllocatedBytes = 0;
+  std::atomic<uint32_t> Collections = 0;
+  std::atomic<uint32_t> MajorCollections = 0;
+};
+
+namespace Wiesel {
+
+static MonoProfiler s_Profiler;
+
+static void OnGCAllocation(MonoProfiler* profiler, MonoObject* object) {
+  profiler->Allocations.fetch_add(1, std::memory_order_relaxed);
+  profiler->AllocatedBytes.fetch_add(mono_object_get_size(object),
+                                     std::memory_order_relaxed);
+}
+
+static void OnGCEvent(MonoProfiler* profiler, MonoProfilerGCEvent event,
+                      uint32_t generation, mono_bool isSerial) {
+  if (event != MONO_GC_EVENT_START) {
+    return;
+  }
+  profiler->Collections.fetch_add(1, std::memory_order_relaxed);
+  if (generation > 0) {
+    profiler->MajorCollections.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+const char* GetScriptMethodName(ScriptMethod method) {
+  switch (method) {
+    case ScriptMethod::OnStart:
+      return "OnStart";
+    case ScriptMethod::OnUpdate:
+      return "OnUpdate";
+    case ScriptMethod::OnFixedUpdate:
+      return "OnFixedUpdate";
+    case ScriptMethod::OnKeyPressed:
+      return "OnKeyPressed";
+    case ScriptMethod::OnKeyReleased:
+      return "OnKeyReleased";
+    case ScriptMethod::OnMouseMoved:
+      return "OnMouseMoved";
+    default:
+      return "Unknown";
+  }
+}
+
+void ScriptMethodStats::AddSample(std::chrono::nanoseconds time,
+                                  uint32_t calls) {
+  m_Calls += calls;
+  m_Total += time;
+  m_Max = std::max(m_Max, time);
+  m_Samples[m_NextSample] = time;
+  m_NextSample = (m_NextSample + 1) % kSampleCount;
+  m_SampleCount = std::min(m_SampleCount + 1, kSampleCount);
+}
+
+std::chrono::nanoseconds ScriptMethodStats::GetP99() const {
+  if (m_SampleCount == 0) {
+    return std::chrono::nanoseconds{0};
+  }
+  std::array<std::chrono::nanoseconds, kSampleCount> samples = m_Samples;
+  size_t index = (m_SampleCount * 99) / 100;
+  std::nth_element(samples.begin(), samples.begin() + index,
+                   samples.begin() + m_SampleCount);
+  return samples[index];
+}
+
+bool ScriptProfiler::s_Enabled = false;
+ScriptGCStats ScriptProfiler::s_LastFrame;
+
+void ScriptProfiler::Init() {
+  // Has to happen before mono_jit_init, allocations can't be enabled later.
+  if (!mono_profiler_enable_allocations()) {
+    LOG_WARN("Mono doesn't allow allocation profiling!");
+    return;
+  }
+  MonoProfilerHandle handle = mono_profiler_create(&s_Profiler);
+  mono_profiler_set_gc_allocation_callback(handle, OnGCAllocation);
+  mono_profiler_set_gc_event_callback(handle, OnGCEvent);
+  s_Enabled = true;
+}
+
+void ScriptProfiler::EndFrame() {
+  if (!s_Enabled) {
+    return;
+  }
+  s_LastFrame.Allocations =
+      s_Profiler.Allocations.exchange(0, std::memory_order_relaxed);
+  s_LastFrame.AllocatedBytes =
+      s_Profiler.AllocatedBytes.exchange(0, std::memory_order_relaxed);
+  s_LastFrame.Collections =
+      s_Profiler.Collections.exchange(0, std::memory_order_relaxed);
+  s_LastFrame.MajorCollections =
+      s_Profiler.MajorCollections.exchange(0, std::memory_order_relaxed);
+}
+
+}  // namespace Wiesel
@@ -0,0 +1,62 @@
+//
+//    Copyright 2023 Metehan Gezer
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "util/w_filewatcher.hpp"
+
+#include "util/w_logger.hpp"
+
+namespace Wiesel {
+
+constexpr std::chrono::milliseconds kFileWatcherPollInterval{250};
+
+FileWatcher::FileWatcher(const std::string& directory)
+    : m_Directory(directory) {
+  if (!std::filesystem::is_directory(m_Directory)) {
+    throw std::runtime_error("failed to watch directory: " + directory);
+  }
+  for (const auto& entry : std::filesystem::directory_iterator(m_Directory)) {
+    if (entry.is_regular_file()) {
+      m_WriteTimes[entry.path().string()] = entry.last_write_time();
+    }
+  }
+  m_LastPoll = std::chrono::steady_clock::now();
+}
+
+FileWatcher::~FileWatcher() = default;
+
+std::vector<std::string> FileWatcher::Poll() {
+  std::vector<std::string> changed;
+  auto now = std::chrono::steady_clock::now();
+  if (now - m_LastPoll < kFileWatcherPollInterval) {
+    return changed;
+  }
+  m_LastPoll = now;
+
+  std::error_code error;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(m_Directory, error)) {
+    if (!entry.is_regular_file(error)) {
+      continue;
+    }
+    auto writeTime = entry.last_write_time(error);
+    if (error) {
+      continue;
+    }
+    std::string path = entry.path().string();
+    auto it = m_WriteTimes.find(path);
+    if (it == m_WriteTimes.end() || it->second != writeTime) {
+      m_WriteTimes[path] = writeTime;
+      changed.push_back(path);
+    }
+  }
+  return changed;
+}
+
+}  // namespace Wiesel
@@ -0,0 +1,327 @@
+//
+//    Copyright 2023 Metehan Gezer
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "util/w_jobsystem.hpp"
+
+#include "util/w_logger.hpp"
+#include "util/w_profiler.hpp"
+
+namespace Wiesel {
+
+// Threads the job system didn't create and that didn't initialize it. They
+// can submit and wait, but never run jobs submitted by another thread.
+static constexpr uint32_t kExternalThread = std::numeric_limits<uint32_t>::max();
+static thread_local uint32_t t_ThreadIndex = kExternalThread;
+
+bool JobSystem::s_Initialized = false;
+std::atomic<bool> JobSystem::s_Running{false};
+std::vector<Scope<JobSystem::ThreadData>> JobSystem::s_ThreadData;
+std::vector<std::thread> JobSystem::s_Workers;
+std::atomic<uint32_t> JobSystem::s_QueuedJobs{0};
+std::mutex JobSystem::s_SleepMutex;
+std::condition_variable JobSystem::s_SleepCondition;
+JobProfileHookFn JobSystem::s_ProfileHook;
+std::chrono::steady_clock::time_point JobSystem::s_StatsResetTime;
+
+JobGraph::TaskId JobGraph::AddTask(const char* name, std::function<void()> fn) {
+  m_Tasks.push_back(Task{.Name = name, .Fn = std::move(fn)});
+  return static_cast<TaskId>(m_Tasks.size() - 1);
+}
+
+void JobGraph::AddDependency(TaskId before, TaskId after) {
+  if (before >= m_Tasks.size() || after >= m_Tasks.size() || before == after) {
+    throw std::invalid_argument("Invalid task dependency!");
+  }
+  m_Tasks[before].Successors.push_back(after);
+  m_Tasks[after].DependencyCount++;
+}
+
+void JobGraph::Execute() {
+  if (m_Tasks.empty()) {
+    return;
+  }
+  if (m_RemainingDependenciesSize != m_Tasks.size()) {
+    m_RemainingDependencies =
+        std::make_unique<std::atomic<uint32_t>[]>(m_Tasks.size());
+    m_RemainingDependenciesSize = m_Tasks.size();
+  }
+  for (TaskId i = 0; i < m_Tasks.size(); i++) {
+    m_RemainingDependencies[i].store(m_Tasks[i].DependencyCount,
+                                     std::memory_order_relaxed);
+  }
+
+  JobCounter counter;
+  bool submitted = false;
+  for (TaskId i = 0; i < m_Tasks.size(); i++) {
+    if (m_Tasks[i].DependencyCount == 0) {
+      SubmitTask(i, counter);
+      submitted = true;
+    }
+  }
+  if (!submitted) {
+    throw std::runtime_error("Job graph has no root task, is it cyclic?");
+  }
+  JobSystem::Wait(counter);
+}
+
+void JobGraph::SubmitTask(TaskId id, JobCounter& counter) {
+  Task& task = m_Tasks[id];
+  JobSystem::Submit(task.Name, [this, &task, &counter]() {
+    task.Fn();
+    // Successors are submitted before this job is counted as finished, so the
+    // counter never hits zero while there is still work left in the graph.
+    for (TaskId successor : task.Successors) {
+      if (m_RemainingDependencies[successor].fetch_sub(
+              1, std::memory_order_acq_rel) == 1) {
+        SubmitTask(successor, counter);
+      }
+    }
+  }, counter);
+}
+
+void JobSystem::Init(const JobSystemProperties& props) {
+  if (s_Initialized) {
+    throw std::runtime_error("Job system is already initialized!");
+  }
+  uint32_t workerCount = props.WorkerCount;
+  if (workerCount == 0) {
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+  }
+
+  // Index 0 belongs to the thread that initializes the job system.
+  t_ThreadIndex = 0;
+  s_ThreadData.clear();
+  for (uint32_t i = 0; i < workerCount + 1; i++) {
+    s_ThreadData.push_back(CreateScope<ThreadData>());
+  }
+  s_Running = true;
+  s_Initialized = true;
+  s_StatsResetTime = std::chrono::steady_clock::now();
+  for (uint32_t i = 1; i <= workerCount; i++) {
+    s_Workers.emplace_back(&JobSystem::WorkerLoop, i);
+  }
+  LOG_INFO("Job system initialized with {} workers", workerCount);
+}
+
+void JobSystem::Destroy() {
+  if (!s_Initialized) {
+    return;
+  }
+  {
+    std::scoped_lock<std::mutex> lock(s_SleepMutex);
+    s_Running = false;
+  }
+  s_SleepCondition.notify_all();
+  for (auto& worker : s_Workers) {
+    worker.join();
+  }
+  s_Workers.clear();
+  s_ThreadData.clear();
+  s_QueuedJobs = 0;
+  s_Initialized = false;
+}
+
+void JobSystem::Submit(const char* name, std::function<void()> fn,
+                       JobCounter& counter) {
+  counter.m_Pending.fetch_add(1, std::memory_order_relaxed);
+  bool external = t_ThreadIndex == kExternalThread;
+  // An external thread can't run queued jobs, with no workers to pick it up
+  // its job runs right away.
+  if (!s_Initialized || (external && s_Workers.empty())) {
+    Job job{name, std::move(fn), &counter};
+    RunJob(0, job);
+    return;
+  }
+
+  // Jobs of external threads go to the main thread's queue, the workers steal
+  // them from the front.
+  ThreadData& data = *s_ThreadData[external ? 0 : t_ThreadIndex];
+  {
+    std::scoped_lock<std::mutex> lock(data.QueueMutex);
+    data.Queue.push_back(Job{name, std::move(fn), &counter});
+  }
+  s_QueuedJobs.fetch_add(1, std::memory_order_release);
+  {
+    // Taking the lock makes sure a worker that just checked the queue count
+    // is either already waiting or will see the new job.
+    std::scoped_lock<std::mutex> lock(s_SleepMutex);
+  }
+  s_SleepCondition.notify_one();
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+  while (!counter.IsDone()) {
+    if (!s_Initialized || t_ThreadIndex == kExternalThread ||
+        !TryRunJob(t_ThreadIndex)) {
+      std::this_thread::yield();
+    }
+  }
+  if (counter.m_Exception) {
+    std::rethrow_exception(counter.m_Exception);
+  }
+}
+
+void JobSystem::ParallelFor(const char* name, uint32_t count,
+                            uint32_t grainSize,
+                            const std::function<void(uint32_t)>& fn) {
+  if (count == 0) {
+    return;
+  }
+  grainSize = std::max(grainSize, 1u);
+  if (count <= grainSize || !s_Initialized || s_Workers.empty()) {
+    for (uint32_t i = 0; i < count; i++) {
+      fn(i);
+    }
+    return;
+  }
+
+  JobCounter counter;
+  for (uint32_t begin = 0; begin < count; begin += grainSize) {
+    uint32_t end = std::min(begin + grainSize, count);
+    Submit(name, [&fn, begin, end]() {
+      for (uint32_t i = begin; i < end; i++) {
+        fn(i);
+      }
+    }, counter);
+  }
+  Wait(counter);
+}
+
+uint32_t JobSystem::GetThreadCount() {
+  return static_cast<uint32_t>(std::max<size_t>(s_ThreadData.size(), 1));
+}
+
+uint32_t JobSystem::GetThreadIndex() {
+  return t_ThreadIndex == kExternalThread ? 0 : t_ThreadIndex;
+}
+
+bool JobSystem::IsExternalThread() {
+  return t_ThreadIndex == kExternalThread;
+}
+
+void JobSystem::SetProfileHook(JobProfileHookFn hook) {
+  s_ProfileHook = std::move(hook);
+}
+
+std::vector<JobWorkerStats> JobSystem::GetWorkerStats() {
+  std::vector<JobWorkerStats> stats;
+  auto elapsed = std::chrono::steady_clock::now() - s_StatsResetTime;
+  double elapsedNanos = static_cast<double>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  for (const auto& data : s_ThreadData) {
+    uint64_t busy = data->BusyNanos.load(std::memory_order_relaxed);
+    stats.push_back(JobWorkerStats{
+        .JobCount = data->JobCount.load(std::memory_order_relaxed),
+        .BusyTime = std::chrono::nanoseconds(busy),
+        .Utilization = elapsedNanos > 0.0
+                           ? static_cast<float>(busy / elapsedNanos)
+                           : 0.0f});
+  }
+  return stats;
+}
+
+void JobSystem::ResetWorkerStats() {
+  for (const auto& data : s_ThreadData) {
+    data->JobCount = 0;
+    data->BusyNanos = 0;
+  }
+  s_StatsResetTime = std::chrono::steady_clock::now();
+}
+
+void JobSystem::WorkerLoop(uint32_t threadIndex) {
+  t_ThreadIndex = threadIndex;
+  while (true) {
+    if (TryRunJob(threadIndex)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(s_SleepMutex);
+    s_SleepCondition.wait(lock, []() {
+      return !s_Running || s_QueuedJobs.load(std::memory_order_acquire) > 0;
+    });
+    if (!s_Running) {
+      return;
+    }
+  }
+}
+
+bool JobSystem::TryRunJob(uint32_t threadIndex) {
+  Job job;
+  if (!PopJob(threadIndex, job)) {
+    return false;
+  }
+  RunJob(threadIndex, job);
+  return true;
+}
+
+bool JobSystem::PopJob(uint32_t threadIndex, Job& job) {
+  if (s_QueuedJobs.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  {
+    ThreadData& own = *s_ThreadData[threadIndex];
+    std::scoped_lock<std::mutex> lock(own.QueueMutex);
+    if (!own.Queue.empty()) {
+      job = std::move(own.Queue.back());
+      own.Queue.pop_back();
+      s_QueuedJobs.fetch_sub(1, std::memory_order_acq_rel);
+      return true;
+    }
+  }
+  // Steal the oldest job from another thread, these are usually the biggest
+  // chunks of work.
+  uint32_t count = static_cast<uint32_t>(s_ThreadData.size());
+  for (uint32_t i = 1; i < count; i++) {
+    ThreadData& victim = *s_ThreadData[(threadIndex + i) % count];
+    std::scoped_lock<std::mutex> lock(victim.QueueMutex);
+    if (!victim.Queue.empty()) {
+      job = std::move(victim.Queue.front());
+      victim.Queue.pop_front();
+      s_QueuedJobs.fetch_sub(1, std::memory_order_acq_rel);
+      return true;
+    }
+  }
+  return false;
+}
+
+void JobSystem::RunJob(uint32_t threadIndex, Job& job) {
+  auto start = std::chrono::steady_clock::now();
+  {
+#if WIESEL_PROFILE
+    ProfilerInstance profiler(job.Name);
+#endif
+    // Rethrown by Wait on whatever thread waits for the counter, a worker
+    // has no caller to throw to.
+    try {
+      job.Fn();
+    } catch (...) {
+      std::scoped_lock<std::mutex> lock(job.Counter->m_ExceptionMutex);
+      if (!job.Counter->m_Exception) {
+        job.Counter->m_Exception = std::current_exception();
+      }
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  if (!s_ThreadData.empty()) {
+    ThreadData& data = *s_ThreadData[threadIndex];
+    data.JobCount.fetch_add(1, std::memory_order_relaxed);
+    data.BusyNanos.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+            .count(),
+        std::memory_order_relaxed);
+  }
+  if (s_ProfileHook) {
+    s_ProfileHook(threadIndex, job.Name, start, end);
+  }
+  job.Counter->m_Pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+}  // namespace Wiesel
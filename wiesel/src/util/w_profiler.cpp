@@ -17,6 +17,7 @@ namespace Wiesel {
 
 bool Profiler::s_Active = false;
 std::vector<ProfileData> Profiler::s_Data;
+std::mutex Profiler::s_DataMutex;
 std::string Profiler::s_CurrentSection;
 
 ProfilerInstance::ProfilerInstance(const std::string& name)
@@ -46,7 +47,10 @@ void Profiler::BeginSection(const std::string& section) {
         "Cannot begin section while another one was still active!");
   }
   s_Active = true;
-  s_Data.clear();
+  {
+    std::scoped_lock<std::mutex> lock(s_DataMutex);
+    s_Data.clear();
+  }
   s_CurrentSection = section;
 }
 
@@ -54,6 +58,7 @@ void Profiler::EndSection(std::ostream& stream) {
   if (!s_Active) {
     return;
   }
+  std::scoped_lock<std::mutex> lock(s_DataMutex);
   long long sum = 0;
   stream << "[profiler] Section: " << s_CurrentSection << "\n";
   for (auto& v : s_Data) {
@@ -70,11 +75,13 @@ void Profiler::EndSection(std::ostream& stream) {
 }
 
 void Profiler::InsertData(const ProfileData& profileData) {
+  std::scoped_lock<std::mutex> lock(s_DataMutex);
   s_Data.push_back(profileData);
 }
 
 void Profiler::SetActive(bool value) {
   s_Active = value;
+  std::scoped_lock<std::mutex> lock(s_DataMutex);
   s_Data.clear();
 }
 
@@ -11,18 +11,37 @@
 
 #include "util/w_spirv.hpp"
 
+#include "util/w_jobsystem.hpp"
 #include "util/w_logger.hpp"
 
 namespace Wiesel::Spirv {
 
+constexpr const char* kShaderCacheDirectory = "shader_cache";
+// Bump when the compiler changes in a way the cache key can't see.
+constexpr uint64_t kShaderCacheVersion = 2;
+// Every option below is part of the cache key.
+constexpr int kDefaultVersion = 450;
+constexpr glslang::EShTargetLanguageVersion kTargetVersion =
+    glslang::EShTargetSpv_1_0;
+constexpr EShMessages kMessages =
+    static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+constexpr uint32_t kSpirvMagic = 0x07230203;
+
+static TBuiltInResource s_Resources{};
+static std::mutex s_CacheMutex;
+static std::unordered_map<uint64_t, std::vector<uint32_t>> s_Cache;
+
 void Init() {
   LOG_DEBUG("Initializing glslang");
   glslang::InitializeProcess();
+  InitResources(s_Resources);
 }
 
 void Cleanup() {
   LOG_DEBUG("Cleaning up glslang");
   glslang::FinalizeProcess();
+  std::lock_guard lock(s_CacheMutex);
+  s_Cache.clear();
 }
 
 void InitResources(TBuiltInResource& resources) {
@@ -137,28 +156,85 @@ EShLanguage FindLanguage(ShaderType type) {
     case ShaderTypeFragment: {
       return EShLangFragment;
     }
+    case ShaderTypeCompute: {
+      return EShLangCompute;
+    }
     default: {
       throw std::runtime_error("Shader stage is not implemented yet");
     }
   }
 }
 
+std::optional<ShaderType> FindShaderType(const std::filesystem::path& path) {
+  std::string extension = path.extension().string();
+  if (extension == ".vert") {
+    return ShaderTypeVertex;
+  } else if (extension == ".frag") {
+    return ShaderTypeFragment;
+  } else if (extension == ".comp") {
+    return ShaderTypeCompute;
+  }
+  return std::nullopt;
+}
+
+static glslang::SpvOptions GetSpvOptions() {
+  glslang::SpvOptions options{};
+  options.validate = true;
+  options.optimizeSize = true;
+  options.stripDebugInfo = true;
+  return options;
+}
+
+// Includes are looked up next to the file that includes them, the same way
+// for compiling and for the cache key.
+static std::filesystem::path ResolveInclude(const std::string& header,
+                                            const std::string& includer) {
+  return (std::filesystem::path(includer).parent_path() / header)
+      .lexically_normal();
+}
+
+class ShaderIncluder : public glslang::TShader::Includer {
+ public:
+  IncludeResult* includeLocal(const char* headerName, const char* includerName,
+                              size_t inclusionDepth) override {
+    std::filesystem::path path = ResolveInclude(headerName, includerName);
+    if (!std::filesystem::is_regular_file(path)) {
+      return nullptr;
+    }
+    auto* data = new std::vector<char>(ReadFile(path.string()));
+    return new IncludeResult(path.string(), data->data(), data->size(), data);
+  }
+
+  IncludeResult* includeSystem(const char* headerName,
+                               const char* includerName,
+                               size_t inclusionDepth) override {
+    return includeLocal(headerName, includerName, inclusionDepth);
+  }
+
+  void releaseInclude(IncludeResult* result) override {
+    if (result) {
+      delete static_cast<std::vector<char>*>(result->userData);
+      delete result;
+    }
+  }
+};
+
 bool ShaderToSPV(ShaderType type, const std::vector<char>& input,
-                 std::vector<uint32_t>& output) {
-  LOG_INFO("Compiling shader...");
+                 std::vector<uint32_t>& output, const std::string& path) {
   EShLanguage stage = FindLanguage(type);
   glslang::TShader shader(stage);
   glslang::TProgram program;
-  TBuiltInResource resources = {};
-  InitResources(resources);
 
-  shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
-  EShMessages messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
+  shader.setEnvTarget(glslang::EShTargetSpv, kTargetVersion);
   const char* strings[] = {input.data()};
   const int lengths[] = {static_cast<int>(input.size())};
-  shader.setStringsWithLengths(strings, lengths, std::size(strings));
+  const char* names[] = {path.c_str()};
+  shader.setStringsWithLengthsAndNames(strings, lengths, names,
+                                       std::size(strings));
 
-  if (!shader.parse(&resources, 450, true, messages)) {
+  ShaderIncluder includer;
+  if (!shader.parse(&s_Resources, kDefaultVersion, true, kMessages,
+                    includer)) {
     puts(shader.getInfoLog());
     puts(shader.getInfoDebugLog());
     fflush(stdout);
@@ -171,18 +247,185 @@ bool ShaderToSPV(ShaderType type, const std::vector<char>& input,
   // Program-level processing...
   //
 
-  if (!program.link(messages)) {
+  if (!program.link(kMessages)) {
     puts(shader.getInfoLog());
     puts(shader.getInfoDebugLog());
     fflush(stdout);
     return false;
   }
-  glslang::SpvOptions opt{};
-  opt.validate = true;
-  opt.optimizeSize = true;
-  opt.stripDebugInfo = true;
+  glslang::SpvOptions opt = GetSpvOptions();
   glslang::GlslangToSpv(*program.getIntermediate(stage), output, &opt);
   return true;
 }
 
+static void HashBytes(uint64_t& hash, const void* data, size_t size) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+}
+
+// Mixes in every file the source includes, found by scanning for #include
+// lines. Includes in disabled #if blocks are hashed too, which only costs a
+// recompile.
+static void HashIncludes(uint64_t& hash, const std::string& path,
+                         const std::vector<char>& source,
+                         std::set<std::string>& visited) {
+  std::string_view text(source.data(), source.size());
+  size_t lineStart = 0;
+  while (lineStart < text.size()) {
+    size_t lineEnd = text.find('\n', lineStart);
+    if (lineEnd == std::string_view::npos) {
+      lineEnd = text.size();
+    }
+    std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+    lineStart = lineEnd + 1;
+
+    size_t pos = line.find_first_not_of(" \t");
+    if (pos == std::string_view::npos || line[pos] != '#') {
+      continue;
+    }
+    pos = line.find_first_not_of(" \t", pos + 1);
+    if (pos == std::string_view::npos ||
+        line.substr(pos, 7) != "include") {
+      continue;
+    }
+    size_t open = line.find_first_of("\"<", pos + 7);
+    if (open == std::string_view::npos) {
+      continue;
+    }
+    size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+    if (close == std::string_view::npos) {
+      continue;
+    }
+    std::string header(line.substr(open + 1, close - open - 1));
+    std::string resolved = ResolveInclude(header, path).string();
+    if (!visited.insert(resolved).second) {
+      continue;
+    }
+    HashBytes(hash, resolved.data(), resolved.size());
+    if (!std::filesystem::is_regular_file(resolved)) {
+      // Fails to compile, nothing else to mix in.
+      continue;
+    }
+    std::vector<char> included = ReadFile(resolved);
+    HashBytes(hash, included.data(), included.size());
+    HashIncludes(hash, resolved, included, visited);
+  }
+}
+
+// FNV-1a of everything that goes into the compiler: the options, the stage,
+// the source and the files it includes.
+static uint64_t HashShader(ShaderType type, const std::string& path,
+                           const std::vector<char>& source) {
+  uint64_t hash = 14695981039346656037ull;
+  HashBytes(hash, &kShaderCacheVersion, sizeof(kShaderCacheVersion));
+  int generatorVersion = glslang::GetSpirvGeneratorVersion();
+  HashBytes(hash, &generatorVersion, sizeof(generatorVersion));
+  HashBytes(hash, &kDefaultVersion, sizeof(kDefaultVersion));
+  HashBytes(hash, &kTargetVersion, sizeof(kTargetVersion));
+  HashBytes(hash, &kMessages, sizeof(kMessages));
+  glslang::SpvOptions options = GetSpvOptions();
+  bool flags[] = {options.generateDebugInfo, options.stripDebugInfo,
+                  options.disableOptimizer,  options.optimizeSize,
+                  options.disassemble,       options.validate};
+  HashBytes(hash, flags, sizeof(flags));
+  // Static storage, its padding is zeroed.
+  HashBytes(hash, &s_Resources, sizeof(s_Resources));
+  HashBytes(hash, &type, sizeof(type));
+  HashBytes(hash, source.data(), source.size());
+  std::set<std::string> visited;
+  HashIncludes(hash, path, source, visited);
+  return hash;
+}
+
+// Rejects truncated or corrupted entries, they are compiled again.
+static bool ReadCacheEntry(const std::filesystem::path& path,
+                           std::vector<uint32_t>& output) {
+  std::error_code error;
+  uintmax_t size = std::filesystem::file_size(path, error);
+  if (error || size == 0 || size % sizeof(uint32_t) != 0) {
+    return false;
+  }
+  output = ReadFileUint32(path.string());
+  return output.size() * sizeof(uint32_t) == size &&
+         output[0] == kSpirvMagic;
+}
+
+bool CompileShader(ShaderType type, const std::string& path,
+                   std::vector<uint32_t>& output) {
+  std::vector<char> source = ReadFile(path);
+  uint64_t hash = HashShader(type, path, source);
+  {
+    std::lock_guard lock(s_CacheMutex);
+    auto it = s_Cache.find(hash);
+    if (it != s_Cache.end()) {
+      output = it->second;
+      return true;
+    }
+  }
+
+  std::filesystem::path cachePath =
+      std::filesystem::path(kShaderCacheDirectory) /
+      fmt::format("{:016x}.spv", hash);
+  bool cached =
+      std::filesystem::exists(cachePath) && ReadCacheEntry(cachePath, output);
+  if (!cached) {
+    LOG_INFO("Compiling shader {}...", path);
+    output.clear();
+    if (!ShaderToSPV(type, source, output, path)) {
+      return false;
+    }
+    // Written to a temporary file first so a crash never leaves a partial
+    // entry behind.
+    std::error_code error;
+    std::filesystem::create_directories(kShaderCacheDirectory, error);
+    std::filesystem::path tempPath = cachePath;
+    // Non-worker threads like the shader reloader all share thread index 0,
+    // the id is unique among the running threads.
+    tempPath += fmt::format(
+        ".{:x}", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(output.data()),
+               static_cast<std::streamsize>(output.size() * sizeof(uint32_t)));
+    file.close();
+    if (file.fail()) {
+      LOG_WARN("Failed to write shader cache entry {}", cachePath.string());
+    } else {
+      std::filesystem::rename(tempPath, cachePath, error);
+    }
+  }
+
+  std::lock_guard lock(s_CacheMutex);
+  s_Cache[hash] = output;
+  return true;
+}
+
+void PrecompileShaders(const std::string& directory) {
+  std::vector<std::pair<ShaderType, std::string>> shaders;
+  for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+    std::optional<ShaderType> type = FindShaderType(entry.path());
+    if (entry.is_regular_file() && type) {
+      shaders.emplace_back(*type, entry.path().string());
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::atomic<uint32_t> failed{0};
+  JobSystem::ParallelFor(
+      "PrecompileShaders", static_cast<uint32_t>(shaders.size()), 1,
+      [&shaders, &failed](uint32_t i) {
+        std::vector<uint32_t> code;
+        if (!CompileShader(shaders[i].first, shaders[i].second, code)) {
+          failed++;
+        }
+      });
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  // Failed shaders throw once they are created.
+  LOG_INFO("Precompiled {} shaders in {:.2f} ms, {} failed", shaders.size(),
+           elapsed.count() / 1000.0, failed.load());
+}
+
 }  // namespace Wiesel::Spirv
\ No newline at end of file
@@ -12,6 +12,7 @@
 #include "w_application.hpp"
 
 #include "input/w_input.hpp"
+#include "script/w_scriptmanager.hpp"
 #include "w_engine.hpp"
 #include "window/w_glfwwindow.hpp"
 
@@ -117,9 +118,14 @@ void Application::Run() {
       m_FPS = static_cast<float>(m_FrameCount) / m_FPSTimer;
       m_FrameCount = 0;
       m_FPSTimer = 0.0f;
+      m_JobWorkerStats = JobSystem::GetWorkerStats();
+      JobSystem::ResetWorkerStats();
     }
 
     ExecuteQueue();
+    // Scripts compiled in the background are swapped in between frames.
+    ScriptManager::UpdateReload();
+    ScriptProfiler::EndFrame();
 
     if (!m_IsMinimized) {
       for (const auto& layer : m_Layers) {
@@ -144,6 +150,12 @@ void Application::Run() {
       for (const auto& layer : m_Overlays) {
         layer->OnPostRender();
       }
+      if (m_FirstFrame) {
+        // Scripts that aren't precompiled are JIT compiled in this frame.
+        LOG_INFO("First frame took {:.2f} ms",
+                 (Time::GetTime() - time) * 1000.0f);
+        m_FirstFrame = false;
+      }
     }
 
     m_Window->OnUpdate();
@@ -184,31 +196,31 @@ void Application::UpdateKeyboardAxis() {
   bool down = InputManager::GetKey("Down");
 
   if (right && !left) {
-    InputManager::m_Axis["Horizontal"] = 1;
+    InputManager::Axis("Horizontal") = 1;
   } else if (!right && left) {
-    InputManager::m_Axis["Horizontal"] = -1;
+    InputManager::Axis("Horizontal") = -1;
   } else {
-    InputManager::m_Axis["Horizontal"] = 0;
+    InputManager::Axis("Horizontal") = 0;
   }
 
   if (up && !down) {
-    InputManager::m_Axis["Vertical"] = 1;
+    InputManager::Axis("Vertical") = 1;
   } else if (!up && down) {
-    InputManager::m_Axis["Vertical"] = -1;
+    InputManager::Axis("Vertical") = -1;
   } else {
-    InputManager::m_Axis["Vertical"] = 0;
+    InputManager::Axis("Vertical") = 0;
   }
 }
 
 bool Application::OnKeyPressed(Wiesel::KeyPressedEvent& event) {
   InputManager::m_InputMode = InputModeKeyboardAndMouse;
-  InputManager::m_Keys[event.GetKeyCode()].Pressed = true;
+  InputManager::SetPressed(event.GetKeyCode(), true);
   UpdateKeyboardAxis();
   return false;
 }
 
 bool Application::OnKeyReleased(Wiesel::KeyReleasedEvent& event) {
-  InputManager::m_Keys[event.GetKeyCode()].Pressed = false;
+  InputManager::SetPressed(event.GetKeyCode(), false);
   UpdateKeyboardAxis();
   return false;
 }
@@ -219,14 +231,14 @@ bool Application::OnMouseMoved(Wiesel::MouseMovedEvent& event) {
   InputManager::m_MouseY = event.GetY();
   // todo mouse delta raw
   if (event.GetCursorMode() == CursorModeRelative) {
-    InputManager::m_Axis["Mouse X"] +=
+    InputManager::Axis("Mouse X") +=
         InputManager::m_MouseAxisSensX *
         (((m_WindowSize.Width / 2.0f) - event.GetX()) / m_WindowSize.Width);
-    InputManager::m_Axis["Mouse Y"] +=
+    InputManager::Axis("Mouse Y") +=
         InputManager::m_MouseAxisSensY *
         (((m_WindowSize.Height / 2.0f) - event.GetY()) / m_WindowSize.Width);
-    InputManager::m_Axis["Mouse Y"] = std::clamp(
-        InputManager::m_Axis["Mouse Y"], -InputManager::m_MouseAxisLimitY,
+    InputManager::Axis("Mouse Y") = std::clamp(
+        InputManager::Axis("Mouse Y"), -InputManager::m_MouseAxisLimitY,
         InputManager::m_MouseAxisLimitY);
   }
   return false;
@@ -34,15 +34,26 @@ namespace Wiesel {
 Ref<Renderer> Engine::s_Renderer;
 Ref<AppWindow> Engine::s_Window;
 
-void Engine::InitEngine() {
+void Engine::InitEngine(const EngineProperties&& props) {
 #ifdef WIN32
   EnableAnsiColors();
 #endif
+  JobSystem::Init(props.JobSystem);
   InitializeComponents();
   InputManager::Init();
+#ifdef NDEBUG
   ScriptManager::Init({
-      .EnableDebugger = true
+      .EnableDebugger = false,
+      .EnableProfiler = false,
+      .EnableAot = true
   });
+#else
+  ScriptManager::Init({
+      .EnableDebugger = true,
+      .EnableProfiler = true,
+      .EnableAot = false
+  });
+#endif
 }
 
 void Engine::InitWindow(const WindowProperties&& props) {
@@ -71,6 +82,7 @@ void Engine::CleanupWindow() {
 
 void Engine::CleanupEngine() {
   ScriptManager::Destroy();
+  JobSystem::Destroy();
   //InputManager::Destroy();
   //CleanupComponents();
 }
@@ -0,0 +1,21 @@
+//
+//    Copyright 2023 Metehan Gezer
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+
+#include "w_engine.hpp"
+
+namespace Wiesel {
+
+// Kept alone in this file, the linker only pulls it out of the static library
+// when the application doesn't define its own.
+EngineProperties GetEngineProperties() {
+  return {};
+}
+
+}  // namespace Wiesel